@@ -32,6 +32,18 @@ static const rio::Vector3f cMiiBodyMiddleBodyHeadRotation
 
 static const f32 cMiiBodyMiddleScale = 7.0f;
 
+// Body scale Y only depends on the height, so camera
+// presets can use it at compile time (see ViewTypes.h).
+constexpr f32 calcBodyScaleY(f32 height)
+{
+#ifndef USE_HEIGHT_LIMIT_SCALE_FACTORS
+    // 0.77 / 128.0 = 0.006015625
+    return (height * 0.006015625f) + 0.5f;
+#else
+    return (height / 128.0f) * 0.55f + 0.6f;
+#endif
+}
+
 // Tables for properties of all body types supported.
 static const rio::Vector3f cBodyTypeHeadRotation[BODY_TYPE_MAX] = {
     cMiiBodyMiddleBodyHeadRotation, // BODY_TYPE_WIIU_MIIBODYMIDDLE
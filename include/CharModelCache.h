@@ -0,0 +1,82 @@
+#pragma once
+
+#include <nn/ffl.h>
+
+#include <string>
+#include <vector>
+
+class IShader;
+class Model;
+
+// how many models the cache holds on to, in use or not
+#define CHAR_MODEL_CACHE_SIZE_DEFAULT 16
+
+// Everything that decides which textures and shapes
+// FFLInitCharModelCPUStep/GPUStep make for a model.
+struct CharModelCacheKey
+{
+    u64             charInfo;          // getCharInfoFingerprint
+    u32             expressionFlag[3]; // FFLAllExpressionFlag
+    u32             resolution;        // FFLResolution, mipmap bit included
+    u32             modelFlag;
+    FFLResourceType resourceType;
+    const IShader*  pTextureShader;    // IShader::getTextureShader
+};
+
+// Initialized models by what they were made from. FFLInitCharModelGPUStep
+// renders the faceline and one mask per expression, which costs about as
+// much as the final draw at high texResolution. Requests for the same Mii
+// with a different shader, body or view get the same model back instead,
+// so its textures are shared and not rendered again.
+// Models are reference counted and the least recently used one that is
+// not in use goes when the cache is full. Only the render thread uses it.
+class CharModelCache
+{
+public:
+    explicit CharModelCache(u32 maxSize = CHAR_MODEL_CACHE_SIZE_DEFAULT);
+    // frees the models, so it has to happen before FFLExit
+    ~CharModelCache() { clear(); }
+
+    // 0 = keep no models around after they are released
+    void setMaxSize(u32 maxSize);
+    u32 getMaxSize() const { return mMaxSize; }
+    u32 getSize() const { return static_cast<u32>(mEntries.size()); }
+
+    // Model with another reference on it, nullptr if there is none yet.
+    Model* acquire(const CharModelCacheKey& key);
+    // Adds a model that was just initialized, with one reference for
+    // the caller. Models that do not fit are only freed on release.
+    void insert(const CharModelCacheKey& key, Model* pModel);
+    // Drops a reference. Models that were never inserted go back to
+    // ModelPool right away, so it can replace every free of a model.
+    // nullptr is ignored.
+    void release(Model* pModel);
+    // Frees every model that is not in use.
+    void clear();
+    // Frees the least recently used model that is not in use,
+    // false if there was none.
+    bool evictLeastRecentlyUsed();
+
+    // Prometheus text format, for RENDER_REQUEST_V2_FLAG_METRICS.
+    std::string formatMetrics() const;
+
+private:
+    // drops unused models, least recently used first, until it fits
+    void evict_(u32 maxSize);
+
+    struct Entry
+    {
+        CharModelCacheKey key;
+        Model*            pModel;
+        u32               refCount;
+        u64               lastUse; // mUseCounter when last acquired
+    };
+
+    std::vector<Entry> mEntries; // only a few, searched in order
+    u32 mMaxSize;
+    u64 mUseCounter;
+
+    u64 mHitCount;
+    u64 mMissCount;
+    u64 mEvictCount;
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <nn/ffl.h>
+#include <nn/ffl/detail/FFLiCharInfo.h>
+
+#include <RenderRequest.h>
+
+// length of the hex string written by formatRenderFingerprint
+#define RENDER_FINGERPRINT_STRING_LENGTH 32
+
+// Identifies what a request renders, independent of which
+// format the Mii data came in (studio, store data, RFL...).
+// Two requests with equal fingerprints produce the same output,
+// so it can be used as a cache key or the HTTP ETag.
+struct RenderFingerprint
+{
+    u64 charInfo; // visual fields of the decoded CharInfo
+    u64 request;  // request fields that change the output
+};
+
+// Hashes only what changes how the Mii looks: no name, creator
+// ID, birthday, create ID... Colors are normalized to common
+// colors so ver3 and NX data of the same Mii match.
+u64 getCharInfoFingerprint(const FFLiCharInfo* pCharInfo);
+
+// Hashes every request field except for the Mii data itself
+// and the verification flags, which only decide if it renders.
+u64 getRenderRequestFingerprint(const RenderRequest* pRequest);
+
+RenderFingerprint makeRenderFingerprint(const FFLiCharInfo* pCharInfo, const RenderRequest* pRequest);
+
+// Writes the fingerprint as RENDER_FINGERPRINT_STRING_LENGTH
+// lowercase hex characters, not null terminated.
+void formatRenderFingerprint(char* dest, const RenderFingerprint& fingerprint);
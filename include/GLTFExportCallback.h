@@ -13,6 +13,9 @@
 // Include TinyGLTF
 #include "for_gltf/tiny_gltf.h"
 
+#include <gfx/mdl/rio_Model.h>
+#include <math/rio_MathTypes.h>
+
 class GLTFExportCallback
 {
 public:
@@ -45,6 +48,100 @@ public:
         mpCharModel = pCharModel;
     }
 
+    /**
+     * @brief Formats that textures can be embedded in.
+     */
+    enum ImageFormat {
+        IMAGE_FORMAT_PNG,  ///< PNG only (default)
+        IMAGE_FORMAT_KTX2  ///< KTX2 via KHR_texture_basisu, with PNG as the fallback source
+    };
+
+    /**
+     * @brief Sets the format that textures are embedded in.
+     *
+     * KTX2 needs the program to be built with USE_BASISU, otherwise only PNGs are written.
+     *
+     * @param format The image format to use.
+     */
+    void SetImageFormat(ImageFormat format)
+    {
+        mImageFormat = format;
+    }
+
+    /**
+     * @brief Enables KHR_mesh_quantization for exported meshes.
+     *
+     * Positions are written as int16 with the dequantization in the node transform,
+     * normals and tangents as snorm8 and texture coordinates as unorm16.
+     *
+     * @param enable Whether to quantize vertex attributes.
+     */
+    void SetMeshQuantization(bool enable)
+    {
+        mQuantizeMeshes = enable;
+    }
+
+    /**
+     * @brief Vertex and index data of a static model (body, hat) encoded once at startup.
+     *
+     * The data is laid out exactly as it appears in the glTF buffer, so
+     * exports reference it in place instead of encoding it for every request.
+     */
+    struct StaticMesh {
+        /**
+         * @brief Byte offsets into data for one mesh of the model.
+         */
+        struct Primitive {
+            size_t positionOffset;             ///< Offset of the float positions
+            size_t normalOffset;               ///< Offset of the float normals
+            size_t indexOffset;                ///< Offset of the uint32 indices
+            uint32_t vertexCount;              ///< Amount of vertices
+            uint32_t indexCount;               ///< Amount of indices
+            std::vector<double> minPosition;   ///< Minimum position, for the accessor
+            std::vector<double> maxPosition;   ///< Maximum position, for the accessor
+        };
+
+        std::vector<unsigned char> data;       ///< Positions, normals and indices of every primitive, 4 byte aligned
+        std::vector<Primitive> primitives;     ///< One entry per mesh in the model
+    };
+
+    /**
+     * @brief Encodes the meshes of a static model into the layout used by glTF buffers.
+     *
+     * @param resModel The model resource to encode.
+     * @param staticMesh Receives the encoded data.
+     */
+    static void EncodeStaticMesh(const rio::mdl::res::Model& resModel, StaticMesh& staticMesh);
+
+    /**
+     * @brief Adds a body under the head, scaled by the body scale.
+     *
+     * Even meshes use the body color and odd meshes are the pants.
+     *
+     * @param pBodyMesh The encoded body model, which must outlive the export.
+     * @param bodyScale The scale from BodyModel::calcBodyScale.
+     * @param bodyColor The body (favorite) color.
+     * @param pPantsColor The pants color, or nullptr to leave the pants out.
+     */
+    void SetBody(const StaticMesh* pBodyMesh, const rio::Vector3f& bodyScale, const FFLColor& bodyColor, const FFLColor* pPantsColor);
+
+    /**
+     * @brief Sets the transform of the head node, which parents the FFL meshes.
+     *
+     * @param rotation Euler rotation of the head in radians.
+     * @param translation Translation of the head relative to the body.
+     */
+    void SetHeadTransform(const rio::Vector3f& rotation, const rio::Vector3f& translation);
+
+    /**
+     * @brief Adds a hat as a child of the head node.
+     *
+     * @param pHatMesh The encoded hat model, which must outlive the export.
+     * @param translation The hat translation from FFLGetPartsTransform.
+     * @param hatColor The color of the hat.
+     */
+    void SetHat(const StaticMesh* pHatMesh, const rio::Vector3f& translation, const FFLColor& hatColor);
+
     /**
      * @brief Exports the collected model data to a GLTF file.
      *
@@ -69,6 +166,15 @@ public:
         return ExportModelInternal("", outStream);
     }
 
+    /**
+     * @brief Exports the collected model data as a GLB directly to a socket.
+     *
+     * @param socket The socket handle to write the GLB data to.
+     * @return true If the export was successful.
+     * @return false If the export or sending failed.
+     */
+    bool ExportModelToSocket(int socket);
+
     // Data structures to collect the mesh data
     struct MeshData {
         std::vector<float> positions;        ///< Vertex positions (x, y, z)
@@ -85,9 +191,38 @@ public:
         std::array<float, 4> colorR;         ///< RGBA color factor
         rio::Texture2D* texture;             ///< Pointer to the associated texture
         FFLCullMode cullMode;                ///< Culling mode
+
+        MeshData() = default;
+        // Move-only, so that the vertex data is never copied by accident
+        MeshData(MeshData&&) = default;
+        MeshData& operator=(MeshData&&) = default;
+        MeshData(const MeshData&) = delete;
+        MeshData& operator=(const MeshData&) = delete;
     };
 
 private:
+    /**
+     * @brief Encoded image data for a single texture.
+     */
+    struct EncodedTexture {
+        std::vector<unsigned char> pngData;  ///< PNG image, always present
+        std::vector<unsigned char> ktx2Data; ///< KTX2 image, empty unless requested and encoded
+    };
+
+    /**
+     * @brief A texture that gets read back and encoded ahead of building the model.
+     */
+    struct TextureEncodeJob {
+        rio::Texture2D* texture;             ///< Texture to read back
+        const MeshData* pMeshData;           ///< Mesh whose modulate mode is applied, nullptr for mask textures
+        u32 pbo = 0;                         ///< Pixel buffer object the texture is read into, unused with USE_EGL_HEADLESS
+        int width = 0;                       ///< Texture width
+        int height = 0;                      ///< Texture height
+        int channels = 0;                    ///< Bytes per pixel of the readback
+        const unsigned char* pMapped = nullptr; ///< Mapped PBO contents
+        EncodedTexture encoded;              ///< Encoded images, PNG is empty if encoding failed
+    };
+
     // Static callback functions matching FFLShaderCallback's function pointer types
 
     /**
@@ -121,6 +256,29 @@ private:
      */
     bool ExportModelInternal(const std::string& filename, std::ostream* outStream);
 
+    /**
+     * @brief Builds the GLTF model from the collected data, without adding the buffer itself.
+     *
+     * @param model The GLTF model to construct.
+     * @param bufferData Receives the binary data that buffer 0 should contain.
+     */
+    void BuildModel(tinygltf::Model& model, std::vector<unsigned char>& bufferData);
+
+    /**
+     * @brief Adds the nodes for a static mesh, referencing its data after the buffer.
+     *
+     * The data itself is not copied, it is recorded in mSplicedMeshes
+     * and has to be appended to the buffer when writing it out.
+     *
+     * @param pStaticMesh The encoded static model.
+     * @param colors The base color of each primitive, alpha 0 leaves it out.
+     * @param name The name of the node.
+     * @param model The GLTF model being constructed.
+     * @param bufferEnd The end of the buffer data so far, advanced past the static data.
+     * @return int The index of the new node.
+     */
+    int AddStaticMeshNode(const StaticMesh* pStaticMesh, const std::vector<FFLColor>& colors, const std::string& name, tinygltf::Model& model, size_t& bufferEnd);
+
     // Helper functions for processing and exporting model data
 
     /**
@@ -133,6 +291,57 @@ private:
      */
     static void UnpackNormal_10_10_10_2(uint32_t packed, float& x, float& y, float& z);
 
+    /**
+     * @brief Copies a float vertex attribute into a tightly packed array.
+     *
+     * @param src The start of the attribute buffer.
+     * @param stride The stride of the attribute buffer in bytes.
+     * @param vertexCount The amount of vertices to copy.
+     * @param componentCount The amount of floats per vertex.
+     * @param out The destination, vertexCount * componentCount floats.
+     */
+    static void DecodeFloatAttribute(const uint8_t* src, uint32_t stride, uint32_t vertexCount, uint32_t componentCount, float* out);
+
+    /**
+     * @brief Unpacks a buffer of 10_10_10_2 packed normals, four at a time where SSE2 is available.
+     *
+     * @param src The start of the attribute buffer.
+     * @param stride The stride of the attribute buffer in bytes.
+     * @param vertexCount The amount of normals to unpack.
+     * @param out The destination, vertexCount * 3 floats.
+     */
+    static void DecodeNormals_10_10_10_2(const uint8_t* src, uint32_t stride, uint32_t vertexCount, float* out);
+
+    /**
+     * @brief Converts and normalizes a buffer of signed 8-bit tangents.
+     *
+     * Tangents with a w of zero are skipped, leaving the output untouched.
+     *
+     * @param src The start of the attribute buffer.
+     * @param stride The stride of the attribute buffer in bytes.
+     * @param vertexCount The amount of tangents to convert.
+     * @param out The destination, vertexCount * 4 floats.
+     */
+    static void DecodeTangents(const uint8_t* src, uint32_t stride, uint32_t vertexCount, float* out);
+
+    /**
+     * @brief Copies a buffer of R8G8B8A8 vertex colors, where a stride of 0 repeats one color.
+     *
+     * @param src The start of the attribute buffer.
+     * @param stride The stride of the attribute buffer in bytes.
+     * @param vertexCount The amount of colors to copy.
+     * @param out The destination, vertexCount * 4 bytes.
+     */
+    static void DecodeColors(const uint8_t* src, uint32_t stride, uint32_t vertexCount, uint8_t* out);
+
+    /**
+     * @brief Converts an Euler rotation, applied X then Y then Z, to a glTF quaternion.
+     *
+     * @param rotation The rotation in radians.
+     * @return std::vector<double> The quaternion as x, y, z, w.
+     */
+    static std::vector<double> EulerToQuaternion(const rio::Vector3f& rotation);
+
     /**
      * @brief Maps the internal primitive mode to TinyGLTF's primitive mode.
      *
@@ -150,16 +359,34 @@ private:
     static float SRGBToLinear(float color);
 
     /**
-     * @brief Extracts texture data from a Texture2D object and converts it to RGBA format.
+     * @brief Expands pixels read back from a texture into RGBA format.
+     *
+     * @param pixels The pixel data as read back from the texture.
+     * @param channels The amount of bytes per pixel in the source data.
+     * @param pixelCount The amount of pixels to convert.
+     * @param rgbaData Vector to store the RGBA data.
+     */
+    static void ConvertPixelsToRGBA(const unsigned char* pixels, int channels, int pixelCount, std::vector<unsigned char>& rgbaData);
+
+    /**
+     * @brief Reads back and encodes every texture used by the export to PNG.
+     *
+     * Readbacks are issued together through PBOs, then the conversion and PNG encoding
+     * run on the thread pool. With USE_EGL_HEADLESS the readbacks run on the pool too,
+     * each worker through its own shared context. Results are stored in mEncodedTextures.
+     */
+    void EncodeTextures();
+
+    /**
+     * @brief Converts, modulates and encodes one texture read back by EncodeTextures.
+     *
+     * Makes no GL calls, so it can run on any thread.
      *
-     * @param texture Pointer to the Texture2D object.
-     * @param rgbaData Vector to store the extracted RGBA data.
-     * @param width Pointer to store the texture width.
-     * @param height Pointer to store the texture height.
-     * @return true If the extraction was successful.
-     * @return false If the extraction failed.
+     * @param job The job to encode, its size and channels must be set.
+     * @param pixels The pixels read back from the texture.
+     * @param wantKTX2 Whether to encode a KTX2 image besides the PNG.
      */
-    static bool ExtractTextureToRGBA(rio::Texture2D* texture, std::vector<unsigned char>& rgbaData, int* width, int* height);
+    void EncodeTextureJob(TextureEncodeJob& job, const unsigned char* pixels, bool wantKTX2);
 
     /**
      * @brief Encodes RGBA data into PNG format using stb_image_write.
@@ -173,6 +400,47 @@ private:
      */
     static bool EncodeRGBADataToPNG(const std::vector<unsigned char>& rgbaData, int width, int height, std::vector<unsigned char>& pngData);
 
+    /**
+     * @brief Encodes RGBA data into a UASTC KTX2 file using basis_universal.
+     *
+     * @param rgbaData The RGBA pixel data to encode.
+     * @param width The width of the image.
+     * @param height The height of the image.
+     * @param ktx2Data Vector to store the encoded KTX2 data.
+     * @return true If encoding was successful.
+     * @return false If encoding failed or USE_BASISU is not enabled.
+     */
+    static bool EncodeRGBADataToKTX2(const std::vector<unsigned char>& rgbaData, int width, int height, std::vector<unsigned char>& ktx2Data);
+
+    /**
+     * @brief Hashes RGBA data and its dimensions as the key for the encoded image cache.
+     *
+     * @param rgbaData The RGBA pixel data.
+     * @param width The width of the image.
+     * @param height The height of the image.
+     * @return u64 The content hash.
+     */
+    static u64 HashImageData(const std::vector<unsigned char>& rgbaData, int width, int height);
+
+    /**
+     * @brief Looks up a previously encoded image in the cache shared between exports.
+     *
+     * @param hash The content hash from HashImageData.
+     * @param format The format the image was encoded to.
+     * @param pData Receives a copy of the encoded data on a hit.
+     * @return true If the image was found.
+     */
+    static bool LookupEncodedImage(u64 hash, ImageFormat format, std::vector<unsigned char>* pData);
+
+    /**
+     * @brief Stores an encoded image in the cache shared between exports.
+     *
+     * @param hash The content hash from HashImageData.
+     * @param format The format the image was encoded to.
+     * @param data The encoded image data.
+     */
+    static void StoreEncodedImage(u64 hash, ImageFormat format, const std::vector<unsigned char>& data);
+
     /**
      * @brief Converts an FFLVec3 structure to a tinygltf::Value array.
      *
@@ -192,6 +460,43 @@ private:
      */
     void ProcessMeshAttributes(MeshData& meshData, tinygltf::Model& model, std::vector<unsigned char>& bufferData, size_t& bufferSize, tinygltf::Primitive& primitive);
 
+    /**
+     * @brief Remaps vertices into the order they are first referenced by the indices.
+     *
+     * @param meshData The mesh data to reorder in place.
+     */
+    static void ReorderVerticesForFetch(MeshData& meshData);
+
+    /**
+     * @brief Processes mesh attributes with KHR_mesh_quantization and adds them to the GLTF primitive.
+     *
+     * @param meshData The mesh data to process.
+     * @param model The GLTF model being constructed.
+     * @param bufferData The buffer data being accumulated.
+     * @param bufferSize The current size of the buffer.
+     * @param primitive The GLTF primitive to which attributes will be added.
+     * @param node The node for this mesh, which receives the dequantization transform.
+     */
+    void ProcessMeshAttributesQuantized(MeshData& meshData, tinygltf::Model& model, std::vector<unsigned char>& bufferData, size_t& bufferSize, tinygltf::Primitive& primitive, tinygltf::Node& node);
+
+    /**
+     * @brief Adds a quantized vertex attribute, padding each element to 4 bytes as glTF requires.
+     *
+     * @tparam T The component type of the vertex attribute.
+     * @param data The tightly packed vertex attribute data.
+     * @param componentCount The amount of components per vertex.
+     * @param model The GLTF model being constructed.
+     * @param bufferData The buffer data being accumulated.
+     * @param bufferSize The current size of the buffer.
+     * @param primitive The GLTF primitive to which the attribute will be added.
+     * @param attributeName The name of the attribute (e.g., "POSITION", "NORMAL").
+     * @param type The GLTF type of the attribute (e.g., TINYGLTF_TYPE_VEC3).
+     * @param componentType The GLTF component type (e.g., TINYGLTF_COMPONENT_TYPE_SHORT).
+     * @param normalized Whether the attribute data should be normalized.
+     */
+    template <typename T>
+    void AddQuantizedAttributeToBuffer(const std::vector<T>& data, size_t componentCount, tinygltf::Model& model, std::vector<unsigned char>& bufferData, size_t& bufferSize, tinygltf::Primitive& primitive, const std::string& attributeName, int type, int componentType, bool normalized);
+
     /**
      * @brief Adds a vertex attribute to the GLTF buffer and primitive.
      *
@@ -255,7 +560,7 @@ private:
      * @param meshData The mesh data containing modulation parameters.
      * @param rgbaData The RGBA texture data to modify.
      */
-    void ApplyModulateMode(MeshData& meshData, std::vector<unsigned char>& rgbaData);
+    void ApplyModulateMode(const MeshData& meshData, std::vector<unsigned char>& rgbaData);
 
     /**
      * @brief Adds a PNG-encoded image to the GLTF model's buffer and returns its index.
@@ -263,11 +568,24 @@ private:
      * @param model The GLTF model being constructed.
      * @param bufferData The buffer data being accumulated.
      * @param bufferSize The current size of the buffer.
-     * @param pngData The PNG-encoded image data.
+     * @param pngData The encoded image data.
      * @param imageName The name to assign to the image.
+     * @param mimeType The MIME type of the encoded image data.
      * @return int The index of the added image in the model's images array.
      */
-    int AddImageToModel(tinygltf::Model& model, std::vector<unsigned char>& bufferData, size_t& bufferSize, const std::vector<unsigned char>& pngData, const std::string& imageName);
+    int AddImageToModel(tinygltf::Model& model, std::vector<unsigned char>& bufferData, size_t& bufferSize, const std::vector<unsigned char>& pngData, const std::string& imageName, const char* mimeType = "image/png");
+
+    /**
+     * @brief Adds an encoded texture to the GLTF model, with its KTX2 variant if one was encoded.
+     *
+     * @param model The GLTF model being constructed.
+     * @param bufferData The buffer data being accumulated.
+     * @param bufferSize The current size of the buffer.
+     * @param encoded The encoded image data for this texture.
+     * @param imageName The name to assign to the image(s).
+     * @return int The index of the added texture in the model's textures array.
+     */
+    int AddEncodedTextureToModel(tinygltf::Model& model, std::vector<unsigned char>& bufferData, size_t& bufferSize, const EncodedTexture& encoded, const std::string& imageName);
 
     /**
      * @brief Adds a texture to the GLTF model using the provided image index.
@@ -333,10 +651,38 @@ private:
      */
     bool WriteModelToFileOrStream(const tinygltf::Model& model, const std::string& filename, std::ostream* outStream);
 
+    /**
+     * @brief Writes the GLTF model as a GLB to a socket, using bufferData as the BIN chunk.
+     *
+     * @param model The GLTF model to write, which must not contain any buffers.
+     * @param bufferData The buffer data that all buffer views refer to as buffer 0,
+     *                   followed by the data of mSplicedMeshes.
+     * @param socket The socket handle to write to.
+     * @return true If writing was successful.
+     * @return false If writing failed.
+     */
+    bool WriteGLBToSocket(const tinygltf::Model& model, const std::vector<unsigned char>& bufferData, int socket);
+
     FFLCharModel* mpCharModel;                ///< Pointer to the character model
 
     std::vector<MeshData> mMeshes;            ///< Collection of meshes to be exported
 
     // Texture management
     std::unordered_map<rio::Texture2D*, int> mTextureMap; ///< Maps Texture2D pointers to GLTF texture indices
+    std::unordered_map<rio::Texture2D*, EncodedTexture> mEncodedTextures; ///< Image data for each texture, filled by EncodeTextures
+    ImageFormat mImageFormat;                 ///< Format textures are embedded in
+    bool mQuantizeMeshes;                     ///< Whether KHR_mesh_quantization is used
+
+    // Body and hat
+    const StaticMesh* mpBodyMesh;             ///< Encoded body model, nullptr for head only
+    rio::Vector3f mBodyScale;                 ///< Scale of the body node
+    FFLColor mBodyColor;                      ///< Base color of the body
+    FFLColor mPantsColor;                     ///< Base color of the pants, alpha 0 when not drawn
+    bool mHasHeadTransform;                   ///< Whether the head node is transformed
+    rio::Vector3f mHeadRotation;              ///< Euler rotation of the head node
+    rio::Vector3f mHeadTranslation;           ///< Translation of the head node
+    const StaticMesh* mpHatMesh;              ///< Encoded hat model, nullptr for no hat
+    rio::Vector3f mHatTranslation;            ///< Translation of the hat node
+    FFLColor mHatColor;                       ///< Base color of the hat
+    std::vector<const StaticMesh*> mSplicedMeshes; ///< Static data placed after the buffer, in order
 };
@@ -17,6 +17,11 @@ public:
 
     void initialize(Model* pModel, uint8_t hatColor);
 
+    const FFLColor& getHatColor() const
+    {
+        return mHatColor;
+    }
+
     void draw(rio::Matrix34f& model_mtx, rio::BaseMtx34f& view_mtx,
     rio::BaseMtx44f& proj_mtx);
 
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <rio.h>
+
+#ifdef USE_EGL_HEADLESS
+
+#include <EGL/egl.h>
+
+// OpenGL context without a window system, for the server. The display
+// is a GPU from EGL_EXT_platform_device when there is one, otherwise
+// EGL_MESA_platform_surfaceless, which falls back to llvmpipe. Contexts
+// have no surface at all, everything renders into FBOs (RenderTexture).
+//
+// rio still makes its own window first. Build rio with RIO_USE_OSMESA
+// so that this is an OSMesa context and nothing needs X11, without it
+// GLFW opens a real window and a display is still required. Either way
+// that context is never drawn to after initialize, so server mode is
+// forced. Worker threads get their own contexts that share objects
+// with the render thread's, see makeCurrentOnThisThread.
+class HeadlessEGL
+{
+public:
+    // Makes the render thread's context current in place of the window's
+    // and loads the GL functions through EGL. False if nothing works.
+    static bool initialize();
+    static void finalize();
+
+    // Makes the EGL context current again if anything else was made
+    // current since, like rio's window context. Called every frame
+    // before any GL, false if it could not be restored.
+    static bool makeCurrent();
+
+    // Gives the calling thread its own context that shares textures and
+    // buffers with the render thread's, made the first time a thread
+    // calls this and destroyed when the thread exits. Objects drawn by
+    // the render thread need a glFinish there before a worker reads
+    // them. On the render thread itself this keeps its own context.
+    static bool makeCurrentOnThisThread();
+    // Destroys the calling thread's context early, the thread can
+    // call makeCurrentOnThisThread again for a new one.
+    static void releaseThisThread();
+
+    // driver name (EGL_MESA_query_driver) or EGL_VENDOR, for logging.
+    static const char* getDeviceName() { return sDeviceName; }
+
+private:
+    static bool initializeDisplay_();
+    static EGLContext createContext_(EGLContext shareContext);
+
+    static EGLDisplay  sDisplay;
+    static EGLConfig   sConfig;
+    static EGLContext  sContext; // the render thread's
+    static const char* sDeviceName;
+};
+
+#endif // USE_EGL_HEADLESS
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <gpu/rio_Shader.h>
+#include <gpu/rio_TextureSampler.h>
 #include <nn/ffl.h>
 #include <nn/ffl/FFLiCharModel.h>
 
@@ -14,6 +15,67 @@
 
 #include <PantsColor.h> // make available to shaders
 
+#include <cstring>
+
+// Last values set on the uniforms of one program, so that setting
+// a uniform to the value it already has can be skipped. Uniform
+// values stay with the program when another one is bound, so this
+// is kept per program and never has to be cleared after linking.
+class UniformCache
+{
+public:
+    UniformCache()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        for (u32 i = 0; i < cMaxLocations; i++)
+        {
+            mVertex[i].size = 0;
+            mPixel[i].size = 0;
+        }
+    }
+
+    // Remembers the value and returns true if it has to be set,
+    // false if the uniform at this location already has it.
+    // Locations out of range are never cached.
+    template <typename T>
+    bool update(u32 vs_loc, u32 ps_loc, const T& value)
+    {
+        static_assert(sizeof(T) <= cMaxValueSize, "uniform too large to cache");
+
+        Entry* pEntry;
+        if (vs_loc < cMaxLocations)
+            pEntry = &mVertex[vs_loc];
+        else if (ps_loc < cMaxLocations)
+            pEntry = &mPixel[ps_loc];
+        else
+            return true;
+
+        if (pEntry->size == sizeof(T) && std::memcmp(pEntry->value, &value, sizeof(T)) == 0)
+            return false;
+
+        pEntry->size = sizeof(T);
+        std::memcpy(pEntry->value, &value, sizeof(T));
+        return true;
+    }
+
+private:
+    static constexpr u32 cMaxLocations = 64;
+    static constexpr u32 cMaxValueSize = sizeof(rio::BaseMtx44f);
+
+    struct Entry
+    {
+        u32 size; // 0 = unknown
+        u8  value[cMaxValueSize];
+    };
+
+    Entry mVertex[cMaxLocations];
+    Entry mPixel[cMaxLocations];
+};
+
 class IShader
 {
 public:
@@ -29,7 +91,43 @@ public:
     virtual void applyAlphaTest(bool enable, rio::Graphics::CompareFunc func, f32 ref) const = 0;
     virtual void applyAlphaTestEnable() const = 0;
     virtual void applyAlphaTestDisable() const = 0;
-    // static method which means it's not here i guess
-    // actually this is only called inside for now so shouldn't it be private
-    //virtual void setCulling(FFLCullMode mode) = 0;
+
+    // Shader that draws the faceline and mask textures while the
+    // model is initialized. Models made with the same one have the
+    // same textures, so they can be shared between shaders.
+    virtual const IShader* getTextureShader() const { return this; }
+
+    // Skipped if the shaders already set the same cull mode.
+    static void setCulling(FFLCullMode mode);
+
+    // State the shaders last bound, only touched on the render thread.
+    enum BoundState
+    {
+        BOUND_STATE_PROGRAM      = 1 << 0,
+        BOUND_STATE_VERTEX_ARRAY = 1 << 1,
+        BOUND_STATE_TEXTURE      = 1 << 2,
+        BOUND_STATE_CULL_MODE    = 1 << 3,
+        BOUND_STATE_ALL          = 0xf
+    };
+
+    // Anything that binds a program, VAO or texture or sets
+    // culling without going through the shaders has to call
+    // this afterwards, or the next bind may be skipped wrongly.
+    static void forgetBoundState(u32 states = BOUND_STATE_ALL);
+
+protected:
+    // These only make the GL calls if the state is different
+    // from what the last call through any shader set.
+    static void bindProgram_(rio::Shader* pProgram);
+#if RIO_IS_WIN
+    static void bindVertexArray_(u32 handle);
+#endif
+    static void bindSamplerTexture_(rio::TextureSampler2D& sampler, const rio::Texture2D* pTexture, s32 location, u32 slot);
+
+    template <typename T>
+    static void setUniform_(rio::Shader* pProgram, UniformCache& cache, const T& value, u32 vs_loc, u32 ps_loc)
+    {
+        if (cache.update(vs_loc, ps_loc, value))
+            pProgram->setUniform(value, vs_loc, ps_loc);
+    }
 };
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <nn/ffl.h>
+#include <nn/ffl/detail/FFLiCharInfo.h>
+
+#include <Types.h>
+
+// one input record, data is not copied
+struct MiiDataBatchRecord
+{
+    const void* data;
+    u32         dataLength;
+};
+
+struct MiiDataBatchOptions
+{
+    bool verifyCRC16;    // passed to pickupCharInfoFromData
+    bool verifyCharInfo; // run FFLiVerifyCharInfoWithReason
+    // INPUT_TYPE_* to skip detection, or -1 to pick from dataLength
+    s32  inputType;
+};
+
+struct MiiDataBatchResult
+{
+    FFLiCharInfo             charInfo;
+    FFLResult                result;       // FFL_RESULT_OK if decoded
+    FFLiVerifyCharInfoReason verifyReason; // only set when verifying
+};
+
+// Decodes (and optionally verifies) every record into
+// results[i], spread across the shared ThreadPool.
+// Nothing here touches GL, so it works without RIO
+// being initialized. Returns the amount of records
+// that decoded and verified successfully.
+u32 pickupCharInfoBatch(const MiiDataBatchRecord* records, u32 count,
+                        MiiDataBatchResult* results,
+                        const MiiDataBatchOptions& options);
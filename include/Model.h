@@ -26,8 +26,14 @@ public:
 
     template <typename T>
     bool initialize(const InitArg<T>& arg, IShader& shader);
+    // Deletes the CharModel and goes back to how the constructor left
+    // it, so that ModelPool can initialize it again. The FFLCharModel
+    // itself is kept.
+    void finalize();
 
     FFLCharModel* getCharModel() const { return mpCharModel; }
+    // as it was made, after TextureMemory lowered the resolution
+    const FFLCharModelDesc& getCharModelDesc() const { return mCharModelDesc; }
     FFLPartsTransform getPartsTransform() const
     {
         FFLPartsTransform partsTransform;
@@ -40,6 +46,9 @@ public:
         return &pCharModel->charInfo;
     }
     IShader* getShader() const { return mpShader; }
+    // for a model from CharModelCache, drawing with another
+    // shader than the one that drew its textures is fine
+    void setShader(IShader& shader) { mpShader = &shader; }
     FFLResult getInitializeCpuResult() const { return mInitializeCpuResult; }
 
     void enableSpecialDraw();
@@ -102,6 +111,7 @@ private:
     bool                mLightEnable;
     bool                mIsInitialized;
     FFLResult           mInitializeCpuResult;
+    u64                 mTextureMemorySize; // counted in TextureMemory
 };
 
 template <typename T>
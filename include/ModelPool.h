@@ -0,0 +1,45 @@
+#pragma once
+
+#include <rio.h>
+
+#include <string>
+#include <vector>
+
+class Model;
+
+// how many finalized models are kept around for reuse
+#define MODEL_POOL_SIZE_DEFAULT 8
+
+// Models that are done being used, finalized and kept so that the
+// next request reuses the Model and its FFLCharModel storage instead
+// of allocating them again. What FFL allocates for the CharModel is
+// not pooled, there is no arena for it, finalize frees all of it.
+// Only the render thread uses it.
+class ModelPool
+{
+public:
+    static ModelPool& instance();
+
+    explicit ModelPool(u32 maxFree = MODEL_POOL_SIZE_DEFAULT);
+    ~ModelPool();
+
+    // 0 = delete every model right away
+    void setMaxFree(u32 maxFree);
+
+    // A model that is not initialized yet.
+    Model* alloc();
+    // Finalizes the model and keeps it for alloc. nullptr is ignored.
+    void free(Model* pModel);
+
+    // Prometheus text format, for RENDER_REQUEST_V2_FLAG_METRICS.
+    std::string formatMetrics() const;
+
+private:
+    std::vector<Model*> mFree;
+    u32 mMaxFree;
+
+    u32 mLiveCount;     // allocated and not freed
+    u32 mPeakLiveCount;
+    u64 mAllocCount;
+    u64 mReuseCount;    // allocs that came from mFree
+};
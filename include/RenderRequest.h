@@ -48,5 +48,149 @@ PACKED(struct RenderRequest {
     uint8_t  instanceCount;  // for instanceCountNewRender loop
     uint8_t  instanceRotationMode; // model, camera, TODO
     int16_t  lightDirection[3];    // unset if all negative, TODO
-    uint8_t  splitMode;      // none (default), front, back, both
+    // SplitMode: none (default), front, back, or both with front above
+    // back. With instanceCount > 1 every instance has both layers, top to
+    // bottom: inst0 front, inst0 back, inst1 front, inst1 back, and so on.
+    // Out of range values are treated as none.
+    uint8_t  splitMode;
 });
+
+// ----------- Version 2 -----------
+
+// v1 is exactly a RenderRequest and nothing else. v2 starts with
+// RenderRequestHeaderV2, followed by bodySize bytes of fields that
+// are each a RenderRequestFieldHeaderV2 and then the value. Values
+// are little endian and the same size as the RenderRequest member.
+// Unknown tags are skipped, so new fields can be sent to an older
+// renderer, and fields that are not sent keep their defaults.
+
+#define RENDER_REQUEST_V2_MAGIC   0x51524646 // "FFRQ" as little endian
+#define RENDER_REQUEST_VERSION_2  2
+
+// Anything over this is rejected before reading the body.
+// Fits a full batch of the largest Mii data.
+#define RENDER_REQUEST_V2_MAX_BODY_SIZE (32 * 1024)
+
+// Most Miis in one batch request.
+#define RENDER_REQUEST_BATCH_MAX 256
+
+PACKED(struct RenderRequestHeaderV2 {
+    uint32_t magic;    // RENDER_REQUEST_V2_MAGIC
+    uint16_t version;  // RENDER_REQUEST_VERSION_2
+    uint16_t flags;    // RenderRequestFlagV2
+    uint32_t bodySize; // size of all fields after this header
+});
+
+enum RenderRequestFlagV2
+{
+    // Not a render: the response is the server metrics
+    // as Prometheus text, answered without queueing.
+    RENDER_REQUEST_V2_FLAG_METRICS = 1 << 0,
+    // TGA responses carry the render fingerprint as a 32 character
+    // image ID (idLength = 32) between the header and the pixels.
+    // Without it idLength is 0, which is all v1 gets.
+    RENDER_REQUEST_V2_FLAG_IMAGE_ID = 1 << 1,
+};
+
+PACKED(struct RenderRequestFieldHeaderV2 {
+    uint16_t tag;      // RenderRequestTag
+    uint16_t length;   // size of the value after this
+});
+
+// Field tags, one per RenderRequest member. Never reuse a number.
+enum RenderRequestTag
+{
+    RENDER_REQUEST_TAG_DATA                   = 1, // variable, also sets dataLength
+    RENDER_REQUEST_TAG_MODEL_FLAG             = 2,
+    RENDER_REQUEST_TAG_RESPONSE_FORMAT        = 3,
+    RENDER_REQUEST_TAG_RESOLUTION             = 4,
+    RENDER_REQUEST_TAG_TEX_RESOLUTION         = 5, // defaults to resolution
+    RENDER_REQUEST_TAG_VIEW_TYPE              = 6,
+    RENDER_REQUEST_TAG_RESOURCE_TYPE          = 7,
+    RENDER_REQUEST_TAG_SHADER_TYPE            = 8,
+    RENDER_REQUEST_TAG_EXPRESSION             = 9,
+    RENDER_REQUEST_TAG_EXPRESSION_FLAG        = 10,
+    RENDER_REQUEST_TAG_CAMERA_ROTATE          = 11,
+    RENDER_REQUEST_TAG_MODEL_ROTATE           = 12,
+    RENDER_REQUEST_TAG_BACKGROUND_COLOR       = 13,
+    RENDER_REQUEST_TAG_AA_METHOD              = 14,
+    RENDER_REQUEST_TAG_DRAW_STAGE_MODE        = 15,
+    RENDER_REQUEST_TAG_VERIFY_CHAR_INFO       = 16,
+    RENDER_REQUEST_TAG_VERIFY_CRC16           = 17,
+    RENDER_REQUEST_TAG_LIGHT_ENABLE           = 18,
+    RENDER_REQUEST_TAG_CLOTHES_COLOR          = 19,
+    RENDER_REQUEST_TAG_PANTS_COLOR            = 20,
+    RENDER_REQUEST_TAG_BODY_TYPE              = 21,
+    RENDER_REQUEST_TAG_HAT_TYPE               = 22,
+    RENDER_REQUEST_TAG_HAT_COLOR              = 23,
+    RENDER_REQUEST_TAG_INSTANCE_COUNT         = 24,
+    RENDER_REQUEST_TAG_INSTANCE_ROTATION_MODE = 25,
+    RENDER_REQUEST_TAG_LIGHT_DIRECTION        = 26,
+    RENDER_REQUEST_TAG_SPLIT_MODE             = 27,
+    // variable, once per Mii, turns the request into a batch
+    // that renders each of them with the other fields
+    RENDER_REQUEST_TAG_BATCH_DATA             = 28,
+    RENDER_REQUEST_TAG_DEADLINE_MS            = 29, // RenderRequestExtra
+    RENDER_REQUEST_TAG_PRIORITY               = 30, // ^^
+};
+
+// Which lane of the render queue a request waits in.
+enum RenderRequestPriority
+{
+    RENDER_REQUEST_PRIORITY_INTERACTIVE = 0, // someone is waiting on it
+    RENDER_REQUEST_PRIORITY_BULK        = 1, // soaks up idle time
+    RENDER_REQUEST_PRIORITY_MAX,
+    // not sent: use the lane of the port the request came in on
+    RENDER_REQUEST_PRIORITY_DEFAULT     = 0xff,
+};
+
+// Fields that only exist in v2. They are not in RenderRequest
+// so that its size, which is the v1 format, stays the same.
+struct RenderRequestExtra
+{
+    // time from when the renderer read the request until it
+    // is not worth rendering anymore, 0 = server default
+    uint32_t deadlineMs;
+    uint8_t  priority; // RenderRequestPriority
+    bool     sendImageID; // RENDER_REQUEST_V2_FLAG_IMAGE_ID, from the header
+};
+
+// Mii data of a batch request, pointing into the request body.
+struct RenderRequestBatch
+{
+    uint32_t       count;
+    const uint8_t* pData[RENDER_REQUEST_BATCH_MAX];
+    uint16_t       dataLength[RENDER_REQUEST_BATCH_MAX];
+};
+
+// The response to a batch is one part per Mii, in request order.
+// An OK part is followed by the same response a single request
+// gets (TGA header, image ID if asked for and pixels), an error part by
+// errorLength bytes of the error message.
+PACKED(struct RenderBatchPartHeader {
+    uint16_t index;       // of the Mii in the request
+    uint8_t  status;      // RenderBatchPartStatus
+    uint8_t  reserved;
+    uint32_t errorLength; // only for RENDER_BATCH_PART_STATUS_ERROR
+});
+
+enum RenderBatchPartStatus
+{
+    RENDER_BATCH_PART_STATUS_OK    = 0,
+    RENDER_BATCH_PART_STATUS_ERROR = 1,
+};
+
+// Sets every field to what the web server uses when
+// the query does not have it. v2 starts from this.
+void initRenderRequestDefaults(RenderRequest* pRequest);
+
+// Checks magic and version. Returns false for anything that
+// isn't v2, which is then read as a v1 RenderRequest instead.
+bool isRenderRequestHeaderV2(const RenderRequestHeaderV2* pHeader);
+
+// Reads the fields in place into pRequest, which should have
+// defaults set, and pExtra. Batch data is not copied, pBatch points into the
+// body, so it has to stay around while the batch renders.
+// Returns nullptr on success, or a description of what was
+// wrong with the body.
+const char* parseRenderRequestBodyV2(RenderRequest* pRequest, RenderRequestExtra* pExtra, RenderRequestBatch* pBatch, const void* body, uint32_t bodySize);
@@ -4,7 +4,10 @@
 #include <gpu/rio_RenderBuffer.h>
 #include <gpu/rio_RenderTarget.h>
 
-void copyAndSendRenderBufferToSocket(rio::Texture2D* texture, int socket, int ssaaFactor);
+// Reads the texture back through a PBO and streams it to the socket,
+// preceded by the header if one is passed in. Returns false if the
+// client went away before everything could be written.
+bool copyAndSendRenderBufferToSocket(rio::Texture2D* texture, int socket, int ssaaFactor, const void* header = nullptr, u32 headerSize = 0);
 
 class RenderTexture
 {
@@ -38,6 +41,7 @@ private:
 
     rio::RenderBuffer      mRenderBuffer;
     rio::TextureFormat     mColorFormat;
+    u64                    mMemorySize; // counted in TextureMemory
 
     rio::Texture2D         mRenderTextureColor;
     rio::Texture2D         mRenderTextureDepth;
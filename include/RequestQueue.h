@@ -0,0 +1,85 @@
+#pragma once
+
+#include <rio.h>
+
+#include <RenderRequest.h>
+
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+
+// how many requests can wait to render in each lane
+// before new ones for that lane are turned away
+#define REQUEST_QUEUE_DEPTH_DEFAULT 64
+
+// interactive requests rendered for each bulk one while both wait
+#define REQUEST_QUEUE_INTERACTIVE_WEIGHT_DEFAULT 4
+
+// A request that was read off its socket and is waiting to render.
+struct PendingRequest
+{
+    int                   socket;
+    RenderRequestPriority priority; // lane it waits in
+    RenderRequest         request;
+    RenderRequestExtra    extra;
+    std::vector<u8>       body;      // v2 body, moving it keeps the data in place
+    RenderRequestBatch    batch;     // points into body
+    u32                   batchNext; // Miis of the batch already answered
+    // when it is not worth rendering anymore, max() = never
+    std::chrono::steady_clock::time_point deadline;
+};
+
+// Why a request was answered without rendering it.
+enum ShedReason
+{
+    SHED_REASON_QUEUE_FULL,
+    SHED_REASON_DEADLINE,
+    SHED_REASON_DISCONNECTED,
+    SHED_REASON_MAX
+};
+
+// Bounded FIFOs of requests between accept() and rendering, one
+// per RenderRequestPriority, along with counters for what happened
+// to each of them. Interactive requests go first, but after every
+// interactiveWeight of them a waiting bulk request gets a turn,
+// so bulk work soaks up idle time without starving completely.
+class RequestQueue
+{
+public:
+    explicit RequestQueue(u32 maxDepth = REQUEST_QUEUE_DEPTH_DEFAULT);
+
+    void setMaxDepth(u32 maxDepth) { mMaxDepth = maxDepth > 0 ? maxDepth : 1; }
+    // 0 = bulk only renders when no interactive request waits
+    void setInteractiveWeight(u32 weight) { mInteractiveWeight = weight; }
+
+    bool isEmpty() const;
+    bool isEmpty(RenderRequestPriority priority) const { return mRequests[priority].empty(); }
+    bool isFull(RenderRequestPriority priority) const { return mRequests[priority].size() >= mMaxDepth; }
+    u32 getDepth(RenderRequestPriority priority) const { return static_cast<u32>(mRequests[priority].size()); }
+    u32 getMaxDepth() const { return mMaxDepth; }
+
+    // Returns false without taking it if its lane is full.
+    bool push(PendingRequest&& request);
+    // Puts a request that was popped but not finished back at
+    // the front of its lane, even if the lane is full.
+    void requeue(PendingRequest&& request);
+    // Returns false if there is nothing to render.
+    bool pop(PendingRequest* pRequest);
+
+    void countRendered(RenderRequestPriority priority) { mRenderedCount[priority]++; }
+    void countShed(RenderRequestPriority priority, ShedReason reason) { mShedCount[priority][reason]++; }
+
+    // Prometheus text format, for RENDER_REQUEST_V2_FLAG_METRICS.
+    std::string formatMetrics() const;
+
+private:
+    std::deque<PendingRequest> mRequests[RENDER_REQUEST_PRIORITY_MAX];
+    u32 mMaxDepth;
+    u32 mInteractiveWeight;
+    u32 mInteractiveStreak; // popped in a row while bulk was waiting
+
+    u64 mAcceptedCount[RENDER_REQUEST_PRIORITY_MAX];
+    u64 mRenderedCount[RENDER_REQUEST_PRIORITY_MAX];
+    u64 mShedCount[RENDER_REQUEST_PRIORITY_MAX][SHED_REASON_MAX];
+};
@@ -12,6 +12,8 @@
     #define closesocket close
     #include <sys/socket.h>
     #include <netinet/in.h>
+    #include <sys/un.h>
+    #include <sys/stat.h> // chmod
     #include <arpa/inet.h>
     #include <unistd.h>
     #include <fcntl.h>
@@ -30,11 +32,18 @@
 #include <nn/ffl/FFLiMiiData.h>
 
 #include <RenderRequest.h>
+#include <RequestQueue.h>
+#include <CharModelCache.h>
 #include <Hat.h>   // cMaxHats
 #include <Types.h> // enums for RootTask
 
+#ifndef NO_GLTF
+#include <GLTFExportCallback.h> // StaticMesh
+#endif
+
 #define FFLICHARINFO_SIZE sizeof(FFLiCharInfo)
 
+#include <string>
 #if RIO_IS_WIN
 #include <vector>
 #endif
@@ -43,6 +52,25 @@ class Model;
 
 #define RENDERREQUEST_SIZE sizeof(RenderRequest)
 
+// how long a client has to send all of its request before it is dropped
+#define RENDER_REQUEST_RECV_TIMEOUT_MS 5000
+// connections that are still sending their request, more wait in the backlog
+#define RENDER_REQUEST_INCOMING_MAX 64
+
+#if RIO_IS_WIN
+// A connection whose request did not fully arrive yet.
+struct IncomingRequest
+{
+    PendingRequest        pending;  // socket is set, the rest once it is read
+    RenderRequestPriority lane;     // of the port it came in on
+    RenderRequestHeaderV2 header;
+    bool                  isV2;     // known once the header is in
+    u32                   received; // header, then the v1 struct or v2 body
+    // dropped if the request is not complete by then
+    std::chrono::steady_clock::time_point deadline;
+};
+#endif
+
 #include <mii_ext_MiiPort.h> // used for below function
 FFLResult pickupCharInfoFromRenderRequest(FFLiCharInfo *pCharInfo, RenderRequest *buf);
 
@@ -56,6 +84,15 @@ public:
 
     static const char* sResourceSearchPath;
     static const char* sResourceHighPath;
+    static const char* sQueueDepth; // max requests waiting to render
+    static const char* sDeadlineMs; // default deadline, none if unset
+    static const char* sBulkPort;   // requests from here wait in the bulk lane
+    static const char* sInteractiveWeight; // interactive renders per bulk one
+    static const char* sUnixSocketPath;     // listen here instead of the port
+    static const char* sBulkUnixSocketPath; // ^^ instead of the bulk port
+    static const char* sPreloadList; // comma separated, see preloadAssets_
+    static const char* sCharModelCacheSize; // models kept for reuse
+    static const char* sTextureBudgetMB; // see TextureMemory
 
 
 private:
@@ -63,59 +100,99 @@ private:
     void calc_() override;
     void exit_() override;
 
-    void handleRenderRequest(char* buf, Model** ppModel, int socket);
+#if RIO_IS_WIN
+    // Reads what arrived of a v1 or v2 request without waiting for
+    // more. False once the connection is done with: the request was
+    // queued or answered, or the client is gone or took too long.
+    bool readIncomingRequest_(IncomingRequest* pIncoming);
+    // Parses a complete request and queues it, or answers it if it
+    // is not a render or the queue is full.
+    void queueIncomingRequest_(IncomingRequest* pIncoming);
+    // Accepts every connection that is waiting and reads requests
+    // as they arrive. Only blocks with nothing else to do.
+    void acceptRequests_();
+    // Next request worth rendering. Ones that are past their
+    // deadline or whose client hung up are dropped on the way.
+    bool popRequest_(PendingRequest* pPending);
+    // if a connection waits on either listening socket
+    bool hasWaitingConnection_();
+    // Renders the Miis of the batch with the fields of the request.
+    // Bulk batches stop early when something else is waiting, false
+    // if they did, so that they can be requeued and resumed later.
+    bool handleBatchRequest_(PendingRequest* pPending);
+#endif
+    // sendImageID: put the render fingerprint in the TGA image ID
+    void handleRenderRequest(char* buf, Model** ppModel, int socket, bool sendImageID = false);
 #ifndef NO_GLTF
-    void handleGLTFRequest(RenderRequest *renderRequest);
+    void handleGLTFRequest(RenderRequest* req, Model* pModel, int socket);
 #endif
 
     void loadResourceFiles_();
-    void loadBodyModels_();
-    void loadHatModels_();
     void createModel_();
     FFLResourceType getDefaultResourceType_();
 
-    bool createModel_(RenderRequest* req, int socket_handle);
-
-    void initializeShaders_()
+    // pErrMsg is set to what the client should see on failure
+    bool createModel_(RenderRequest* req, std::string* pErrMsg);
+    // Lowers the resolution of the desc until its textures fit in the
+    // TextureMemory budget, after unused cached models are let go.
+    // Mipmaps go first, then the size halves down to the minimum.
+    void fitTextureResolution_(FFLCharModelDesc* pDesc);
+
+    // Shaders and body/hat models are created the first time a
+    // request needs them, so that a server that only ever renders
+    // one kind of image does not pay for the rest. They are all GL
+    // objects, so only the render thread touches them and a null
+    // check is all the guarding that they need.
+    IShader* getShader_(ShaderType type)
     {
-        for (int type = 0; type < SHADER_TYPE_MAX; type++)
+        if (mpShaders[type] != nullptr)
+            return mpShaders[type];
+
+        switch (type)
         {
-            switch (type)
+            case SHADER_TYPE_WIIU:
+                mpShaders[type] = new Shader();
+                break;
+            case SHADER_TYPE_WIIU_BLINN:
+            {
+                // same program as SHADER_TYPE_WIIU, compiled once
+                Shader* s = new Shader(static_cast<Shader*>(getShader_(SHADER_TYPE_WIIU)));
+                s->setSpecularMode(FFL_SPECULAR_MODE_NORMAL);
+                mpShaders[type] = s;
+                break;
+            }
+            case SHADER_TYPE_WIIU_FFLICONWITHBODY:
             {
-                case SHADER_TYPE_WIIU:
-                    mpShaders[type] = new Shader();
-                    break;
-                case SHADER_TYPE_WIIU_BLINN:
-                {
-                    Shader* s = new Shader();
-                    s->setSpecularMode(FFL_SPECULAR_MODE_NORMAL);
-                    mpShaders[type] = s;
-                    break;
-                }
-                case SHADER_TYPE_WIIU_FFLICONWITHBODY:
-                {
-                    Shader* s = new Shader();
-                    s->setDefaultLight(
-                        { -0.50f, 0.366f, 0.785f }, // direction
-                        { 0.5f, 0.5f, 0.5f, 1.0f }, // ambient
-                        { 0.9f, 0.9f, 0.9f, 1.0f }, // diffuse
-                        { 1.0f, 1.0f, 1.0f, 1.0f }  // specular
-                    );
-
-                    mpShaders[type] = s;
-                    break;
-                }
-                case SHADER_TYPE_SWITCH:
-                    mpShaders[type] = new ShaderSwitch();
-                    break;
-                case SHADER_TYPE_MIITOMO:
-                    // miitomo shader needs wii u shader to draw mask
-                    mpShaders[type] = new ShaderMiitomo(mpShaders[SHADER_TYPE_WIIU]);
-                    break;
+                Shader* s = new Shader(static_cast<Shader*>(getShader_(SHADER_TYPE_WIIU)));
+                s->setDefaultLight(
+                    { -0.50f, 0.366f, 0.785f }, // direction
+                    { 0.5f, 0.5f, 0.5f, 1.0f }, // ambient
+                    { 0.9f, 0.9f, 0.9f, 1.0f }, // diffuse
+                    { 1.0f, 1.0f, 1.0f, 1.0f }  // specular
+                );
+
+                mpShaders[type] = s;
+                break;
             }
-            mpShaders[type]->initialize();
+            case SHADER_TYPE_SWITCH:
+                mpShaders[type] = new ShaderSwitch();
+                break;
+            case SHADER_TYPE_MIITOMO:
+                // miitomo shader needs wii u shader to draw mask
+                mpShaders[type] = new ShaderMiitomo(getShader_(SHADER_TYPE_WIIU));
+                break;
+            default:
+                RIO_ASSERT(false && "unknown shader type");
+                return nullptr;
         }
+        RIO_LOG("initializing shader type %d\n", type);
+        mpShaders[type]->initialize();
+        return mpShaders[type];
     }
+    rio::mdl::Model* loadBodyModel_(BodyType type, FFLGender gender);
+    rio::mdl::Model* loadHatModel_(u32 hatType);
+    // creates everything named in --preload up front
+    void preloadAssets_();
 #if RIO_IS_WIN
     void fillStoreDataArray_();
     void setupSocket_();
@@ -138,16 +215,30 @@ private:
     rio::BaseMtx44f     mProjMtx;
     rio::PerspectiveProjection mProjIconBody;
     rio::BaseMtx44f     mProjMtxIconBody;
+    rio::PerspectiveProjection mProjAllBodySugar;
+    rio::BaseMtx44f     mProjMtxAllBodySugar;
 
     rio::LookAtCamera   mCamera;
     f32                 mCounter;
     s32                 mMiiCounter;
-    Model*              mpModel;
+    Model*              mpModel; // from mCharModelCache
+    CharModelCache      mCharModelCache;
     rio::mdl::Model*    mpBodyModels[BODY_TYPE_MAX][FFL_GENDER_MAX];
     rio::mdl::Model*    mpHatModels[cMaxHats];
+#ifndef NO_GLTF
+    // body/hat vertex data pre-encoded for glTF export
+    GLTFExportCallback::StaticMesh mGLTFBodyMeshes[BODY_TYPE_MAX][FFL_GENDER_MAX];
+    GLTFExportCallback::StaticMesh mGLTFHatMeshes[cMaxHats];
+#endif
 
     // For server:
     int                 mServerFD;
-    int                 mServerSocket;
     sockaddr_in         mServerAddress;
+#if RIO_IS_WIN
+    int                 mBulkServerFD; // -1 without --bulk-port
+    RequestQueue        mRequestQueue;
+    PendingRequest      mCurrentRequest; // being rendered
+    std::vector<IncomingRequest> mIncoming; // requests still arriving
+    u32                 mDefaultDeadlineMs; // 0 = none
+#endif
 };
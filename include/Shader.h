@@ -18,7 +18,10 @@ enum FFLiDefaultShaderSpecularMode
 class Shader : public IShader
 {
 public:
-    Shader();
+    // With pProgramOwner, uses its program instead of compiling
+    // the same source again, so it has to be initialized first.
+    // Only the uniform values differ between the Wii U variants.
+    Shader(Shader* pProgramOwner = nullptr);
     ~Shader();
 
     void initialize() override;
@@ -61,7 +64,8 @@ public:
 
     void applyAlphaTest(bool enable, rio::Graphics::CompareFunc func, f32 ref) const override;
 
-    static void setCulling(FFLCullMode mode);
+    // lighting is off for textures, so all variants draw them the same
+    const IShader* getTextureShader() const override { return mpTextureShader; }
 
 protected:
     static void applyAlphaTestCallback_(void* p_obj, bool enable, rio::Graphics::CompareFunc func, f32 ref);
@@ -113,7 +117,11 @@ protected:
         PIXEL_UNIFORM_MAX
     };
 
-    rio::Shader             mShader;
+    rio::Shader             mShader;  // stays unloaded if shared
+    rio::Shader*            mpShader; // mShader or the owner's
+    UniformCache            mUniformCache;
+    UniformCache*           mpUniformCache; // goes with mpShader
+    const IShader*          mpTextureShader; // this or the owner
     s32                     mVertexUniformLocation[VERTEX_UNIFORM_MAX];
     s32                     mPixelUniformLocation[PIXEL_UNIFORM_MAX];
     s32                     mSamplerLocation;
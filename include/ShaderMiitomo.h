@@ -43,8 +43,10 @@ public:
 
     void applyAlphaTest(bool enable, rio::Graphics::CompareFunc func, f32 ref) const override;
 
-    static void setCulling(FFLCullMode mode);
-
+#ifndef USE_LUT_SHADER_FOR_MASK
+    // bind() hands texture drawing (light off) to the mask shader
+    const IShader* getTextureShader() const override { return mpMaskShader->getTextureShader(); }
+#endif
 
     // Define types of Miitomo LUT textures
     // Located in cache/res/asset/env/lut/
@@ -158,6 +160,7 @@ private:
 
 
     rio::Shader             mShader;
+    UniformCache            mUniformCache;
     IShader*                mpMaskShader;
     s32                     mVertexUniformLocation[VERTEX_UNIFORM_MAX];
     s32                     mPixelUniformLocation[PIXEL_UNIFORM_MAX];
@@ -41,8 +41,6 @@ public:
 
     void applyAlphaTest(bool enable, rio::Graphics::CompareFunc func, f32 ref) const override;
 
-    static void setCulling(FFLCullMode mode);
-
 private:
     static void applyAlphaTestCallback_(void* p_obj, bool enable, rio::Graphics::CompareFunc func, f32 ref);
     void setShaderCallback_();
@@ -95,6 +93,7 @@ private:
     };
 
     rio::Shader             mShader;
+    UniformCache            mUniformCache;
     s32                     mVertexUniformLocation[VERTEX_UNIFORM_MAX];
     s32                     mPixelUniformLocation[PIXEL_UNIFORM_MAX];
     s32                     mSamplerLocation;
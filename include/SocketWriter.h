@@ -0,0 +1,47 @@
+#pragma once
+
+#include <rio.h>
+
+#include <cstddef>
+
+// for socket
+#if RIO_IS_WIN && defined(_WIN32)
+    #include <winsock2.h>
+#elif RIO_IS_WIN
+    #include <sys/socket.h>
+#endif // RIO_IS_WIN && defined(_WIN32)
+
+// how long to wait for the socket to become writable
+// again (EAGAIN) before giving up on the response
+#define SOCKET_SEND_TIMEOUT_MS_DEFAULT 10000
+
+// max amount handed to one send() call, so that
+// huge buffers are written out in pieces
+#define SOCKET_SEND_CHUNK_SIZE (1 << 20) // 1 MiB
+
+// payloads smaller than this are never sent with
+// MSG_ZEROCOPY, page pinning costs more than copying
+#define SOCKET_ZEROCOPY_THRESHOLD (1 << 16) // 64 KiB
+
+// A span of memory that should be written out to the socket.
+struct SocketBuffer
+{
+    const void* data;
+    size_t      size;
+};
+
+// Writes every buffer to the socket in order, as if they were
+// one contiguous buffer. Short writes are continued and EAGAIN
+// waits for the socket to become writable again. The data
+// does not need to be copied beforehand, so it can point
+// straight into a mapped PBO or an encoded glTF buffer.
+// Returns false if the peer went away or the wait timed out,
+// and without sending anything if count is more than 8.
+bool sendBuffersToSocket(int socket, const SocketBuffer* buffers, u32 count);
+
+// Convenience for sending a single buffer.
+inline bool sendAllToSocket(int socket, const void* data, size_t size)
+{
+    const SocketBuffer buffer = { data, size };
+    return sendBuffersToSocket(socket, &buffer, 1);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <rio.h>
+
+#include <nn/ffl.h>
+
+#include <string>
+
+// default for --texture-budget, in MiB
+#define TEXTURE_MEMORY_BUDGET_DEFAULT_MB 512
+
+// texResolution is not lowered below this to fit the budget
+#define TEXTURE_MEMORY_MIN_RESOLUTION 128
+
+enum TextureMemoryKind
+{
+    TEXTURE_MEMORY_KIND_CHAR_MODEL,     // faceline and mask textures
+    TEXTURE_MEMORY_KIND_RENDER_TEXTURE, // RenderTexture color and depth
+    TEXTURE_MEMORY_KIND_MAX
+};
+
+// Counts the texture memory that the renderer allocates, against a
+// budget that decides when texResolution of new models is lowered.
+// Sizes are what the textures should take, the driver (or OSMesa)
+// may use more. Textures are only made on the render thread, so
+// nothing here is locked.
+class TextureMemory
+{
+public:
+    static TextureMemory& instance();
+
+    TextureMemory();
+
+    // in bytes, 0 = no budget
+    void setBudget(u64 budget) { mBudget = budget; }
+    u64 getBudget() const { return mBudget; }
+
+    u64 getUsage() const;
+    u64 getUsage(TextureMemoryKind kind) const { return mUsage[kind]; }
+    // if that much more would still be within the budget
+    bool fits(u64 size) const { return mBudget == 0 || getUsage() + size <= mBudget; }
+
+    void add(TextureMemoryKind kind, u64 size);
+    void remove(TextureMemoryKind kind, u64 size);
+    void countDowngrade() { mDowngradeCount++; }
+
+    // Prometheus text format, for RENDER_REQUEST_V2_FLAG_METRICS.
+    std::string formatMetrics() const;
+
+    // What FFLInitCharModelGPUStep makes for this desc: a faceline
+    // texture half as wide as the resolution and a square mask texture
+    // per expression, all RGBA8, with a third more for mipmaps.
+    static u64 calcCharModelSize(const FFLCharModelDesc& desc);
+
+private:
+    u64 mBudget;
+    u64 mUsage[TEXTURE_MEMORY_KIND_MAX];
+    u64 mPeakUsage;
+    u64 mDowngradeCount;
+};
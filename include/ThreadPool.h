@@ -0,0 +1,59 @@
+#pragma once
+
+#include <rio.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <atomic>
+
+// Persistent worker threads for CPU-bound work that does
+// not touch OpenGL, like PNG encoding or decoding Mii data.
+// All GL calls must stay on the thread that owns the context, unless
+// the job first calls HeadlessEGL::makeCurrentOnThisThread.
+class ThreadPool
+{
+public:
+    // Shared pool sized to the amount of hardware threads.
+    static ThreadPool& instance();
+
+    // threadCount = worker threads on top of the calling thread
+    explicit ThreadPool(u32 threadCount);
+    ~ThreadPool();
+
+    // Calls func(i) for i in [0, count) spread across the workers
+    // and the calling thread, returning once every index is done.
+    // Not reentrant: func must not call parallelFor itself.
+    void parallelFor(u32 count, const std::function<void(u32)>& func);
+
+    // Amount of threads that run work in parallelFor, including the caller.
+    u32 getConcurrency() const
+    {
+        return static_cast<u32>(mThreads.size()) + 1;
+    }
+
+private:
+    struct Batch
+    {
+        const std::function<void(u32)>* pFunc;
+        u32              count;
+        std::atomic<u32> next;   // next index to hand out
+        u32              active; // workers inside this batch, guarded by mMutex
+    };
+
+    void workerMain_();
+    static void runBatch_(Batch* pBatch);
+
+    std::vector<std::thread> mThreads;
+
+    std::mutex              mCallMutex; // one parallelFor at a time
+    std::mutex              mMutex;
+    std::condition_variable mWorkCond;
+    std::condition_variable mDoneCond;
+
+    Batch* mpBatch;
+    u64    mGeneration;
+    bool   mStopping;
+};
@@ -84,6 +84,7 @@ enum ViewType {
     // nn::mii::VariableIconBody::StoreCameraMatrix
     VIEW_TYPE_NNMII_VARIABLEICONBODY,
     VIEW_TYPE_ALL_BODY_SUGAR,
+    VIEW_TYPE_MAX
 };
 
 enum DrawStageMode {
@@ -94,9 +95,18 @@ enum DrawStageMode {
     DRAW_STAGE_MODE_XLU_DEPTH_MASK,
 };
 
+// sent over the socket, so the values must not change
 enum ResponseFormat {
-    RESPONSE_FORMAT_TGA_DEFAULT,     // with tga header
-    RESPONSE_FORMAT_GLTF_MODEL,      // glTF model export
-    RESPONSE_FORMAT_TGA_BGRA_FLIP_Y, // RIO_IS_WIN only
+    RESPONSE_FORMAT_TGA_DEFAULT     = 0, // with tga header
+    RESPONSE_FORMAT_GLTF_MODEL      = 1, // glTF model export
+    RESPONSE_FORMAT_TGA_BGRA_FLIP_Y = 2, // RIO_IS_WIN only
     //RESPONSE_FORMAT_JPEG // planned, libjpeg-turbo? ffmpeg?
 };
+
+// the upper bits of responseFormat are glTF export options
+#define RESPONSE_FORMAT_MASK 0x3F
+
+enum GLTFExportFlag {
+    GLTF_EXPORT_FLAG_QUANTIZE = 1 << 6, // KHR_mesh_quantization
+    GLTF_EXPORT_FLAG_KTX2     = 1 << 7, // KTX2 textures (PNG fallback)
+};
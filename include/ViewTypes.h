@@ -0,0 +1,116 @@
+#pragma once
+#include <Types.h>
+#include <BodyTypes.h>
+
+// Camera and projection for every ViewType, all known at compile
+// time so that setViewTypeParams is only a table lookup.
+
+// Which of the projections made in RootTask::prepare_ a view uses.
+enum ViewProjection {
+    VIEW_PROJECTION_HEAD,           // mProj, FFLMakeIcon
+    VIEW_PROJECTION_ICON_BODY,      // mProjIconBody, 15 degrees and square
+    VIEW_PROJECTION_ALL_BODY_SUGAR, // mProjIconBody at 3:4
+    VIEW_PROJECTION_MAX
+};
+
+struct ViewCamera {
+    f32 pos[3];
+    f32 at[3];
+};
+
+struct ViewPreset {
+    ViewProjection projection;
+    f32            aspectHeightFactor; // output height / width
+    bool           isCameraPosAbsolute; // camera does not follow the head
+    bool           drawBody;
+    ViewCamera     camera; // up is always +Y
+};
+
+// FFLiCharInfo height range.
+#define VIEW_BODY_HEIGHT_MAX 128
+
+// NOTE: wii u mii maker does some strange
+// camera zooming, to make the character
+// bigger when it's shorter and smaller
+// when it's taller, purely based on height
+
+// this is an ATTEMPT??? to simulate that
+// via interpolation which is... meh
+
+// These camera parameters look right when the character is shortest (scale 0.5)
+constexpr ViewCamera cViewAllBodySugarCameraStart = {
+    { 0.0f, 30.0f, 550.0f }, { 0.0f, 65.0f, 0.0f }
+};
+// Likewise these look correct when it's tallest (scale 1.264).
+constexpr ViewCamera cViewAllBodySugarCameraEnd = {
+    { 0.0f, 9.0f, 850.0f }, { 0.0f, 90.0f, 0.0f }
+};
+
+constexpr ViewCamera calcViewAllBodySugarCamera(f32 height)
+{
+    // Calculate interpolation factor (normalized to range [0, 1])
+    const f32 t = (calcBodyScaleY(height) - 0.5f) / (1.264f - 0.5f);
+
+    ViewCamera camera = {};
+    for (int i = 0; i < 3; i++)
+    {
+        camera.pos[i] = cViewAllBodySugarCameraStart.pos[i]
+            + t * (cViewAllBodySugarCameraEnd.pos[i] - cViewAllBodySugarCameraStart.pos[i]);
+        camera.at[i] = cViewAllBodySugarCameraStart.at[i]
+            + t * (cViewAllBodySugarCameraEnd.at[i] - cViewAllBodySugarCameraStart.at[i]);
+    }
+    return camera;
+}
+
+struct ViewAllBodySugarCameraTable {
+    ViewCamera cameras[VIEW_BODY_HEIGHT_MAX];
+};
+
+constexpr ViewAllBodySugarCameraTable makeViewAllBodySugarCameraTable()
+{
+    ViewAllBodySugarCameraTable table = {};
+    for (int height = 0; height < VIEW_BODY_HEIGHT_MAX; height++)
+        table.cameras[height] = calcViewAllBodySugarCamera(static_cast<f32>(height));
+    return table;
+}
+
+// VIEW_TYPE_ALL_BODY_SUGAR camera by height.
+constexpr ViewAllBodySugarCameraTable cViewAllBodySugarCameras = makeViewAllBodySugarCameraTable();
+
+// Views not in this table are head only, like VIEW_TYPE_FACE_ONLY_FFLMAKEICON.
+constexpr ViewPreset cViewPresetDefault = {
+    // default, face only (FFLMakeIcon)
+    VIEW_PROJECTION_HEAD, 1.0f, false, false,
+    { { 0.0f, 34.5f, 600.0f }, { 0.0f, 34.5f, 0.0f } }
+};
+
+constexpr ViewPreset cViewPresets[VIEW_TYPE_MAX] = {
+    // VIEW_TYPE_FACE
+    // FFLMakeIconWithBody view uses 37.05f, 415.53f
+    // below values are extracted from wii u mii maker
+    { VIEW_PROJECTION_ICON_BODY, 1.0f, false, true,
+      { { 0.0f, 33.016785f, 411.181793f }, { 0.0f, 34.3f, 0.0f } } },
+    // VIEW_TYPE_FACE_ONLY
+    // goal is actually same view as face
+    // both cdn-mii 2.0.0 and 1.0.0 do this
+    { VIEW_PROJECTION_ICON_BODY, 1.0f, false, false,
+      { { 0.0f, 33.016785f, 411.181793f }, { 0.0f, 34.3f, 0.0f } } },
+    // VIEW_TYPE_ALL_BODY
+    // made to be closer to mii studio looking value but still not actually accurate
+    { VIEW_PROJECTION_ICON_BODY, 1.0f, true, true,
+      { { 0.0f, 9.0f, 900.0f }, { 0.0f, 105.0f, 0.0f } } },
+    // VIEW_TYPE_FACE_ONLY_FFLMAKEICON
+    cViewPresetDefault,
+    // VIEW_TYPE_FFLICONWITHBODY
+    // FFLMakeIconWithBody view
+    { VIEW_PROJECTION_ICON_BODY, 1.0f, false, true,
+      { { 0.0f, 37.05f, 415.53f }, { 0.0f, 37.05f, 0.0f } } },
+    // VIEW_TYPE_NNMII_VARIABLEICONBODY
+    // nn::mii::VariableIconBody::StoreCameraMatrix values
+    { VIEW_PROJECTION_ICON_BODY, 1.0f, false, true,
+      { { 0.0f, 37.0f, 380.0f }, { 0.0f, 37.0f, 0.0f } } },
+    // VIEW_TYPE_ALL_BODY_SUGAR, like mii maker/nnid
+    // camera comes from cViewAllBodySugarCameras instead
+    { VIEW_PROJECTION_ALL_BODY_SUGAR, 4.0f / 3.0f, true, true,
+      cViewAllBodySugarCameraStart },
+};
@@ -232,5 +232,17 @@ typedef struct {
 void charInfoNXToFFLiCharInfo(FFLiCharInfo* dest, const charInfo* src);
 void studioToCharInfoNX(charInfo* dest, const charInfoStudio* src);
 void studioURLObfuscationDecode(char* data);
+// decodes count records that are STUDIO_DATA_ENCODED_LENGTH bytes each
+void studioURLObfuscationDecodeBatch(const void* src, charInfoStudio* dest, u32 count);
+// Self checks for ffl_testing_miidata --self-check, false on a mismatch.
+// Compares the decoders above against the original scalar one.
+bool studioURLObfuscationSelfCheck();
+// Checks that random coreData and NX charInfo pick up the same as
+// studio data made from the result, raw and encoded.
+bool miiDataConversionSelfCheck();
 void coreDataToCharInfoNX(charInfo* dest, const coreData* src);
 FFLResult pickupCharInfoFromData(FFLiCharInfo* pCharInfo, const void* data, u32 dataLength, bool verifyCRC16);
+bool getMiiDataInputType(u32 dataLength, MiiDataInputType* pInputType);
+u32 getMiiDataInputTypeSize(MiiDataInputType inputType); // 0 if unsupported
+FFLResult pickupCharInfoFromDataWithType(FFLiCharInfo* pCharInfo, const void* data, MiiDataInputType inputType, bool verifyCRC16);
+void charInfoToStudio(charInfoStudio* dest, const FFLiCharInfo* src);
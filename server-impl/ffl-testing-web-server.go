@@ -3,6 +3,7 @@ package main
 import (
 	"bufio"
 	"bytes"
+	"context"
 	"database/sql"
 	"encoding/base64"
 	"encoding/binary"
@@ -13,8 +14,10 @@ import (
 	"image/png"
 	"io"
 	"log"
+	"mime/multipart"
 	"net"
 	"net/http"
+	"net/textproto"
 	"os"
 	"strconv"
 	"strings"
@@ -34,8 +37,11 @@ var (
 	mysqlAvailable   = false
 	db               *sql.DB
 	upstreamTCP      string
+	upstreamBulkTCP  string
 	useXForwardedFor bool
 	loggingEnabled   bool
+	useRequestV2     bool
+	renderDeadlineMs int
 )
 
 // RenderRequest is the equivalent struct in Go for handling the render request data.
@@ -103,7 +109,7 @@ func SetExpressionFlagIndex(ef *FFLAllExpressionFlag, index int, set bool) {
 // be changed in the future to directly output compliant
 // TGA if needed. Otherwise most of this is still unused
 type TGAHeader struct {
-	IDLength        uint8 // unused (0)
+	IDLength        uint8 // length of the image ID after the header (render fingerprint)
 	ColorMapType    uint8 // always 0 for no color map
 	ImageType       uint8 // image_type_enum, 2 = uncomp_true_color
 	ColorMapOrigin  int16 // unused
@@ -175,10 +181,13 @@ func main() {
 	flag.StringVar(&assetsDir, "assets-dir", "", "If you set this, files from here will be served at root.")
 
 	flag.StringVar(&mysqlConnStr, "mysql", "", "MySQL connection string for NNID fetch")
-	flag.StringVar(&upstreamAddr, "upstream", "localhost:12346", "Upstream TCP server address")
+	flag.StringVar(&upstreamAddr, "upstream", "localhost:12346", "Upstream renderer address, host:port or unix:/path/to/socket")
+	flag.StringVar(&upstreamBulkTCP, "upstream-bulk", "", "Upstream address for priority=bulk requests, e.g. localhost:<renderer --bulk-port> or unix:<renderer --bulk-unix-socket>. Without it they go to -upstream, marked as bulk only with -request-v2.")
 	flag.BoolVar(&useXForwardedFor, "use-x-forwarded-for", false, "Use X-Forwarded-For header for client IP")
 	flag.StringVar(&corsOrigin, "cors", "", "CORS origin to allow. Set to * to allow all origins. Leave blank to disable CORS header.")
 	flag.BoolVar(&loggingEnabled, "enable-benchmarking", false, "Log how much time each request is taking.")
+	flag.BoolVar(&useRequestV2, "request-v2", false, "Send requests in the versioned (v2) format, needs a renderer that supports it.")
+	flag.IntVar(&renderDeadlineMs, "deadline", 0, "With -request-v2, milliseconds after which the renderer drops a request instead of rendering it. 0 uses the renderer's default.")
 
 	flag.Parse()
 
@@ -208,6 +217,7 @@ func main() {
 	http.HandleFunc(imagePngEndpoint, renderImage)
 	http.HandleFunc("/miis/image.glb", renderImage)
 	http.HandleFunc("/miis/image.tga", renderImage)
+	http.HandleFunc("/metrics", rendererMetrics)
 
 	var err error
 
@@ -470,6 +480,32 @@ func normalizeNnid(nnid string) string {
 	return strings.ToLower(strings.ReplaceAll(strings.ReplaceAll(strings.ReplaceAll(nnid, "-", ""), "_", ""), ".", ""))
 }
 
+// decodeMiiData decodes Mii data from hex or base64 and checks its length.
+func decodeMiiData(data string) ([]byte, error) {
+	var storeData []byte
+	var err error
+	data = strings.ReplaceAll(data, " ", "")
+	if isHex(data) {
+		storeData, err = hex.DecodeString(data)
+	} else {
+		storeData, err = decodeBase64(data)
+	}
+	if err != nil {
+		return nil, fmt.Errorf("failed to decode data: %v", err)
+	}
+	return storeData, nil
+}
+
+// checkMiiDataLength rejects data that can't be any supported format.
+func checkMiiDataLength(storeData []byte) error {
+	// 46: size of studio data raw
+	// 96: length of FFLStoreData
+	if len(storeData) < 46 || len(storeData) > 96 {
+		return errors.New("data length should be between 46-96 bytes")
+	}
+	return nil
+}
+
 // decodeBase64 decodes a Base64 string, handling both standard and URL-safe Base64.
 func decodeBase64(s string) ([]byte, error) {
 	// Normalize URL-safe Base64 by replacing '-' with '+' and '_' with '/'
@@ -497,18 +533,181 @@ func isHex(s string) bool {
 // is always read out to the api response
 const socketErrorPrefix = "ERROR: "
 
+// Sent instead of rendering when the renderer is overloaded.
+const (
+	socketBusyPrefix    = "BUSY: "    // queue was full
+	socketExpiredPrefix = "EXPIRED: " // deadline passed while queued
+)
+
+// rendererErrorStatus returns the HTTP status for an error
+// message from the renderer, or false if it is not one.
+func rendererErrorStatus(responseStr string) (int, bool) {
+	switch {
+	case strings.HasPrefix(responseStr, socketErrorPrefix):
+		return http.StatusInternalServerError, true
+	case strings.HasPrefix(responseStr, socketBusyPrefix):
+		return http.StatusServiceUnavailable, true
+	case strings.HasPrefix(responseStr, socketExpiredPrefix):
+		return http.StatusGatewayTimeout, true
+	}
+	return 0, false
+}
+
+// writeRendererError responds with an error message from the renderer.
+func writeRendererError(w http.ResponseWriter, responseStr string, status int) {
+	if status == http.StatusServiceUnavailable {
+		w.Header().Set("Retry-After", "1")
+	}
+	http.Error(w, "renderer returned "+responseStr, status)
+}
+
 // sendRenderRequest sends the render request to the render server
 // It returns the first KB and a reader for the data.
-func sendRenderRequest(request RenderRequest) ([]byte, io.Reader, error) {
-	// Serialize the RenderRequest struct
+// v2 request format, see RenderRequestHeaderV2 in the renderer.
+const (
+	renderRequestV2Magic   = 0x51524646 // "FFRQ"
+	renderRequestVersion2  = 2
+	renderRequestV2MaxBody = 32 * 1024
+	renderRequestBatchMax  = 256
+)
+
+// renderPriority matches RenderRequestPriority in the renderer.
+type renderPriority uint8
+
+const (
+	priorityInteractive renderPriority = 0 // someone is waiting on it
+	priorityBulk        renderPriority = 1 // renders when the renderer is idle
+)
+
+// RenderBatchPartHeader comes before each Mii in a batch response.
+type RenderBatchPartHeader struct {
+	Index       uint16
+	Status      uint8 // 0 = ok, TGA follows, 1 = error message follows
+	Reserved    uint8
+	ErrorLength uint32
+}
+
+// RenderRequestHeaderV2 comes before the fields in a v2 request.
+type RenderRequestHeaderV2 struct {
+	Magic    uint32
+	Version  uint16
+	Flags    uint16 // RENDER_REQUEST_V2_FLAG_*
+	BodySize uint32
+}
+
+// encodeRenderRequestV2 writes every field of the request as a
+// tag, length and value. The renderer skips tags it does not know,
+// so fields can be added here before the renderer supports them.
+// If batchData is not empty, each entry is rendered instead of Data.
+func encodeRenderRequestV2(request RenderRequest, batchData [][]byte, priority renderPriority) ([]byte, error) {
+	var body bytes.Buffer
+	writeField := func(tag uint16, value any) {
+		binary.Write(&body, binary.LittleEndian, tag)
+		binary.Write(&body, binary.LittleEndian, uint16(binary.Size(value)))
+		binary.Write(&body, binary.LittleEndian, value)
+	}
+
+	// tags match RenderRequestTag
+	if len(batchData) == 0 {
+		writeField(1, request.Data[:request.DataLength])
+	}
+	for _, data := range batchData {
+		writeField(28, data)
+	}
+	writeField(2, request.ModelFlag)
+	writeField(3, request.ResponseFormat)
+	writeField(4, request.Resolution)
+	writeField(5, request.TexResolution)
+	writeField(6, request.ViewType)
+	writeField(7, request.ResourceType)
+	writeField(8, request.ShaderType)
+	writeField(9, request.Expression)
+	writeField(10, request.ExpressionFlag)
+	writeField(11, request.CameraRotate)
+	writeField(12, request.ModelRotate)
+	writeField(13, request.BackgroundColor)
+	writeField(14, request.AAMethod)
+	writeField(15, request.DrawStageMode)
+	writeField(16, request.VerifyCharInfo)
+	writeField(17, request.VerifyCRC16)
+	writeField(18, request.LightEnable)
+	writeField(19, request.ClothesColor)
+	writeField(20, request.PantsColor)
+	writeField(21, request.BodyType)
+	writeField(22, request.HatType)
+	writeField(23, request.HatColor)
+	writeField(24, request.InstanceCount)
+	writeField(25, request.InstanceRotationMode)
+	writeField(26, request.LightDirection)
+	writeField(27, request.SplitMode)
+	if renderDeadlineMs > 0 {
+		writeField(29, uint32(renderDeadlineMs))
+	}
+	writeField(30, uint8(priority))
+
+	if body.Len() > renderRequestV2MaxBody {
+		return nil, errors.New("v2 render request is too large")
+	}
+
 	var buffer bytes.Buffer
-	err := binary.Write(&buffer, binary.LittleEndian, request)
+	header := RenderRequestHeaderV2{
+		Magic:    renderRequestV2Magic,
+		Version:  renderRequestVersion2,
+		Flags:    1 << 1, // RENDER_REQUEST_V2_FLAG_IMAGE_ID, used as the ETag
+		BodySize: uint32(body.Len()),
+	}
+	if err := binary.Write(&buffer, binary.LittleEndian, header); err != nil {
+		return nil, err
+	}
+	buffer.Write(body.Bytes())
+	return buffer.Bytes(), nil
+}
+
+// dialRenderer connects to the renderer. The connection is reset
+// when ctx is done, so the renderer sees that the client went away
+// and can skip the render if it has not started yet.
+func dialRenderer(ctx context.Context, priority renderPriority) (net.Conn, error) {
+	address := upstreamTCP
+	if priority == priorityBulk && upstreamBulkTCP != "" {
+		address = upstreamBulkTCP
+	}
+	// the renderer's --unix-socket, skips the TCP stack
+	network := "tcp"
+	if path, ok := strings.CutPrefix(address, "unix:"); ok {
+		network, address = "unix", path
+	}
+	var dialer net.Dialer
+	conn, err := dialer.DialContext(ctx, network, address)
 	if err != nil {
+		return nil, err
+	}
+	context.AfterFunc(ctx, func() {
+		// a plain close only sends a FIN, which the renderer cannot
+		// tell apart from a client that finished sending. an RST it
+		// sees as a hang-up and drops the request.
+		if tcpConn, ok := conn.(*net.TCPConn); ok {
+			tcpConn.SetLinger(0)
+		}
+		conn.Close()
+	})
+	return conn, nil
+}
+
+func sendRenderRequest(ctx context.Context, request RenderRequest, priority renderPriority) ([]byte, io.Reader, error) {
+	// Serialize the RenderRequest struct
+	var buffer bytes.Buffer
+	if useRequestV2 {
+		encoded, err := encodeRenderRequestV2(request, nil, priority)
+		if err != nil {
+			return nil, nil, err
+		}
+		buffer.Write(encoded)
+	} else if err := binary.Write(&buffer, binary.LittleEndian, request); err != nil {
 		return nil, nil, err
 	}
 
 	// Connect to the render server
-	conn, err := net.Dial("tcp", upstreamTCP)
+	conn, err := dialRenderer(ctx, priority)
 	if err != nil {
 		return nil, nil, err
 	}
@@ -557,9 +756,9 @@ func handleRenderRequestError(w http.ResponseWriter, bufferData []byte, err erro
 			// If the null character exists, slice the string until that point
 			responseStr = responseStr[:nullIndex]
 		}
-		if strings.HasPrefix(responseStr, socketErrorPrefix) {
+		if status, ok := rendererErrorStatus(responseStr); ok {
 			// in this case, respond with that error
-			http.Error(w, "renderer returned "+responseStr, http.StatusInternalServerError)
+			writeRendererError(w, responseStr, status)
 			return
 		}
 
@@ -648,6 +847,13 @@ func renderImage(w http.ResponseWriter, r *http.Request) {
 	var responseFormat uint8 = 0
 	if strings.HasSuffix(r.URL.Path, ".glb") {
 		responseFormat = 1 // output is gltf
+		// upper bits are glTF export options
+		if query.Get("textureFormat") == "ktx2" {
+			responseFormat |= 1 << 7 // KHR_texture_basisu
+		}
+		if query.Get("quantize") == "true" || query.Get("quantize") == "1" {
+			responseFormat |= 1 << 6 // KHR_mesh_quantization
+		}
 	} else if strings.HasSuffix(r.URL.Path, ".tga") {
 		responseFormat = 2 // flips Y, emits BGRA
 	}
@@ -681,15 +887,9 @@ func renderImage(w http.ResponseWriter, r *http.Request) {
 			return
 		}
 	} else {
-		// Decoding data from hex or base64
-		data = strings.ReplaceAll(data, " ", "")
-		if isHex(data) {
-			storeData, err = hex.DecodeString(data)
-		} else {
-			storeData, err = decodeBase64(data)
-		}
+		storeData, err = decodeMiiData(data)
 		if err != nil {
-			http.Error(w, fmt.Sprintf("failed to decode data: %v", err), http.StatusBadRequest)
+			http.Error(w, err.Error(), http.StatusBadRequest)
 			return
 		}
 	}
@@ -701,10 +901,8 @@ func renderImage(w http.ResponseWriter, r *http.Request) {
 			return
 		}
 	*/
-	// 46: size of studio data raw
-	// 96: length of FFLStoreData
-	if len(storeData) < 46 || len(storeData) > 96 {
-		http.Error(w, "data length should be between 46-96 bytes", http.StatusBadRequest)
+	if err := checkMiiDataLength(storeData); err != nil {
+		http.Error(w, err.Error(), http.StatusBadRequest)
 		return
 	}
 
@@ -801,6 +999,12 @@ func renderImage(w http.ResponseWriter, r *http.Request) {
 
 	verifyCRC16 := query.Get("verifyCRC16") != "0" // 0 = no verify
 
+	// bulk jobs set this so that they don't hold up interactive users
+	priority := priorityInteractive
+	if query.Get("priority") == "bulk" {
+		priority = priorityBulk
+	}
+
 	// Parsing and validating expression flag
 	/*expressionFlag, err := strconv.Atoi(expressionFlagStr)
 	if err != nil {
@@ -829,7 +1033,8 @@ func renderImage(w http.ResponseWriter, r *http.Request) {
 	var expressionFlag FFLAllExpressionFlag //uint32 = 0
 	// check for multiple expressions
 	// (only applies for glTF!!!!!!!)
-	if responseFormat == 1 && query.Has("expression") {
+	isGLTF := responseFormat&0x3F == 1
+	if isGLTF && query.Has("expression") {
 		expressionStr := query.Get("expression")
 		// Split the comma-separated expressions
 		expressions := strings.Split(expressionStr, ",")
@@ -1053,13 +1258,23 @@ func renderImage(w http.ResponseWriter, r *http.Request) {
 	// Copying store data into the request data buffer
 	copy(renderRequest.Data[:], storeData)
 
+	// more than one "data" renders all of them in one round trip
+	if allData := query["data"]; len(allData) > 1 && nnid == "" {
+		if isGLTF {
+			http.Error(w, "batches can only render images", http.StatusBadRequest)
+			return
+		}
+		renderBatch(w, r, renderRequest, allData, ssaaFactor, priority)
+		return
+	}
+
 	// Time taken for sendRenderRequest to respond
 	durationSendRequest := beginTimeMeasure()
 
 	var bufferData []byte
 	var reader io.Reader
 	// Send the render request and receive the initial buffer and reader
-	bufferData, reader, err = sendRenderRequest(renderRequest)
+	bufferData, reader, err = sendRenderRequest(r.Context(), renderRequest, priority)
 	if err != nil {
 		handleRenderRequestError(w, bufferData, err)
 		return
@@ -1067,7 +1282,7 @@ func renderImage(w http.ResponseWriter, r *http.Request) {
 
 	fullReader := bufio.NewReader(io.MultiReader(bytes.NewReader(bufferData), reader)) // use bufio to allow discard
 
-	if responseFormat == 1 { // gltf
+	if isGLTF {
 		logTimeSincePrintfln(durationSendRequest, "Time for streamRenderRequest (glTF export): %d ms")
 		// Read size from GLB header
 		var glbHeader GLBHeader
@@ -1108,7 +1323,24 @@ func renderImage(w http.ResponseWriter, r *http.Request) {
 		http.Error(w, "failed to parse tga header from backend for some reason: "+err.Error(), http.StatusInternalServerError)
 		return
 	}
-	fullReader.Discard(18) // tga header length, move past the tga reader
+	// The image ID is a fingerprint of the Mii's visual fields and
+	// the request, which stays the same across Mii data formats.
+	// ssaaFactor and the response format are not part of it since
+	// they are applied here, a .png and .tga of one render differ.
+	imageIDEnd := 18 + int(tgaHeader.IDLength)
+	if tgaHeader.IDLength > 0 && imageIDEnd <= len(bufferData) {
+		etag := fmt.Sprintf("\"%s-%d-%d\"", bufferData[18:imageIDEnd], ssaaFactor, responseFormat)
+		header.Set("ETag", etag)
+		if r.Header.Get("If-None-Match") == etag {
+			// client already has this image, no need to read or encode it
+			if closer, ok := reader.(io.Closer); ok {
+				closer.Close()
+			}
+			w.WriteHeader(http.StatusNotModified)
+			return
+		}
+	}
+	fullReader.Discard(imageIDEnd) // tga header + image ID length, move past the tga reader
 
 	bytesPerPixel := int(tgaHeader.BitsPerPixel) / 8
 	imageDataSize := int(tgaHeader.Width) * int(tgaHeader.Height) * bytesPerPixel
@@ -1147,11 +1379,12 @@ func renderImage(w http.ResponseWriter, r *http.Request) {
 		logTimeSincePrintfln(startScaling, "Time to scale the image: %d ms")
 	}
 
-	if responseFormat == 2 { // tga
+	if responseFormat&0x3F == 2 { // tga
 		// change tga header to reflect img
 		tgaHeader.Width = int16(img.Rect.Dx())
 		tgaHeader.Height = int16(img.Rect.Dy())
 		tgaHeader.BitsPerPixel = 32 // NRGBA
+		tgaHeader.IDLength = 0      // image ID is only in the ETag
 
 		// size is deterministic so set it
 		imageDataSize := int(img.Rect.Dx()) * int(img.Rect.Dy()) * 4 // NRGBA
@@ -1183,6 +1416,155 @@ func renderImage(w http.ResponseWriter, r *http.Request) {
 	logTimeSincePrintfln(startEncoding, "Time to encode PNG: %d ms")
 }
 
+// rendererMetrics proxies the renderer's queue metrics, in Prometheus text format.
+func rendererMetrics(w http.ResponseWriter, r *http.Request) {
+	conn, err := dialRenderer(r.Context(), priorityInteractive)
+	if err != nil {
+		http.Error(w, "renderer is down: "+err.Error(), http.StatusServiceUnavailable)
+		return
+	}
+	defer conn.Close()
+
+	header := RenderRequestHeaderV2{
+		Magic:   renderRequestV2Magic,
+		Version: renderRequestVersion2,
+		Flags:   1 << 0, // RENDER_REQUEST_V2_FLAG_METRICS
+	}
+	if err := binary.Write(conn, binary.LittleEndian, header); err != nil {
+		http.Error(w, err.Error(), http.StatusBadGateway)
+		return
+	}
+	metrics, err := io.ReadAll(conn)
+	if err != nil && len(metrics) == 0 {
+		http.Error(w, err.Error(), http.StatusBadGateway)
+		return
+	}
+	w.Header().Set("Content-Type", "text/plain; version=0.0.4")
+	w.Write(metrics)
+}
+
+// readTGAImage reads one TGA response (header, image ID, pixels) from the renderer.
+func readTGAImage(reader io.Reader) (*image.NRGBA, error) {
+	var tgaHeader TGAHeader
+	if err := binary.Read(reader, binary.LittleEndian, &tgaHeader); err != nil {
+		return nil, err
+	}
+	if _, err := io.CopyN(io.Discard, reader, int64(tgaHeader.IDLength)); err != nil {
+		return nil, err
+	}
+
+	bytesPerPixel := int(tgaHeader.BitsPerPixel) / 8
+	imageData := make([]byte, int(tgaHeader.Width)*int(tgaHeader.Height)*bytesPerPixel)
+	if _, err := io.ReadFull(reader, imageData); err != nil {
+		return nil, err
+	}
+	return &image.NRGBA{
+		Pix:    imageData,
+		Stride: int(tgaHeader.Width) * bytesPerPixel,
+		Rect:   image.Rect(0, 0, int(tgaHeader.Width), int(tgaHeader.Height)),
+	}, nil
+}
+
+// renderBatch renders every Mii in allData with the same parameters
+// in a single request to the renderer. The response is multipart/mixed
+// with one PNG per Mii in order, or a text/plain part if it failed.
+func renderBatch(w http.ResponseWriter, r *http.Request, request RenderRequest, allData []string, ssaaFactor int, priority renderPriority) {
+	if len(allData) > renderRequestBatchMax {
+		http.Error(w, fmt.Sprintf("at most %d Miis can be in one batch", renderRequestBatchMax), http.StatusBadRequest)
+		return
+	}
+	batchData := make([][]byte, len(allData))
+	for i, data := range allData {
+		storeData, err := decodeMiiData(data)
+		if err == nil {
+			err = checkMiiDataLength(storeData)
+		}
+		if err != nil {
+			http.Error(w, fmt.Sprintf("data %d: %v", i, err), http.StatusBadRequest)
+			return
+		}
+		batchData[i] = storeData
+	}
+
+	encoded, err := encodeRenderRequestV2(request, batchData, priority)
+	if err != nil {
+		http.Error(w, err.Error(), http.StatusBadRequest)
+		return
+	}
+
+	durationBatch := beginTimeMeasure()
+	conn, err := dialRenderer(r.Context(), priority)
+	if err != nil {
+		handleRenderRequestError(w, nil, err)
+		return
+	}
+	defer conn.Close()
+	if _, err := conn.Write(encoded); err != nil {
+		handleRenderRequestError(w, nil, err)
+		return
+	}
+	reader := bufio.NewReader(conn)
+
+	// the whole request can still fail before any part
+	prefix, err := reader.Peek(len(socketExpiredPrefix)) // longest prefix
+	if status, ok := rendererErrorStatus(string(prefix)); ok {
+		message, _ := io.ReadAll(reader)
+		writeRendererError(w, string(message), status)
+		return
+	} else if err != nil {
+		handleRenderRequestError(w, prefix, err)
+		return
+	}
+
+	mw := multipart.NewWriter(w)
+	w.Header().Set("Content-Type", "multipart/mixed; boundary="+mw.Boundary())
+
+	for range batchData {
+		var part RenderBatchPartHeader
+		if err := binary.Read(reader, binary.LittleEndian, &part); err != nil {
+			log.Println("batch response ended early:", err)
+			break // headers are already sent, just end it
+		}
+
+		partHeader := textproto.MIMEHeader{}
+		partHeader.Set("X-Mii-Index", strconv.Itoa(int(part.Index)))
+
+		if part.Status != 0 {
+			message := make([]byte, part.ErrorLength)
+			if _, err := io.ReadFull(reader, message); err != nil {
+				log.Println("batch response ended early:", err)
+				break
+			}
+			partHeader.Set("Content-Type", "text/plain")
+			if pw, err := mw.CreatePart(partHeader); err == nil {
+				pw.Write(message)
+			}
+			continue
+		}
+
+		img, err := readTGAImage(reader)
+		if err != nil {
+			log.Println("batch response ended early:", err)
+			break
+		}
+		if ssaaFactor != 1 {
+			scaledImg := image.NewNRGBA(image.Rect(0, 0, img.Rect.Dx()/ssaaFactor, img.Rect.Dy()/ssaaFactor))
+			draw.ApproxBiLinear.Scale(scaledImg, scaledImg.Bounds(), img, img.Bounds(), draw.Over, nil)
+			img = scaledImg
+		}
+
+		partHeader.Set("Content-Type", "image/png")
+		pw, err := mw.CreatePart(partHeader)
+		if err != nil {
+			break
+		}
+		png.Encode(pw, img)
+	}
+	mw.Close()
+
+	logTimeSincePrintfln(durationBatch, fmt.Sprintf("Time for batch of %d: %%d ms", len(batchData)))
+}
+
 // Expression constants
 const (
 	FFL_EXPRESSION_NORMAL                = 0
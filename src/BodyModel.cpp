@@ -74,15 +74,37 @@ void BodyModel::draw(rio::Matrix34f& model_mtx, rio::BaseMtx34f& view_mtx, rio::
 
     const rio::mdl::Mesh* meshes = mpBodyModel->meshes(); // Body and pants mesh.
 
+    // Bind shader once, materials are set per mesh.
+    IShader* pShader = mpModel->getShader();
+    pShader->bind(lightEnable, pCharInfo);
+    IShader::setCulling(FFL_CULL_MODE_BACK);
+
+    // make new matrix for body
+    rio::Matrix34f modelMtxBody = rio::Matrix34f::ident;//model_mtx;
+
+    // apply scale factors before anything else
+    modelMtxBody.applyScaleLocal(mBodyScale);
+    // apply original model matrix (rotation)
+    modelMtxBody.setMul(model_mtx, modelMtxBody);
+
+    // same for every mesh
+    pShader->setViewUniform(modelMtxBody, view_mtx, proj_mtx);
+
+    const FFLColor modulateColor = FFLGetFavoriteColor(pCharInfo->favoriteColor);
+    const FFLModulateParam modulateParam = {
+        FFL_MODULATE_MODE_CONSTANT, // no texture
+        CUSTOM_MATERIAL_PARAM_BODY, // decides which material is bound
+        &modulateColor, // constant color (R)
+        nullptr, // no color G
+        nullptr, // no color B
+        nullptr  // no texture
+    };
+
     // Render each mesh in order
     for (u32 i = 0; i < mpBodyModel->numMeshes(); i++)
     {
         const rio::mdl::Mesh& mesh = meshes[i];
 
-        // Bind shader and set body material.
-        IShader* pShader = mpModel->getShader();
-        pShader->bind(lightEnable, pCharInfo);
-
         bool isPantsModel = ((i % 2) == 1); // is it the second mesh?
 
         if (isPantsModel
@@ -99,34 +121,11 @@ void BodyModel::draw(rio::Matrix34f& model_mtx, rio::BaseMtx34f& view_mtx, rio::
             pShader->setModulatePantsMaterial(mPantsColor);
         }
         else
-        {
-            const FFLColor modulateColor = FFLGetFavoriteColor(pCharInfo->favoriteColor);
-            const FFLModulateParam modulateParam = {
-                FFL_MODULATE_MODE_CONSTANT, // no texture
-                CUSTOM_MATERIAL_PARAM_BODY, // decides which material is bound
-                &modulateColor, // constant color (R)
-                nullptr, // no color G
-                nullptr, // no color B
-                nullptr  // no texture
-            };
-
             pShader->setModulate(modulateParam);
-        }
-
-        // make new matrix for body
-        rio::Matrix34f modelMtxBody = rio::Matrix34f::ident;//model_mtx;
-
-        // apply scale factors before anything else
-        modelMtxBody.applyScaleLocal(mBodyScale);
-        // apply original model matrix (rotation)
-        modelMtxBody.setMul(model_mtx, modelMtxBody);
-
-        pShader->setViewUniform(modelMtxBody, view_mtx, proj_mtx);
 
-        rio::RenderState render_state;
-        render_state.setCullingMode(rio::Graphics::CULLING_MODE_BACK);
-        render_state.applyCullingAndPolygonModeAndPolygonOffset();
         mesh.draw();
+        // the mesh binds its own VAO
+        IShader::forgetBoundState(IShader::BOUND_STATE_VERTEX_ARRAY);
     }
 }
 
@@ -143,8 +142,7 @@ rio::Vector3f BodyModel::calcBodyScale(f32 build, f32 height)
     bodyScale.x = (build * (height * 0.003671875f + 0.4f)) / 128.0f +
                     // 0.23 / 128.0 = 0.001796875
                     height * 0.001796875f + 0.4f;
-                    // 0.77 / 128.0 = 0.006015625
-    bodyScale.y = (height * 0.006015625f) + 0.5f;
+    bodyScale.y = calcBodyScaleY(height);
 
     /* the following set is found in ffl_app.rpx (FFLUtility)
      * Q:/sugar/program/ffl_application/src/mii/body/Scale.cpp
@@ -159,7 +157,7 @@ rio::Vector3f BodyModel::calcBodyScale(f32 build, f32 height)
     // pixels of the pants, but here without proper body scaling
     // this won't actually let you get away w/o pants
     f32 heightFactor = height / 128.0f;
-    bodyScale.y = heightFactor * 0.55 + 0.6;
+    bodyScale.y = calcBodyScaleY(height);
     bodyScale.x = heightFactor * 0.3 + 0.6;
     bodyScale.x = ((heightFactor * 0.6 + 0.8) - bodyScale.x) *
                         (build / 128.0f) + bodyScale.x;
@@ -0,0 +1,131 @@
+#include <CharModelCache.h>
+#include <Model.h>
+#include <ModelPool.h>
+
+#include <rio.h>
+
+#include <cstdio>
+
+static bool isSameKey(const CharModelCacheKey& a, const CharModelCacheKey& b)
+{
+    return a.charInfo == b.charInfo
+        && a.expressionFlag[0] == b.expressionFlag[0]
+        && a.expressionFlag[1] == b.expressionFlag[1]
+        && a.expressionFlag[2] == b.expressionFlag[2]
+        && a.resolution == b.resolution
+        && a.modelFlag == b.modelFlag
+        && a.resourceType == b.resourceType
+        && a.pTextureShader == b.pTextureShader;
+}
+
+CharModelCache::CharModelCache(u32 maxSize)
+    : mMaxSize(maxSize)
+    , mUseCounter(0)
+    , mHitCount(0)
+    , mMissCount(0)
+    , mEvictCount(0)
+{
+}
+
+void CharModelCache::setMaxSize(u32 maxSize)
+{
+    mMaxSize = maxSize;
+    evict_(mMaxSize);
+}
+
+Model* CharModelCache::acquire(const CharModelCacheKey& key)
+{
+    for (Entry& entry : mEntries)
+    {
+        if (!isSameKey(entry.key, key))
+            continue;
+        entry.refCount++;
+        entry.lastUse = ++mUseCounter;
+        mHitCount++;
+        return entry.pModel;
+    }
+    mMissCount++;
+    return nullptr;
+}
+
+void CharModelCache::insert(const CharModelCacheKey& key, Model* pModel)
+{
+    // make room for it, only unused models go
+    evict_(mMaxSize > 0 ? mMaxSize - 1 : 0);
+    if (mEntries.size() >= mMaxSize)
+        return; // everything is in use, freed on release instead
+
+    mEntries.push_back({ key, pModel, 1, ++mUseCounter });
+}
+
+void CharModelCache::release(Model* pModel)
+{
+    if (pModel == nullptr)
+        return;
+
+    for (Entry& entry : mEntries)
+    {
+        if (entry.pModel != pModel)
+            continue;
+        RIO_ASSERT(entry.refCount > 0);
+        entry.refCount--;
+        // stays around for the next request with the same key
+        evict_(mMaxSize);
+        return;
+    }
+
+    ModelPool::instance().free(pModel);
+}
+
+void CharModelCache::clear()
+{
+    evict_(0);
+}
+
+bool CharModelCache::evictLeastRecentlyUsed()
+{
+    size_t oldest = mEntries.size();
+    for (size_t i = 0; i < mEntries.size(); i++)
+    {
+        if (mEntries[i].refCount == 0
+            && (oldest == mEntries.size() || mEntries[i].lastUse < mEntries[oldest].lastUse))
+            oldest = i;
+    }
+    if (oldest == mEntries.size())
+        return false; // all in use
+
+    ModelPool::instance().free(mEntries[oldest].pModel);
+    mEntries.erase(mEntries.begin() + oldest);
+    mEvictCount++;
+    return true;
+}
+
+void CharModelCache::evict_(u32 maxSize)
+{
+    while (mEntries.size() > maxSize)
+    {
+        if (!evictLeastRecentlyUsed())
+            return; // all in use
+    }
+}
+
+std::string CharModelCache::formatMetrics() const
+{
+    char line[160];
+    std::string metrics;
+
+    snprintf(line, sizeof(line), "ffl_testing_char_model_cache_size %u\n", getSize());
+    metrics += line;
+    snprintf(line, sizeof(line), "ffl_testing_char_model_cache_size_max %u\n", mMaxSize);
+    metrics += line;
+    snprintf(line, sizeof(line), "ffl_testing_char_model_cache_hits_total %llu\n",
+             static_cast<unsigned long long>(mHitCount));
+    metrics += line;
+    snprintf(line, sizeof(line), "ffl_testing_char_model_cache_misses_total %llu\n",
+             static_cast<unsigned long long>(mMissCount));
+    metrics += line;
+    snprintf(line, sizeof(line), "ffl_testing_char_model_cache_evictions_total %llu\n",
+             static_cast<unsigned long long>(mEvictCount));
+    metrics += line;
+    return metrics;
+}
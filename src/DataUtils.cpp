@@ -12,6 +12,13 @@
 
 #include <mii_ext_MiiPort.h>
 
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define DATAUTILS_HAS_SSE2
+#endif
+
 
 void charInfoNXToFFLiCharInfo(FFLiCharInfo* dest, const charInfo* src)
 {
@@ -138,10 +145,12 @@ void studioToCharInfoNX(charInfo* dest, const charInfoStudio* src)
     // Other fields of charInfo will remain zero-initialized.
 }
 
-void studioURLObfuscationDecode(char* data)
+// The original decoder, kept as the reference the
+// fast paths are checked against in studioURLObfuscationSelfCheck.
+static void studioURLObfuscationDecodeReference(const u8* src, u8* dest)
 {
     // The first byte is the random seed used in encoding
-    unsigned char random = data[0];
+    unsigned char random = src[0];
     unsigned char previous = random;
 
     // Reverse the encoding process
@@ -149,14 +158,143 @@ void studioURLObfuscationDecode(char* data)
     for (int i = 1; i < STUDIO_DATA_ENCODED_LENGTH; i++)
     {
         // Reverse the modulation and XOR to find the original byte
-        unsigned char encodedByte = data[i];
+        unsigned char encodedByte = src[i];
         unsigned char original = (encodedByte - 7 + 256) % 256; // reverse the addition of 7
         original ^= previous; // reverse the XOR with the previous encoded byte
-        data[i - 1] = original;
+        dest[i - 1] = original;
         previous = encodedByte; // update previous to the current encoded byte for next iteration
     }
 }
 
+// Each decoded byte only depends on two encoded bytes:
+//   decoded[i] = (encoded[i + 1] - 7) ^ encoded[i]
+// so there is no chain between bytes and it vectorizes.
+static inline void studioURLObfuscationDecodeRecordScalar(const u8* src, u8* dest)
+{
+    // reading ahead of the write keeps this safe in place
+    for (int i = 0; i < STUDIO_DATA_ENCODED_LENGTH - 1; i++)
+        dest[i] = static_cast<u8>((src[i + 1] - 7) ^ src[i]);
+}
+
+#ifdef DATAUTILS_HAS_SSE2
+static inline void studioURLObfuscationDecodeRecordSSE2(const u8* src, u8* dest)
+{
+    const __m128i seven = _mm_set1_epi8(7);
+    // 46 bytes = 16 + 16 + 14, the last block overlaps the second
+    static const int cOffsets[3] = { 0, 16, STUDIO_DATA_ENCODED_LENGTH - 1 - 16 };
+    __m128i decoded[3];
+    // load everything first, so that decoding in place works
+    for (int i = 0; i < 3; i++)
+    {
+        const __m128i prev = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + cOffsets[i]));
+        const __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + cOffsets[i] + 1));
+        decoded[i] = _mm_xor_si128(_mm_sub_epi8(next, seven), prev);
+    }
+    for (int i = 0; i < 3; i++)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + cOffsets[i]), decoded[i]);
+}
+#endif // DATAUTILS_HAS_SSE2
+
+static inline void studioURLObfuscationDecodeRecord(const u8* src, u8* dest)
+{
+#ifdef DATAUTILS_HAS_SSE2
+    studioURLObfuscationDecodeRecordSSE2(src, dest);
+#else
+    studioURLObfuscationDecodeRecordScalar(src, dest);
+#endif
+}
+
+void studioURLObfuscationDecode(char* data)
+{
+    // The first byte is the random seed used in encoding,
+    // the rest is shifted down into its place
+    u8* bytes = reinterpret_cast<u8*>(data);
+    studioURLObfuscationDecodeRecord(bytes, bytes);
+}
+
+void studioURLObfuscationDecodeBatch(const void* src, charInfoStudio* dest, u32 count)
+{
+    const u8* encoded = static_cast<const u8*>(src);
+    for (u32 i = 0; i < count; i++)
+        studioURLObfuscationDecodeRecord(encoded + i * STUDIO_DATA_ENCODED_LENGTH,
+                                         reinterpret_cast<u8*>(&dest[i]));
+}
+
+// how many records and source misalignments the self check goes through
+#define STUDIO_SELF_CHECK_MAX_COUNT 8
+#define STUDIO_SELF_CHECK_MAX_OFFSET 16
+
+// fixed seed so that a failure is the same every run
+#define SELF_CHECK_RANDOM_SEED 0x2545F491
+
+// xorshift32, only for the self checks
+static u8 selfCheckRandom(u32* pState)
+{
+    u32 random = *pState;
+    random ^= random << 13;
+    random ^= random >> 17;
+    random ^= random << 5;
+    *pState = random;
+    return static_cast<u8>(random);
+}
+
+bool studioURLObfuscationSelfCheck()
+{
+    static const u32 cDecodedLength = STUDIO_DATA_ENCODED_LENGTH - 1;
+    static_assert(sizeof(charInfoStudio) == cDecodedLength, "charInfoStudio must be the decoded record");
+
+    u8 encoded[STUDIO_SELF_CHECK_MAX_OFFSET + STUDIO_SELF_CHECK_MAX_COUNT * STUDIO_DATA_ENCODED_LENGTH];
+    u8 expected[STUDIO_SELF_CHECK_MAX_COUNT * cDecodedLength];
+    charInfoStudio decoded[STUDIO_SELF_CHECK_MAX_COUNT];
+    u8 scalar[STUDIO_DATA_ENCODED_LENGTH];
+    u8 inPlace[STUDIO_DATA_ENCODED_LENGTH];
+
+    u32 random = SELF_CHECK_RANDOM_SEED;
+    for (u32 i = 0; i < sizeof(encoded); i++)
+        encoded[i] = selfCheckRandom(&random);
+
+    // every misalignment of the source against every batch size, so
+    // each of the three SSE2 blocks lands on every position in a line
+    for (u32 offset = 0; offset < STUDIO_SELF_CHECK_MAX_OFFSET; offset++)
+    {
+        for (u32 count = 1; count <= STUDIO_SELF_CHECK_MAX_COUNT; count++)
+        {
+            const u8* src = encoded + offset;
+            for (u32 i = 0; i < count; i++)
+                studioURLObfuscationDecodeReference(src + i * STUDIO_DATA_ENCODED_LENGTH,
+                                                    expected + i * cDecodedLength);
+
+            studioURLObfuscationDecodeBatch(src, decoded, count);
+            if (std::memcmp(decoded, expected, count * cDecodedLength) != 0)
+            {
+                RIO_LOG("studioURLObfuscationSelfCheck: batch of %u at offset %u differs from the reference\n", count, offset);
+                return false;
+            }
+
+            for (u32 i = 0; i < count; i++)
+            {
+                const u8* record = src + i * STUDIO_DATA_ENCODED_LENGTH;
+                const u8* pExpected = expected + i * cDecodedLength;
+
+                // the fallback too, it is not what runs on x86
+                studioURLObfuscationDecodeRecordScalar(record, scalar);
+                // and in place, which studioURLObfuscationDecode does
+                rio::MemUtil::copy(inPlace, record, STUDIO_DATA_ENCODED_LENGTH);
+                studioURLObfuscationDecode(reinterpret_cast<char*>(inPlace));
+
+                if (std::memcmp(scalar, pExpected, cDecodedLength) != 0
+                    || std::memcmp(inPlace, pExpected, cDecodedLength) != 0)
+                {
+                    RIO_LOG("studioURLObfuscationSelfCheck: record %u at offset %u differs from the reference\n", i, offset);
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
 void coreDataToCharInfoNX(charInfo* dest, const coreData* src)
 {
     // Initialize charInfo struct with zeros
@@ -219,45 +357,73 @@ void coreDataToCharInfoNX(charInfo* dest, const coreData* src)
 }
 
 
-FFLResult pickupCharInfoFromData(FFLiCharInfo* pCharInfo, const void* data, u32 dataLength, bool verifyCRC16)
+bool getMiiDataInputType(u32 dataLength, MiiDataInputType* pInputType)
 {
-    MiiDataInputType inputType;
-
     switch (dataLength)
     {
         case 76: // RFLStoreData, FFLiStoreDataRFL ....????? (idk if this exists)
-            inputType = INPUT_TYPE_RFL_STOREDATA;
-            break;
+            *pInputType = INPUT_TYPE_RFL_STOREDATA;
+            return true;
         case 74: // RFLCharData, FFLiMiiDataOfficialRFL
-            inputType = INPUT_TYPE_RFL_CHARDATA;
-            break;
+            *pInputType = INPUT_TYPE_RFL_CHARDATA;
+            return true;
         case sizeof(charInfo): // nx char info
-            inputType = INPUT_TYPE_NX_CHARINFO;
-            break;
+            *pInputType = INPUT_TYPE_NX_CHARINFO;
+            return true;
         case sizeof(coreData):
         case 68://sizeof(storeData):
-            inputType = INPUT_TYPE_NX_COREDATA;
-            break;
+            *pInputType = INPUT_TYPE_NX_COREDATA;
+            return true;
         case sizeof(charInfoStudio): // studio raw
-            inputType = INPUT_TYPE_STUDIO_RAW;
-            break;
+            *pInputType = INPUT_TYPE_STUDIO_RAW;
+            return true;
         case STUDIO_DATA_ENCODED_LENGTH: // studio encoded i think
-            inputType = INPUT_TYPE_STUDIO_ENCODED;
-            break;
+            *pInputType = INPUT_TYPE_STUDIO_ENCODED;
+            return true;
         case sizeof(FFLiMiiDataCore):
         case sizeof(FFLiMiiDataOfficial): // creator name unused
-            inputType = INPUT_TYPE_FFL_MIIDATACORE;
-            break;
+            *pInputType = INPUT_TYPE_FFL_MIIDATACORE;
+            return true;
         case sizeof(FFLStoreData):
-            inputType = INPUT_TYPE_FFL_STOREDATA;
-            break;
+            *pInputType = INPUT_TYPE_FFL_STOREDATA;
+            return true;
         default:
             // uh oh, we can't detect it
-            RIO_LOG("pickupCharInfoFromData: Unknown type for data size %d, returning error.\n", dataLength);
-            return FFL_RESULT_ERROR;
-            break;
+            return false;
+    }
+}
+
+u32 getMiiDataInputTypeSize(MiiDataInputType inputType)
+{
+    switch (inputType)
+    {
+        case INPUT_TYPE_RFL_STOREDATA:  return 76;
+        case INPUT_TYPE_RFL_CHARDATA:   return 74;
+        case INPUT_TYPE_NX_CHARINFO:    return sizeof(charInfo);
+        case INPUT_TYPE_NX_COREDATA:    return sizeof(coreData);
+        case INPUT_TYPE_STUDIO_RAW:     return sizeof(charInfoStudio);
+        case INPUT_TYPE_STUDIO_ENCODED: return STUDIO_DATA_ENCODED_LENGTH;
+        case INPUT_TYPE_FFL_MIIDATACORE: return sizeof(FFLiMiiDataCore);
+        case INPUT_TYPE_FFL_STOREDATA:  return sizeof(FFLStoreData);
+        default:                        return 0; // not supported
+    }
+}
+
+FFLResult pickupCharInfoFromData(FFLiCharInfo* pCharInfo, const void* data, u32 dataLength, bool verifyCRC16)
+{
+    MiiDataInputType inputType;
+    if (!getMiiDataInputType(dataLength, &inputType))
+    {
+        RIO_LOG("pickupCharInfoFromData: Unknown type for data size %d, returning error.\n", dataLength);
+        return FFL_RESULT_ERROR;
     }
 
+    return pickupCharInfoFromDataWithType(pCharInfo, data, inputType, verifyCRC16);
+}
+
+// data must be at least as long as the input type needs
+FFLResult pickupCharInfoFromDataWithType(FFLiCharInfo* pCharInfo, const void* data, MiiDataInputType inputType, bool verifyCRC16)
+{
     // create temporary charInfoNX for studio, coredata
     charInfo charInfoNX;
 
@@ -295,11 +461,10 @@ FFLResult pickupCharInfoFromData(FFLiCharInfo* pCharInfo, const void* data, u32
         case INPUT_TYPE_STUDIO_ENCODED:
         {
             // mii studio url data format is obfuscated
-            // decodes it in a buffer
-            char decodedData[STUDIO_DATA_ENCODED_LENGTH];
-            rio::MemUtil::copy(decodedData, data, STUDIO_DATA_ENCODED_LENGTH);
-            studioURLObfuscationDecode(decodedData);
-            studioToCharInfoNX(&charInfoNX, reinterpret_cast<::charInfoStudio*>(decodedData));
+            // decodes it straight out of the request
+            charInfoStudio studioData;
+            studioURLObfuscationDecodeBatch(data, &studioData, 1);
+            studioToCharInfoNX(&charInfoNX, &studioData);
             charInfoNXToFFLiCharInfo(pCharInfo, &charInfoNX);
             break;
         }
@@ -340,3 +505,151 @@ FFLResult pickupCharInfoFromData(FFLiCharInfo* pCharInfo, const void* data, u32
     }
     return FFL_RESULT_OK;
 }
+
+// nn::mii tables mapping ver3 (Wii U/3DS) colors to common colors
+static const u8 cVer3HairColorToCommon[8]  = { 8, 1, 2, 3, 4, 5, 6, 7 };
+static const u8 cVer3EyeColorToCommon[6]   = { 8, 9, 10, 11, 12, 13 };
+static const u8 cVer3MouthColorToCommon[5] = { 19, 20, 21, 22, 23 };
+static const u8 cVer3GlassColorToCommon[6] = { 8, 14, 15, 16, 17, 18 };
+
+template <u32 N>
+static u8 toCommonColor(u32 color, const u8 (&ver3Table)[N])
+{
+    // already a common color if it came from switch data
+    if (color & FFLI_NN_MII_COMMON_COLOR_ENABLE_MASK)
+        return static_cast<u8>(color & ~FFLI_NN_MII_COMMON_COLOR_ENABLE_MASK);
+    return color < N ? ver3Table[color] : static_cast<u8>(color);
+}
+
+void charInfoToStudio(charInfoStudio* dest, const FFLiCharInfo* src)
+{
+    dest->beard_color = toCommonColor(src->parts.beardColor, cVer3HairColorToCommon);
+    dest->beard_type = src->parts.beardType;
+    dest->build = src->build;
+    dest->eye_aspect = src->parts.eyeScaleY;
+    dest->eye_color = toCommonColor(src->parts.eyeColor, cVer3EyeColorToCommon);
+    dest->eye_rotate = src->parts.eyeRotate;
+    dest->eye_scale = src->parts.eyeScale;
+    dest->eye_type = src->parts.eyeType;
+    dest->eye_x = src->parts.eyeSpacingX;
+    dest->eye_y = src->parts.eyePositionY;
+    dest->eyebrow_aspect = src->parts.eyebrowScaleY;
+    dest->eyebrow_color = toCommonColor(src->parts.eyebrowColor, cVer3HairColorToCommon);
+    dest->eyebrow_rotate = src->parts.eyebrowRotate;
+    dest->eyebrow_scale = src->parts.eyebrowScale;
+    dest->eyebrow_type = src->parts.eyebrowType;
+    dest->eyebrow_x = src->parts.eyebrowSpacingX;
+    dest->eyebrow_y = src->parts.eyebrowPositionY;
+    // ver3 faceline colors are the first six common ones
+    dest->faceline_color = src->parts.facelineColor;
+    dest->faceline_make = src->parts.faceMakeup;
+    dest->faceline_type = src->parts.faceType;
+    dest->faceline_wrinkle = src->parts.faceLine;
+    dest->favorite_color = src->favoriteColor;
+    dest->gender = src->gender;
+    dest->glass_color = toCommonColor(src->parts.glassColor, cVer3GlassColorToCommon);
+    dest->glass_scale = src->parts.glassScale;
+    dest->glass_type = src->parts.glassType;
+    dest->glass_y = src->parts.glassPositionY;
+    dest->hair_color = toCommonColor(src->parts.hairColor, cVer3HairColorToCommon);
+    dest->hair_flip = src->parts.hairDir;
+    dest->hair_type = src->parts.hairType;
+    dest->height = src->height;
+    dest->mole_scale = src->parts.moleScale;
+    dest->mole_type = src->parts.moleType;
+    dest->mole_x = src->parts.molePositionX;
+    dest->mole_y = src->parts.molePositionY;
+    dest->mouth_aspect = src->parts.mouthScaleY;
+    dest->mouth_color = toCommonColor(src->parts.mouthColor, cVer3MouthColorToCommon);
+    dest->mouth_scale = src->parts.mouthScale;
+    dest->mouth_type = src->parts.mouthType;
+    dest->mouth_y = src->parts.mouthPositionY;
+    dest->mustache_scale = src->parts.mustacheScale;
+    dest->mustache_type = src->parts.mustacheType;
+    dest->mustache_y = src->parts.mustachePositionY;
+    dest->nose_scale = src->parts.noseScale;
+    dest->nose_type = src->parts.noseType;
+    dest->nose_y = src->parts.nosePositionY;
+}
+
+// how many random Miis miiDataConversionSelfCheck tries per input type
+#define CONVERSION_SELF_CHECK_COUNT 1024
+
+// the inverse of studioURLObfuscationDecode, for the self check
+static void studioURLObfuscationEncode(const charInfoStudio* src, u8 seed, u8* dest)
+{
+    const u8* decoded = reinterpret_cast<const u8*>(src);
+    dest[0] = seed;
+    for (int i = 0; i < STUDIO_DATA_ENCODED_LENGTH - 1; i++)
+        dest[i + 1] = static_cast<u8>((decoded[i] ^ dest[i]) + 7);
+}
+
+// The studio format holds every field that expected has, so the same
+// Mii has to come out the same through the raw and encoded studio paths.
+static bool checkSameAsStudio(const FFLiCharInfo& expected, u8 seed, const char* pathName, u32 index)
+{
+    charInfoStudio studio;
+    charInfoToStudio(&studio, &expected);
+    u8 encoded[STUDIO_DATA_ENCODED_LENGTH];
+    studioURLObfuscationEncode(&studio, seed, encoded);
+
+    FFLiCharInfo fromRaw;
+    FFLiCharInfo fromEncoded;
+    if (pickupCharInfoFromDataWithType(&fromRaw, &studio, INPUT_TYPE_STUDIO_RAW, false) != FFL_RESULT_OK
+        || pickupCharInfoFromDataWithType(&fromEncoded, encoded, INPUT_TYPE_STUDIO_ENCODED, false) != FFL_RESULT_OK
+        || std::memcmp(&fromRaw, &expected, sizeof(FFLiCharInfo)) != 0
+        || std::memcmp(&fromEncoded, &expected, sizeof(FFLiCharInfo)) != 0)
+    {
+        RIO_LOG("miiDataConversionSelfCheck: %s Mii %u differs from the studio path\n", pathName, index);
+        return false;
+    }
+    return true;
+}
+
+bool miiDataConversionSelfCheck()
+{
+    u32 random = SELF_CHECK_RANDOM_SEED;
+
+    for (u32 i = 0; i < CONVERSION_SELF_CHECK_COUNT; i++)
+    {
+        // coreData: every bitfield gets random bits, the eyebrow_y
+        // adjustment has to survive the trip through studio data.
+        // Fields studio data has no room for stay zero.
+        coreData core;
+        u8* coreBytes = reinterpret_cast<u8*>(&core);
+        for (u32 j = 0; j < sizeof(coreData); j++)
+            coreBytes[j] = selfCheckRandom(&random);
+        core.region_move = 0;
+        core.favorite_color %= FFL_FAVORITE_COLOR_MAX; // enums, keep them valid
+        rio::MemUtil::set(core.nickname, 0, sizeof(core.nickname));
+
+        FFLiCharInfo fromCore;
+        if (pickupCharInfoFromDataWithType(&fromCore, &core, INPUT_TYPE_NX_COREDATA, false) != FFL_RESULT_OK
+            || !checkSameAsStudio(fromCore, static_cast<u8>(i), "coreData", i))
+            return false;
+        // a round trip can't see this one, it is only in coreData
+        if (fromCore.parts.eyebrowPositionY != core.eyebrow_y + 3)
+        {
+            RIO_LOG("miiDataConversionSelfCheck: coreData Mii %u has eyebrow_y %u, not %u\n",
+                    i, static_cast<u32>(fromCore.parts.eyebrowPositionY), core.eyebrow_y + 3u);
+            return false;
+        }
+
+        // NX charInfo, every field is a whole byte
+        charInfo nx;
+        u8* nxBytes = reinterpret_cast<u8*>(&nx);
+        for (u32 j = 0; j < sizeof(charInfo); j++)
+            nxBytes[j] = selfCheckRandom(&random);
+        nx.region_move = 0;
+        nx.favorite_color %= FFL_FAVORITE_COLOR_MAX;
+        nx.gender %= FFL_GENDER_MAX;
+        rio::MemUtil::set(nx.nickname, 0, sizeof(nx.nickname));
+
+        FFLiCharInfo fromNX;
+        if (pickupCharInfoFromDataWithType(&fromNX, &nx, INPUT_TYPE_NX_CHARINFO, false) != FFL_RESULT_OK
+            || !checkSameAsStudio(fromNX, static_cast<u8>(i), "NX charInfo", i))
+            return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,63 @@
+#include <Fingerprint.h>
+
+#include <Types.h>
+#include <mii_ext_MiiPort.h>
+
+#include <cstring>
+
+#define FNV1A_64_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV1A_64_PRIME        0x100000001b3ULL
+
+// inputs are at most a few hundred bytes, so plain FNV-1a is plenty
+static u64 hashFNV1a64(const void* data, size_t size, u64 hash)
+{
+    const u8* bytes = static_cast<const u8*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= FNV1A_64_PRIME;
+    }
+    return hash;
+}
+
+u64 getCharInfoFingerprint(const FFLiCharInfo* pCharInfo)
+{
+    // studio data has exactly the visual fields, with common colors
+    charInfoStudio studio;
+    charInfoToStudio(&studio, pCharInfo);
+    return hashFNV1a64(&studio, sizeof(studio), FNV1A_64_OFFSET_BASIS);
+}
+
+u64 getRenderRequestFingerprint(const RenderRequest* pRequest)
+{
+    RenderRequest request;
+    memcpy(&request, pRequest, sizeof(RenderRequest));
+
+    // covered by the CharInfo fingerprint instead
+    memset(request.data, 0, sizeof(request.data));
+    request.dataLength = 0;
+    request.verifyCharInfo = false;
+    request.verifyCRC16 = false;
+
+    return hashFNV1a64(&request, sizeof(request), FNV1A_64_OFFSET_BASIS);
+}
+
+RenderFingerprint makeRenderFingerprint(const FFLiCharInfo* pCharInfo, const RenderRequest* pRequest)
+{
+    RenderFingerprint fingerprint;
+    fingerprint.charInfo = getCharInfoFingerprint(pCharInfo);
+    fingerprint.request = getRenderRequestFingerprint(pRequest);
+    return fingerprint;
+}
+
+void formatRenderFingerprint(char* dest, const RenderFingerprint& fingerprint)
+{
+    static const char cHexDigits[] = "0123456789abcdef";
+    const u64 values[2] = { fingerprint.charInfo, fingerprint.request };
+    for (u32 i = 0; i < RENDER_FINGERPRINT_STRING_LENGTH; i++)
+    {
+        const u64 value = values[i / 16];
+        const u32 shift = (15 - i % 16) * 4; // most significant digit first
+        dest[i] = cHexDigits[(value >> shift) & 0xf];
+    }
+}
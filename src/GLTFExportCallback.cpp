@@ -7,8 +7,28 @@
 #include <cstdio>
 #include <cassert>
 #include <iostream>
+#include <sstream>
 #include <misc/rio_MemUtil.h>
 
+#include <SocketWriter.h>
+#include <ThreadPool.h>
+#ifdef USE_EGL_HEADLESS
+    #include <HeadlessEGL.h>
+#endif
+
+#include <algorithm>
+#include <mutex>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define GLTF_EXPORT_HAS_SSE2
+#endif
+
+#ifdef USE_BASISU
+    #include <encoder/basisu_comp.h>
+#endif
+
 // Include stb_image_write implementation
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "for_gltf/stb_image_write.h"
@@ -22,6 +42,80 @@ namespace tinygltf {
 GLTFExportCallback::GLTFExportCallback()
 {
     mpCharModel = nullptr;
+    mImageFormat = IMAGE_FORMAT_PNG;
+    mQuantizeMeshes = false;
+    mpBodyMesh = nullptr;
+    mHasHeadTransform = false;
+    mpHatMesh = nullptr;
+}
+
+void GLTFExportCallback::SetBody(const StaticMesh* pBodyMesh, const rio::Vector3f& bodyScale, const FFLColor& bodyColor, const FFLColor* pPantsColor)
+{
+    mpBodyMesh = pBodyMesh;
+    mBodyScale = bodyScale;
+    mBodyColor = bodyColor;
+    // Alpha 0 marks the pants as left out
+    mPantsColor = pPantsColor != nullptr ? *pPantsColor : FFLColor{ 0.0f, 0.0f, 0.0f, 0.0f };
+}
+
+void GLTFExportCallback::SetHeadTransform(const rio::Vector3f& rotation, const rio::Vector3f& translation)
+{
+    mHasHeadTransform = true;
+    mHeadRotation = rotation;
+    mHeadTranslation = translation;
+}
+
+void GLTFExportCallback::SetHat(const StaticMesh* pHatMesh, const rio::Vector3f& translation, const FFLColor& hatColor)
+{
+    mpHatMesh = pHatMesh;
+    mHatTranslation = translation;
+    mHatColor = hatColor;
+}
+
+void GLTFExportCallback::EncodeStaticMesh(const rio::mdl::res::Model& resModel, StaticMesh& staticMesh)
+{
+    staticMesh.data.clear();
+    staticMesh.primitives.clear();
+
+    const rio::mdl::res::Mesh* meshes = resModel.meshes();
+    for (u32 i = 0; i < resModel.numMeshes(); i++)
+    {
+        const rio::mdl::res::Mesh& mesh = meshes[i];
+        const rio::mdl::res::Vertex* vertices = mesh.vertices();
+
+        StaticMesh::Primitive primitive;
+        primitive.vertexCount = mesh.numVertices();
+        primitive.indexCount = mesh.numIndices();
+        primitive.minPosition = { std::numeric_limits<double>::max(), std::numeric_limits<double>::max(), std::numeric_limits<double>::max() };
+        primitive.maxPosition = { std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest() };
+
+        // Every section is a multiple of 4 bytes, so they all stay aligned
+        const size_t vec3Size = primitive.vertexCount * 3 * sizeof(float);
+        primitive.positionOffset = staticMesh.data.size();
+        primitive.normalOffset = primitive.positionOffset + vec3Size;
+        primitive.indexOffset = primitive.normalOffset + vec3Size;
+        staticMesh.data.resize(primitive.indexOffset + primitive.indexCount * sizeof(uint32_t));
+
+        float* positions = reinterpret_cast<float*>(staticMesh.data.data() + primitive.positionOffset);
+        float* normals = reinterpret_cast<float*>(staticMesh.data.data() + primitive.normalOffset);
+        for (u32 v = 0; v < primitive.vertexCount; v++)
+        {
+            const float position[3] = { vertices[v].pos.x, vertices[v].pos.y, vertices[v].pos.z };
+            for (int c = 0; c < 3; c++)
+            {
+                positions[v * 3 + c] = position[c];
+                primitive.minPosition[c] = std::min<double>(primitive.minPosition[c], position[c]);
+                primitive.maxPosition[c] = std::max<double>(primitive.maxPosition[c], position[c]);
+            }
+            normals[v * 3 + 0] = vertices[v].normal.x;
+            normals[v * 3 + 1] = vertices[v].normal.y;
+            normals[v * 3 + 2] = vertices[v].normal.z;
+        }
+
+        std::memcpy(staticMesh.data.data() + primitive.indexOffset, mesh.indices(), primitive.indexCount * sizeof(uint32_t));
+
+        staticMesh.primitives.push_back(std::move(primitive));
+    }
 }
 
 // Static function implementations
@@ -73,6 +167,102 @@ void GLTFExportCallback::UnpackNormal_10_10_10_2(uint32_t packed, float& x, floa
     z = nz / 511.0f;
 }
 
+void GLTFExportCallback::DecodeFloatAttribute(const uint8_t* src, uint32_t stride, uint32_t vertexCount, uint32_t componentCount, float* out)
+{
+    const size_t elementSize = componentCount * sizeof(float);
+
+    // Tightly packed, which is the case for FFL's own buffers
+    if (stride == elementSize)
+    {
+        std::memcpy(out, src, vertexCount * elementSize);
+        return;
+    }
+
+    for (uint32_t i = 0; i < vertexCount; ++i)
+        std::memcpy(out + i * componentCount, src + i * stride, elementSize);
+}
+
+void GLTFExportCallback::DecodeNormals_10_10_10_2(const uint8_t* src, uint32_t stride, uint32_t vertexCount, float* out)
+{
+    uint32_t i = 0;
+
+#ifdef GLTF_EXPORT_HAS_SSE2
+    // Four tightly packed normals at a time
+    if (stride == sizeof(uint32_t))
+    {
+        const __m128 scale = _mm_set1_ps(511.0f);
+        for (; i + 4 <= vertexCount; i += 4)
+        {
+            const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * sizeof(uint32_t)));
+            // Same sign extension as UnpackNormal_10_10_10_2
+            alignas(16) float xyz[3][4];
+            _mm_store_ps(xyz[0], _mm_div_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(packed, 22), 22)), scale));
+            _mm_store_ps(xyz[1], _mm_div_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(packed, 12), 22)), scale));
+            _mm_store_ps(xyz[2], _mm_div_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(packed, 2), 22)), scale));
+            for (uint32_t j = 0; j < 4; ++j)
+            {
+                out[(i + j) * 3 + 0] = xyz[0][j];
+                out[(i + j) * 3 + 1] = xyz[1][j];
+                out[(i + j) * 3 + 2] = xyz[2][j];
+            }
+        }
+    }
+#endif
+
+    for (; i < vertexCount; ++i)
+    {
+        uint32_t packed;
+        std::memcpy(&packed, src + i * stride, sizeof(packed));
+        UnpackNormal_10_10_10_2(packed, out[i * 3 + 0], out[i * 3 + 1], out[i * 3 + 2]);
+    }
+}
+
+void GLTFExportCallback::DecodeTangents(const uint8_t* src, uint32_t stride, uint32_t vertexCount, float* out)
+{
+    for (uint32_t i = 0; i < vertexCount; ++i)
+    {
+        const int8_t* tangent = reinterpret_cast<const int8_t*>(src + i * stride);
+        if (tangent[3] == 0)
+            continue;
+        float x = tangent[0] / 127.0f;
+        float y = tangent[1] / 127.0f;
+        float z = tangent[2] / 127.0f;
+        float w = tangent[3] / 127.0f; // Usually, w is 1.0 or -1.0
+        // has to be normalized ourselves
+        // otherwise we see: Only (u)byte and (u)short accessors can be normalized
+
+        // Calculate magnitude of the tangent vector (x, y, z)
+        float magnitude = sqrtf(x * x + y * y + z * z);
+
+        // Normalize if needed
+        if (magnitude != 0.0f)
+        {
+            x /= magnitude;
+            y /= magnitude;
+            z /= magnitude;
+        }
+
+        out[i * 4 + 0] = x;
+        out[i * 4 + 1] = y;
+        out[i * 4 + 2] = z;
+        out[i * 4 + 3] = w; // w is not part of the normalization
+    }
+}
+
+void GLTFExportCallback::DecodeColors(const uint8_t* src, uint32_t stride, uint32_t vertexCount, uint8_t* out)
+{
+    // Stored as R8G8B8A8_UNORM, same as the input
+    if (stride == 4)
+    {
+        std::memcpy(out, src, vertexCount * 4);
+        return;
+    }
+
+    // A stride of 0 is one constant color for every vertex
+    for (uint32_t i = 0; i < vertexCount; ++i)
+        std::memcpy(out + i * 4, src + i * stride, 4);
+}
+
 int GLTFExportCallback::MapPrimitiveMode(rio::Drawer::PrimitiveMode mode)
 {
     switch (mode)
@@ -95,69 +285,215 @@ int GLTFExportCallback::MapPrimitiveMode(rio::Drawer::PrimitiveMode mode)
 }
 
 
-bool GLTFExportCallback::ExtractTextureToRGBA(rio::Texture2D* texture, std::vector<unsigned char>& rgbaData, int* width, int* height)
+void GLTFExportCallback::ConvertPixelsToRGBA(const unsigned char* pixels, int channels, int pixelCount, std::vector<unsigned char>& rgbaData)
+{
+    rgbaData.resize(pixelCount * 4); // Always RGBA
+
+    for (int i = 0; i < pixelCount; ++i)
+    {
+        unsigned char r = pixels[i * channels + 0];
+        rgbaData[i * 4 + 0] = r;
+        rgbaData[i * 4 + 1] = (channels > 1) ? pixels[i * channels + 1] : r;
+        rgbaData[i * 4 + 2] = (channels > 2) ? pixels[i * channels + 2] : r;
+        rgbaData[i * 4 + 3] = (channels > 3) ? pixels[i * channels + 3] : 255;
+    }
+}
+
+void GLTFExportCallback::EncodeTextures()
 {
+    mEncodedTextures.clear();
+
+    // Collect every texture the export will need, mesh textures
+    // in draw order first and then the other mask textures
+    std::vector<TextureEncodeJob> jobs;
+    std::unordered_map<rio::Texture2D*, size_t> jobIndices;
+
+    for (const MeshData& meshData : mMeshes)
+    {
+        // the first mesh using a texture decides its modulation
+        if (meshData.texture == nullptr || jobIndices.count(meshData.texture))
+            continue;
+        jobIndices[meshData.texture] = jobs.size();
+        jobs.push_back({ meshData.texture, &meshData });
+    }
+
+    if (mpCharModel != nullptr)
+    {
+        FFLiCharModel* pCharModel = reinterpret_cast<FFLiCharModel*>(mpCharModel);
+        for (int expr = 0; expr < FFL_EXPRESSION_MAX; ++expr)
+        {
+            if (expr == pCharModel->expression)
+                continue;
+
+            FFLiRenderTexture* renderTexture = pCharModel->maskTextures.pRenderTextures[expr];
+            if (renderTexture == nullptr || renderTexture->pTexture2D == nullptr
+                || jobIndices.count(renderTexture->pTexture2D))
+                continue;
+            jobIndices[renderTexture->pTexture2D] = jobs.size();
+            jobs.push_back({ renderTexture->pTexture2D, nullptr });
+        }
+    }
+
+    if (jobs.empty())
+        return;
+
 #if !RIO_IS_WIN
-    #pragma warning("GLTFExportCallback::ExtractTextureToRGBA does not work on non-Windows right now.")
-    RIO_ASSERT("GLTFExportCallback::ExtractTextureToRGBA does not work on non-Windows right now.");
-    return false;
+    #pragma warning("GLTFExportCallback::EncodeTextures does not work on non-Windows right now.")
+    RIO_ASSERT("GLTFExportCallback::EncodeTextures does not work on non-Windows right now.");
 #else
-    if (!texture) return false;
+    const bool wantKTX2 = mImageFormat == IMAGE_FORMAT_KTX2;
+
+#ifdef USE_EGL_HEADLESS
+    // Every worker reads back through its own context that shares
+    // the textures, so readbacks run alongside the encoding
+    for (TextureEncodeJob& job : jobs)
+    {
+        job.width = job.texture->getWidth();
+        job.height = job.texture->getHeight();
+        job.channels = rio::TextureFormatUtil::getPixelByteSize(job.texture->getTextureFormat());
+    }
+    // the other contexts only see the mask and faceline
+    // drawing once it has finished on this one
+    RIO_GL_CALL(glFinish());
 
-    // Use texture width, height, and internal format
-    *width = texture->getWidth();
-    *height = texture->getHeight();
-    rio::TextureFormat internalFormat = texture->getTextureFormat();
+    ThreadPool::instance().parallelFor(static_cast<u32>(jobs.size()), [this, &jobs, wantKTX2](u32 i)
+    {
+        TextureEncodeJob& job = jobs[i];
+        if (!HeadlessEGL::makeCurrentOnThisThread())
+            return;
 
-    // Determine format based on internal format
-    int channels = rio::TextureFormatUtil::getPixelByteSize(internalFormat);
-    GLenum format = texture->getNativeTexture().surface.nativeFormat.format;
+        const GLenum format = job.texture->getNativeTexture().surface.nativeFormat.format;
 
-    // Allocate buffer
-    std::vector<unsigned char> imageData(*width * *height * channels);
+        // Framebuffers are not shared between contexts, so each job makes its own
+        GLuint framebuffer;
+        RIO_GL_CALL(glGenFramebuffers(1, &framebuffer));
+        RIO_GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, framebuffer));
+        RIO_GL_CALL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, job.texture->getNativeTextureHandle(), 0));
 
-    // Create and bind a framebuffer
+        std::vector<unsigned char> pixels;
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE)
+        {
+            pixels.resize(job.width * job.height * job.channels);
+            RIO_GL_CALL(glReadPixels(0, 0, job.width, job.height, format, GL_UNSIGNED_BYTE, pixels.data()));
+        }
+
+        RIO_GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+        RIO_GL_CALL(glDeleteFramebuffers(1, &framebuffer));
+
+        if (!pixels.empty()) // texture gets skipped otherwise
+            EncodeTextureJob(job, pixels.data(), wantKTX2);
+    });
+#else
+    // Issue every readback into its own PBO up front so
+    // the driver can queue them without stalling on each one
     GLuint framebuffer;
     RIO_GL_CALL(glGenFramebuffers(1, &framebuffer));
     RIO_GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, framebuffer));
 
-    // Attach the texture to the framebuffer
-    RIO_GL_CALL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture->getNativeTextureHandle(), 0));
-
-    // Check if the framebuffer is complete
-    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-    if (status != GL_FRAMEBUFFER_COMPLETE)
+    for (TextureEncodeJob& job : jobs)
     {
-        RIO_GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
-        RIO_GL_CALL(glDeleteFramebuffers(1, &framebuffer));
-        return false;
+        // Use texture width, height, and internal format
+        job.width = job.texture->getWidth();
+        job.height = job.texture->getHeight();
+        job.channels = rio::TextureFormatUtil::getPixelByteSize(job.texture->getTextureFormat());
+        const GLenum format = job.texture->getNativeTexture().surface.nativeFormat.format;
+
+        // Attach the texture to the framebuffer
+        RIO_GL_CALL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, job.texture->getNativeTextureHandle(), 0));
+
+        // Check if the framebuffer is complete
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            continue; // pbo stays 0, texture gets skipped
+
+        GLuint pbo;
+        RIO_GL_CALL(glGenBuffers(1, &pbo));
+        RIO_GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo));
+        RIO_GL_CALL(glBufferData(GL_PIXEL_PACK_BUFFER, job.width * job.height * job.channels, nullptr, GL_STREAM_READ));
+        RIO_GL_CALL(glReadPixels(0, 0, job.width, job.height, format, GL_UNSIGNED_BYTE, nullptr));
+        job.pbo = pbo;
     }
 
-    // Read pixels from the framebuffer
-    RIO_GL_CALL(glReadPixels(0, 0, *width, *height, format, GL_UNSIGNED_BYTE, imageData.data()));
-
     // Unbind and delete the framebuffer
     RIO_GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
     RIO_GL_CALL(glDeleteFramebuffers(1, &framebuffer));
 
-    // Unbind texture
-    RIO_GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+    // Map all of them, the pointers are plain memory that the workers can read
+    for (TextureEncodeJob& job : jobs)
+    {
+        if (job.pbo == 0)
+            continue;
+        RIO_GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, job.pbo));
+        RIO_GL_CALL(job.pMapped = static_cast<const unsigned char*>(
+            glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, job.width * job.height * job.channels, GL_MAP_READ_BIT)));
+    }
+    RIO_GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
 
-    // Convert to RGBA and apply modulate mode and base color (pColorR)
-    rgbaData.resize(*width * *height * 4); // Always RGBA
+    // Convert, modulate and encode on the pool, no GL calls in here
+    ThreadPool::instance().parallelFor(static_cast<u32>(jobs.size()), [this, &jobs, wantKTX2](u32 i)
+    {
+        TextureEncodeJob& job = jobs[i];
+        if (job.pMapped != nullptr)
+            EncodeTextureJob(job, job.pMapped, wantKTX2);
+    });
 
-    for (int i = 0; i < *width * *height; ++i)
+    for (TextureEncodeJob& job : jobs)
     {
-        unsigned char r = imageData[i * channels + 0];
-        rgbaData[i * 4 + 0] = r;
-        rgbaData[i * 4 + 1] = (channels > 1) ? imageData[i * channels + 1] : r;
-        rgbaData[i * 4 + 2] = (channels > 2) ? imageData[i * channels + 2] : r;
-        rgbaData[i * 4 + 3] = (channels > 3) ? imageData[i * channels + 3] : 255;
+        if (job.pbo == 0)
+            continue;
+        if (job.pMapped != nullptr)
+        {
+            RIO_GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, job.pbo));
+            RIO_GL_CALL(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+        }
+        RIO_GL_CALL(glDeleteBuffers(1, &job.pbo));
+    }
+    RIO_GL_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+
+#endif // USE_EGL_HEADLESS
+
+    // Results are looked up by texture, so the order they
+    // end up in the model is the same as encoding serially
+    for (TextureEncodeJob& job : jobs)
+    {
+        if (job.encoded.pngData.empty())
+            RIO_LOG("Error: Failed to extract or encode texture %p.\n", job.texture);
+        else
+            mEncodedTextures[job.texture] = std::move(job.encoded);
     }
-    return true;
 #endif
 }
 
+void GLTFExportCallback::EncodeTextureJob(TextureEncodeJob& job, const unsigned char* pixels, bool wantKTX2)
+{
+    std::vector<unsigned char> rgbaData;
+    ConvertPixelsToRGBA(pixels, job.channels, job.width * job.height, rgbaData);
+
+    // Modify texture data based on modulate mode
+    if (job.pMeshData != nullptr)
+        ApplyModulateMode(*job.pMeshData, rgbaData);
+
+    // Same pixels encode to the same file, so skip the encoders when possible
+    const u64 hash = HashImageData(rgbaData, job.width, job.height);
+    if (LookupEncodedImage(hash, IMAGE_FORMAT_PNG, &job.encoded.pngData) == false)
+    {
+        if (!EncodeRGBADataToPNG(rgbaData, job.width, job.height, job.encoded.pngData))
+        {
+            job.encoded.pngData.clear();
+            return; // no fallback, skip the texture
+        }
+        StoreEncodedImage(hash, IMAGE_FORMAT_PNG, job.encoded.pngData);
+    }
+
+    if (wantKTX2 && LookupEncodedImage(hash, IMAGE_FORMAT_KTX2, &job.encoded.ktx2Data) == false)
+    {
+        // Without it the texture just has the PNG
+        if (EncodeRGBADataToKTX2(rgbaData, job.width, job.height, job.encoded.ktx2Data))
+            StoreEncodedImage(hash, IMAGE_FORMAT_KTX2, job.encoded.ktx2Data);
+        else
+            job.encoded.ktx2Data.clear();
+    }
+}
+
 bool GLTFExportCallback::EncodeRGBADataToPNG(const std::vector<unsigned char>& rgbaData, int width, int height, std::vector<unsigned char>& pngData)
 {
     const int channels = 4;
@@ -185,6 +521,89 @@ bool GLTFExportCallback::EncodeRGBADataToPNG(const std::vector<unsigned char>& r
     return true;
 }
 
+bool GLTFExportCallback::EncodeRGBADataToKTX2(const std::vector<unsigned char>& rgbaData, int width, int height, std::vector<unsigned char>& ktx2Data)
+{
+#ifdef USE_BASISU
+    static std::once_flag sEncoderInitFlag;
+    std::call_once(sEncoderInitFlag, [] { basisu::basisu_encoder_init(); });
+
+    basisu::vector<basisu::image> sourceImages;
+    sourceImages.push_back(basisu::image(rgbaData.data(), width, height, 4));
+
+    // UASTC keeps the detail in faceline and mask textures, zstd
+    // supercompression shrinks it back down for the transfer.
+    // Runs on a pool thread already so the encoder is single threaded.
+    const uint32_t flags = basisu::cFlagKTX2 | basisu::cFlagUASTC
+                         | basisu::cFlagKTX2UASTCSuperCompression
+                         | basisu::cFlagSRGB | basisu::cFlagGenMipsClamp;
+
+    size_t ktx2Size = 0;
+    void* pKTX2 = basisu::basis_compress(sourceImages, flags, 0.0f, &ktx2Size);
+    if (!pKTX2)
+        return false;
+
+    ktx2Data.assign(static_cast<unsigned char*>(pKTX2), static_cast<unsigned char*>(pKTX2) + ktx2Size);
+    basisu::basis_free_data(pKTX2);
+    return true;
+#else
+    (void)rgbaData; (void)width; (void)height; (void)ktx2Data;
+    static std::once_flag sWarnFlag;
+    std::call_once(sWarnFlag, [] { RIO_LOG("KTX2 textures were requested but this was built without USE_BASISU, using PNG only.\n"); });
+    return false;
+#endif
+}
+
+// Encoded images are kept around across exports, the same
+// Mii requested again (or one sharing e.g. a mouth texture)
+// produces identical pixels and can skip encoding entirely.
+#define GLTF_IMAGE_CACHE_MAX_SIZE (64 * 1024 * 1024) // bytes
+
+static std::mutex sImageCacheMutex;
+// one map per format, the same pixels are cached as PNG and as KTX2
+static std::unordered_map<u64, std::vector<unsigned char>> sImageCache[GLTFExportCallback::IMAGE_FORMAT_KTX2 + 1];
+static size_t sImageCacheSize = 0;
+
+u64 GLTFExportCallback::HashImageData(const std::vector<unsigned char>& rgbaData, int width, int height)
+{
+    // FNV-1a over 8 byte words, seeded with the dimensions
+    u64 hash = 0xcbf29ce484222325ULL ^ (static_cast<u64>(width) << 32 | static_cast<u32>(height));
+    const size_t wordCount = rgbaData.size() / sizeof(u64);
+    const unsigned char* pData = rgbaData.data();
+    for (size_t i = 0; i < wordCount; i++)
+    {
+        u64 word;
+        std::memcpy(&word, pData + i * sizeof(u64), sizeof(u64));
+        hash = (hash ^ word) * 0x100000001b3ULL;
+    }
+    for (size_t i = wordCount * sizeof(u64); i < rgbaData.size(); i++)
+        hash = (hash ^ pData[i]) * 0x100000001b3ULL;
+    return hash;
+}
+
+bool GLTFExportCallback::LookupEncodedImage(u64 hash, ImageFormat format, std::vector<unsigned char>* pData)
+{
+    std::lock_guard<std::mutex> lock(sImageCacheMutex);
+    const auto it = sImageCache[format].find(hash);
+    if (it == sImageCache[format].end())
+        return false;
+    *pData = it->second;
+    return true;
+}
+
+void GLTFExportCallback::StoreEncodedImage(u64 hash, ImageFormat format, const std::vector<unsigned char>& data)
+{
+    std::lock_guard<std::mutex> lock(sImageCacheMutex);
+    // just start over once it gets too big
+    if (sImageCacheSize + data.size() > GLTF_IMAGE_CACHE_MAX_SIZE)
+    {
+        for (auto& cache : sImageCache)
+            cache.clear();
+        sImageCacheSize = 0;
+    }
+    if (sImageCache[format].emplace(hash, data).second)
+        sImageCacheSize += data.size();
+}
+
 // Function to convert sRGB value to linear for baseColorFactor
 float GLTFExportCallback::SRGBToLinear(float color)
 {
@@ -256,181 +675,162 @@ void GLTFExportCallback::Draw(const FFLDrawParam& drawParam)
             return;
         }
 
-        // Collect indices
+        // Copy the indices, finding the highest one along the way
+        // to know how many vertices we need
         uint32_t indexCount = drawParam.primitiveParam.indexCount;
         const uint16_t* indices = static_cast<const uint16_t*>(drawParam.primitiveParam.pIndexBuffer);
-        meshData.indices.assign(indices, indices + indexCount);
+        meshData.indices.resize(indexCount);
+        uint16_t* outIndices = meshData.indices.data();
+        uint16_t maxIndex = 0;
+        for (uint32_t i = 0; i < indexCount; ++i)
+        {
+            outIndices[i] = indices[i];
+            maxIndex = std::max(maxIndex, indices[i]);
+        }
+        uint32_t vertexCount = maxIndex + 1;
 
         // When FFL set the cull mode to front... that means
         // that X is flipped so we have to reverse face winding
         // (glTF does not support front face culling)
         if (drawParam.cullMode == FFL_CULL_MODE_FRONT)
-            for (uint32_t i = 0; i < indexCount; i += 3)
+            for (uint32_t i = 0; i + 2 < indexCount; i += 3)
                 // Swap the first and last indices of each triangle to reverse winding
-                std::swap(meshData.indices[i], meshData.indices[i + 2]);
+                std::swap(outIndices[i], outIndices[i + 2]);
 
-        // Get the maximum vertex index to know how many vertices we need
-        uint16_t maxIndex = 0;
-        for (uint32_t i = 0; i < indexCount; ++i)
-            if (indices[i] > maxIndex)
-                maxIndex = indices[i];
-        uint32_t vertexCount = maxIndex + 1;
-
-        // Initialize per-vertex arrays
+        // Initialize per-vertex arrays, attributes
+        // that are missing are left as zeroes
         meshData.positions.resize(vertexCount * 3, 0.0f);
         meshData.normals.resize(vertexCount * 3, 0.0f);
         meshData.texcoords.resize(vertexCount * 2, 0.0f);
         meshData.tangents.resize(vertexCount * 4, 0.0f);
         meshData.colors.resize(vertexCount * 4, 0);
 
-        // Now process attribute buffers
+        // Decode each attribute buffer in one pass
         for (int type = FFL_ATTRIBUTE_BUFFER_TYPE_POSITION; type <= FFL_ATTRIBUTE_BUFFER_TYPE_COLOR; ++type)
         {
             const FFLAttributeBuffer& buffer = drawParam.attributeBufferParam.attributeBuffers[type];
-            void* ptr = buffer.ptr;
+            if (buffer.ptr == nullptr)
+                continue;
 
-            if (ptr)
+            uint32_t stride = buffer.stride;
+            if (stride < 1 && type != FFL_ATTRIBUTE_BUFFER_TYPE_COLOR)
             {
-                uint32_t stride = buffer.stride;
-                uint32_t size = buffer.size;
-
-                if (stride < 1 && type != FFL_ATTRIBUTE_BUFFER_TYPE_COLOR)
-                {
-                    RIO_LOG("Error: Stride is 0 and this is not the color attribute.\n");
-                    continue;
-                }
-                else if (stride > 0)
-                {
-                    uint32_t numElements = size / stride;
-
-                    if (numElements < vertexCount)
-                    {
-                        // Handle error
-                        RIO_LOG("Error: Not enough elements in attribute buffer.\n");
-                        continue;
-                    }
-
-                }
-
-                uint8_t* dataPtr = static_cast<uint8_t*>(ptr);
-                for (uint32_t i = 0; i < vertexCount; ++i)
-                {
-                    uint8_t* elemPtr = dataPtr + i * stride;
-
-                    switch (type)
-                    {
-                    case FFL_ATTRIBUTE_BUFFER_TYPE_POSITION:
-                    {
-                        float* position = reinterpret_cast<float*>(elemPtr);
-                        meshData.positions[i * 3 + 0] = position[0];
-                        meshData.positions[i * 3 + 1] = position[1];
-                        meshData.positions[i * 3 + 2] = position[2];
-                        break;
-                    }
-                    case FFL_ATTRIBUTE_BUFFER_TYPE_TEXCOORD:
-                    {
-                        float* texcoord = reinterpret_cast<float*>(elemPtr);
-                        meshData.texcoords[i * 2 + 0] = texcoord[0];
-                        meshData.texcoords[i * 2 + 1] = texcoord[1];
-                        break;
-                    }
-                    case FFL_ATTRIBUTE_BUFFER_TYPE_NORMAL:
-                    {
-                        uint32_t packedNormal = *reinterpret_cast<uint32_t*>(elemPtr);
-                        float x, y, z;
-                        UnpackNormal_10_10_10_2(packedNormal, x, y, z);
-                        meshData.normals[i * 3 + 0] = x;
-                        meshData.normals[i * 3 + 1] = y;
-                        meshData.normals[i * 3 + 2] = z;
-                        break;
-                    }
-                    case FFL_ATTRIBUTE_BUFFER_TYPE_TANGENT:
-                    {
-                        int8_t* tangent = reinterpret_cast<int8_t*>(elemPtr);
-                        if (tangent[3] == 0)
-                            continue;
-                        float x = tangent[0] / 127.0f;
-                        float y = tangent[1] / 127.0f;
-                        float z = tangent[2] / 127.0f;
-                        float w = tangent[3] / 127.0f; // Usually, w is 1.0 or -1.0
-                        // has to be normalized ourselves
-                        // otherwise we see: Only (u)byte and (u)short accessors can be normalized
-
-                        // Calculate magnitude of the tangent vector (x, y, z)
-                        float magnitude = sqrtf(x * x + y * y + z * z);
-
-                        // Normalize if needed
-                        if (magnitude != 0.0f)
-                        {
-                            x /= magnitude;
-                            y /= magnitude;
-                            z /= magnitude;
-                        }
-
-                        // Assign back to meshData
-                        meshData.tangents[i * 4 + 0] = x;
-                        meshData.tangents[i * 4 + 1] = y;
-                        meshData.tangents[i * 4 + 2] = z;
-                        meshData.tangents[i * 4 + 3] = w; // w is not part of the normalization
-                        break;
-                    }
-                    case FFL_ATTRIBUTE_BUFFER_TYPE_COLOR:
-                    {
-                        // default if there is no color
-                        if (stride < 1)
-                        {
-                            meshData.colors[i * 4 + 0] = 1;
-                            meshData.colors[i * 4 + 1] = 1;
-                            meshData.colors[i * 4 + 2] = 0;
-                            // set A (rim width) to 1, which is
-                            // default for the normal type otherwise
-                            meshData.colors[i * 4 + 3] = 1;
-                        }
-                        // Store color as R8G8B8A8_UNORM
-                        uint8_t* color = reinterpret_cast<uint8_t*>(elemPtr);
-#ifdef TRY_COLOR_AS_FLOATS
-                        meshData.colors[i * 4 + 0] = color[0] / 255.0f;
-                        meshData.colors[i * 4 + 1] = color[1] / 255.0f;
-                        meshData.colors[i * 4 + 2] = color[2] / 255.0f;
-                        meshData.colors[i * 4 + 3] = color[3] / 255.0f;
-#else
-                        meshData.colors[i * 4 + 0] = color[0];
-                        meshData.colors[i * 4 + 1] = color[1];
-                        meshData.colors[i * 4 + 2] = color[2];
-                        meshData.colors[i * 4 + 3] = color[3];
-#endif
-                        break;
-                    }
-                    default:
-                        break;
-                    }
-                }
+                RIO_LOG("Error: Stride is 0 and this is not the color attribute.\n");
+                continue;
+            }
+            else if (stride > 0 && buffer.size / stride < vertexCount)
+            {
+                // Handle error
+                RIO_LOG("Error: Not enough elements in attribute buffer.\n");
+                continue;
+            }
+
+            const uint8_t* src = static_cast<const uint8_t*>(buffer.ptr);
+            switch (type)
+            {
+            case FFL_ATTRIBUTE_BUFFER_TYPE_POSITION:
+                DecodeFloatAttribute(src, stride, vertexCount, 3, meshData.positions.data());
+                break;
+            case FFL_ATTRIBUTE_BUFFER_TYPE_TEXCOORD:
+                DecodeFloatAttribute(src, stride, vertexCount, 2, meshData.texcoords.data());
+                break;
+            case FFL_ATTRIBUTE_BUFFER_TYPE_NORMAL:
+                DecodeNormals_10_10_10_2(src, stride, vertexCount, meshData.normals.data());
+                break;
+            case FFL_ATTRIBUTE_BUFFER_TYPE_TANGENT:
+                DecodeTangents(src, stride, vertexCount, meshData.tangents.data());
+                break;
+            case FFL_ATTRIBUTE_BUFFER_TYPE_COLOR:
+                DecodeColors(src, stride, vertexCount, meshData.colors.data());
+                break;
+            default:
+                break;
             }
         }
 
         meshData.primitiveType = static_cast<rio::Drawer::PrimitiveMode>(drawParam.primitiveParam.primitiveType);
 
-        // Store the meshData
-        mMeshes.push_back(meshData);
+        // Store the meshData, moving its buffers
+        mMeshes.push_back(std::move(meshData));
     }
 }
 
 bool GLTFExportCallback::ExportModelInternal(const std::string& filename, std::ostream* outStream)
 {
     tinygltf::Model model;
+    std::vector<unsigned char> bufferData;
+    BuildModel(model, bufferData);
+
+    // Files and streams need the static data in the buffer itself
+    for (const StaticMesh* pStaticMesh : mSplicedMeshes)
+        bufferData.insert(bufferData.end(), pStaticMesh->data.begin(), pStaticMesh->data.end());
+
+    // Hand the buffer data over to the model without copying it
+    tinygltf::Buffer buffer;
+    buffer.data = std::move(bufferData);
+    model.buffers.push_back(std::move(buffer));
+
+    // Write the model to a GLTF file or output stream
+    return WriteModelToFileOrStream(model, filename, outStream);
+}
+
+bool GLTFExportCallback::ExportModelToSocket(int socket)
+{
+    tinygltf::Model model;
+    std::vector<unsigned char> bufferData;
+    BuildModel(model, bufferData);
 
+    // The model has no buffers, bufferData is sent as the BIN chunk directly
+    return WriteGLBToSocket(model, bufferData, socket);
+}
+
+void GLTFExportCallback::BuildModel(tinygltf::Model& model, std::vector<unsigned char>& bufferData)
+{
     // Set asset information
     model.asset.version = "2.0";
     model.asset.generator = "https://mii-unsecure.ariankordi.net (or if this site does not exist anymore: https://github.com/ariankordi)";
 
     // Initialize buffer and associated data structures
-    tinygltf::Buffer buffer;
-    std::vector<unsigned char> bufferData;
     size_t bufferSize = 0;
+    mSplicedMeshes.clear();
+
+    // Reserve room for all vertex data up front so the
+    // buffer isn't reallocated and copied as it grows
+    size_t reserveSize = 0;
+    for (const MeshData& meshData : mMeshes)
+    {
+        reserveSize += meshData.positions.size() * sizeof(float)
+                     + meshData.normals.size() * sizeof(float)
+                     + meshData.texcoords.size() * sizeof(float)
+                     + meshData.tangents.size() * sizeof(float)
+                     + meshData.colors.size() * sizeof(uint8_t)
+                     + meshData.indices.size() * sizeof(uint16_t)
+                     + 6 * 4; // worst case alignment padding per view
+    }
+    bufferData.reserve(reserveSize);
+
+    // Read back and encode all textures at once
+    EncodeTextures();
 
     // Prepare materials container
     std::vector<tinygltf::Material> materials;
 
+    // With a body or hat, the FFL meshes go under a head node
+    int headNodeIndex = -1;
+    if (mpBodyMesh != nullptr || mpHatMesh != nullptr)
+    {
+        tinygltf::Node headNode;
+        headNode.name = "head";
+        if (mHasHeadTransform)
+        {
+            headNode.rotation = EulerToQuaternion(mHeadRotation);
+            headNode.translation = { mHeadTranslation.x, mHeadTranslation.y, mHeadTranslation.z };
+        }
+        headNodeIndex = static_cast<int>(model.nodes.size());
+        model.nodes.push_back(headNode);
+        AddNodeToScene(model, headNodeIndex);
+    }
+
     // Process each mesh and construct GLTF components
     for (size_t meshIndex = 0; meshIndex < mMeshes.size(); ++meshIndex)
     {
@@ -440,8 +840,14 @@ bool GLTFExportCallback::ExportModelInternal(const std::string& filename, std::o
         tinygltf::Mesh gltfMesh;
         tinygltf::Primitive primitive;
 
+        // Node for the mesh, quantization puts its transform here
+        tinygltf::Node node;
+
         // Process mesh attributes and add to primitive
-        ProcessMeshAttributes(meshData, model, bufferData, bufferSize, primitive);
+        if (mQuantizeMeshes)
+            ProcessMeshAttributesQuantized(meshData, model, bufferData, bufferSize, primitive, node);
+        else
+            ProcessMeshAttributes(meshData, model, bufferData, bufferSize, primitive);
 
         // Set primitive mode based on the mesh's primitive type
         primitive.mode = MapPrimitiveMode(meshData.primitiveType);
@@ -470,28 +876,163 @@ bool GLTFExportCallback::ExportModelInternal(const std::string& filename, std::o
         model.meshes.push_back(gltfMesh);
         int meshIndexInModel = static_cast<int>(model.meshes.size() - 1);
 
-        // Create a node for the mesh
-        tinygltf::Node node;
+        // Point the node at the mesh
         node.mesh = meshIndexInModel;
         int nodeIndex = static_cast<int>(model.nodes.size());
         model.nodes.push_back(node);
 
-        // Add node to the default scene
-        AddNodeToScene(model, nodeIndex);
+        // Add node to the default scene, or the head
+        if (headNodeIndex != -1)
+            model.nodes[headNodeIndex].children.push_back(nodeIndex);
+        else
+            AddNodeToScene(model, nodeIndex);
     }
 
     // Handle additional mask textures if present
     HandleAdditionalMaskTextures(model, bufferData, bufferSize);
 
-    // Assign buffer data to the model
-    buffer.data = bufferData;
-    model.buffers.push_back(buffer);
-
     // Include character model information in the GLTF extras if available
     IncludeCharacterModelInfo(model);
 
-    // Write the model to a GLTF file or output stream
-    return WriteModelToFileOrStream(model, filename, outStream);
+    // Static meshes come last, their data follows the
+    // buffer data so it has to be complete by now
+    if (mpBodyMesh != nullptr || mpHatMesh != nullptr)
+    {
+        size_t padding = (4 - (bufferSize % 4)) % 4;
+        bufferData.insert(bufferData.end(), padding, 0);
+        bufferSize += padding;
+        size_t bufferEnd = bufferSize;
+
+        if (mpBodyMesh != nullptr)
+        {
+            // Even meshes are the body, odd ones the pants
+            std::vector<FFLColor> colors(mpBodyMesh->primitives.size());
+            for (size_t i = 0; i < colors.size(); ++i)
+                colors[i] = (i % 2) == 1 ? mPantsColor : mBodyColor;
+
+            const int bodyNodeIndex = AddStaticMeshNode(mpBodyMesh, colors, "body", model, bufferEnd);
+            model.nodes[bodyNodeIndex].scale = { mBodyScale.x, mBodyScale.y, mBodyScale.z };
+            AddNodeToScene(model, bodyNodeIndex);
+        }
+
+        if (mpHatMesh != nullptr)
+        {
+            const std::vector<FFLColor> colors(mpHatMesh->primitives.size(), mHatColor);
+            const int hatNodeIndex = AddStaticMeshNode(mpHatMesh, colors, "hat", model, bufferEnd);
+            model.nodes[hatNodeIndex].translation = { mHatTranslation.x, mHatTranslation.y, mHatTranslation.z };
+            model.nodes[headNodeIndex].children.push_back(hatNodeIndex);
+        }
+    }
+}
+
+/**
+ * @brief Adds the nodes for a static mesh, referencing its data after the buffer.
+ *
+ * @param pStaticMesh The encoded static model.
+ * @param colors The base color of each primitive, alpha 0 leaves it out.
+ * @param name The name of the node.
+ * @param model The GLTF model being constructed.
+ * @param bufferEnd The end of the buffer data so far, advanced past the static data.
+ * @return int The index of the new node.
+ */
+int GLTFExportCallback::AddStaticMeshNode(const StaticMesh* pStaticMesh, const std::vector<FFLColor>& colors, const std::string& name, tinygltf::Model& model, size_t& bufferEnd)
+{
+    tinygltf::Mesh gltfMesh;
+    gltfMesh.name = name;
+
+    // Adds a view and accessor into the static data
+    auto addAccessor = [&model, bufferEnd](size_t offset, size_t byteLength, size_t count, int type, int componentType, int target)
+    {
+        tinygltf::BufferView bufferView;
+        bufferView.buffer = 0;
+        bufferView.byteOffset = bufferEnd + offset;
+        bufferView.byteLength = byteLength;
+        bufferView.target = target;
+        model.bufferViews.push_back(bufferView);
+
+        tinygltf::Accessor accessor;
+        accessor.bufferView = static_cast<int>(model.bufferViews.size() - 1);
+        accessor.byteOffset = 0;
+        accessor.componentType = componentType;
+        accessor.count = count;
+        accessor.type = type;
+        model.accessors.push_back(accessor);
+        return static_cast<int>(model.accessors.size() - 1);
+    };
+
+    for (size_t i = 0; i < pStaticMesh->primitives.size(); ++i)
+    {
+        const StaticMesh::Primitive& source = pStaticMesh->primitives[i];
+        if (colors[i].a == 0.0f)
+            continue;
+
+        const size_t vec3Size = source.vertexCount * 3 * sizeof(float);
+
+        tinygltf::Primitive primitive;
+        primitive.mode = TINYGLTF_MODE_TRIANGLES;
+
+        const int positionAccessor = addAccessor(source.positionOffset, vec3Size, source.vertexCount,
+            TINYGLTF_TYPE_VEC3, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TARGET_ARRAY_BUFFER);
+        model.accessors[positionAccessor].minValues = source.minPosition;
+        model.accessors[positionAccessor].maxValues = source.maxPosition;
+        primitive.attributes["POSITION"] = positionAccessor;
+
+        primitive.attributes["NORMAL"] = addAccessor(source.normalOffset, vec3Size, source.vertexCount,
+            TINYGLTF_TYPE_VEC3, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TARGET_ARRAY_BUFFER);
+
+        primitive.indices = addAccessor(source.indexOffset, source.indexCount * sizeof(uint32_t), source.indexCount,
+            TINYGLTF_TYPE_SCALAR, TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT, TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER);
+
+        // Constant color, same as the shaders draw them
+        tinygltf::Material material;
+        material.name = name + "_" + std::to_string(i);
+        material.pbrMetallicRoughness.baseColorFactor = {
+            SRGBToLinear(colors[i].r),
+            SRGBToLinear(colors[i].g),
+            SRGBToLinear(colors[i].b),
+            colors[i].a
+        };
+        material.alphaMode = "OPAQUE";
+        material.doubleSided = false;
+        model.materials.push_back(material);
+        primitive.material = static_cast<int>(model.materials.size() - 1);
+
+        gltfMesh.primitives.push_back(primitive);
+    }
+
+    tinygltf::Node node;
+    node.name = name;
+    if (!gltfMesh.primitives.empty())
+    {
+        model.meshes.push_back(gltfMesh);
+        node.mesh = static_cast<int>(model.meshes.size() - 1);
+    }
+
+    // The data is written after the buffer in this order
+    mSplicedMeshes.push_back(pStaticMesh);
+    bufferEnd += pStaticMesh->data.size();
+
+    model.nodes.push_back(node);
+    return static_cast<int>(model.nodes.size() - 1);
+}
+
+/**
+ * @brief Converts an Euler rotation, applied X then Y then Z, to a glTF quaternion.
+ *
+ * @param rotation The rotation in radians.
+ * @return std::vector<double> The quaternion as x, y, z, w.
+ */
+std::vector<double> GLTFExportCallback::EulerToQuaternion(const rio::Vector3f& rotation)
+{
+    const double cx = cos(rotation.x * 0.5), sx = sin(rotation.x * 0.5);
+    const double cy = cos(rotation.y * 0.5), sy = sin(rotation.y * 0.5);
+    const double cz = cos(rotation.z * 0.5), sz = sin(rotation.z * 0.5);
+    return {
+        sx * cy * cz - cx * sy * sz,
+        cx * sy * cz + sx * cy * sz,
+        cx * cy * sz - sx * sy * cz,
+        cx * cy * cz + sx * sy * sz
+    };
 }
 
 //------------------------ Helper Functions for ExportModelInternal ------------------------
@@ -541,6 +1082,211 @@ void GLTFExportCallback::ProcessMeshAttributes(MeshData& meshData, tinygltf::Mod
     AddIndicesToBuffer(meshData.indices, model, bufferData, bufferSize, primitive);
 }
 
+/**
+ * @brief Remaps vertices into the order they are first referenced by the indices.
+ *
+ * Vertices that are never referenced are dropped. Makes vertex fetches
+ * mostly sequential and shrinks the buffers for meshes that use a subset.
+ *
+ * @param meshData The mesh data to reorder in place.
+ */
+void GLTFExportCallback::ReorderVerticesForFetch(MeshData& meshData)
+{
+    const size_t vertexCount = meshData.positions.size() / 3;
+    if (vertexCount == 0)
+        return;
+
+    std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+    uint32_t newCount = 0;
+    for (uint16_t& index : meshData.indices)
+    {
+        if (remap[index] == UINT32_MAX)
+            remap[index] = newCount++;
+        index = static_cast<uint16_t>(remap[index]);
+    }
+
+    // Move each attribute element to its new slot
+    auto reorder = [&remap, vertexCount, newCount](auto& data)
+    {
+        if (data.empty())
+            return;
+        const size_t components = data.size() / vertexCount;
+        typename std::remove_reference<decltype(data)>::type reordered(newCount * components);
+        for (size_t v = 0; v < vertexCount; ++v)
+        {
+            if (remap[v] == UINT32_MAX)
+                continue;
+            std::copy_n(&data[v * components], components, &reordered[remap[v] * components]);
+        }
+        data = std::move(reordered);
+    };
+    reorder(meshData.positions);
+    reorder(meshData.normals);
+    reorder(meshData.texcoords);
+    reorder(meshData.tangents);
+    reorder(meshData.colors);
+}
+
+/**
+ * @brief Processes mesh attributes with KHR_mesh_quantization and adds them to the GLTF primitive.
+ *
+ * Positions become int16 relative to the mesh bounds, the node gets the
+ * translation and scale to dequantize them. Normals and tangents become
+ * snorm8 and texture coordinates unorm16 when they are within 0-1.
+ *
+ * @param meshData The mesh data to process.
+ * @param model The GLTF model being constructed.
+ * @param bufferData The buffer data being accumulated.
+ * @param bufferSize The current size of the buffer.
+ * @param primitive The GLTF primitive to which attributes will be added.
+ * @param node The node for this mesh, which receives the dequantization transform.
+ */
+void GLTFExportCallback::ProcessMeshAttributesQuantized(MeshData& meshData, tinygltf::Model& model, std::vector<unsigned char>& bufferData, size_t& bufferSize, tinygltf::Primitive& primitive, tinygltf::Node& node)
+{
+    ReorderVerticesForFetch(meshData);
+    const size_t vertexCount = meshData.positions.size() / 3;
+
+    // Quantize positions around the center of the mesh with one uniform
+    // scale, so that normals aren't skewed by the node transform
+    float minVals[3] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+    float maxVals[3] = { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+    for (size_t i = 0; i < meshData.positions.size(); ++i)
+    {
+        minVals[i % 3] = std::min(minVals[i % 3], meshData.positions[i]);
+        maxVals[i % 3] = std::max(maxVals[i % 3], meshData.positions[i]);
+    }
+    float center[3];
+    float halfExtent = 0.0f;
+    for (int c = 0; c < 3; ++c)
+    {
+        center[c] = (minVals[c] + maxVals[c]) * 0.5f;
+        halfExtent = std::max(halfExtent, (maxVals[c] - minVals[c]) * 0.5f);
+    }
+    if (halfExtent == 0.0f)
+        halfExtent = 1.0f;
+    const float scale = halfExtent / 32767.0f;
+
+    std::vector<int16_t> positions(meshData.positions.size());
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+        const long q = lroundf((meshData.positions[i] - center[i % 3]) / scale);
+        positions[i] = static_cast<int16_t>(std::max(-32767L, std::min(32767L, q)));
+    }
+    AddQuantizedAttributeToBuffer(positions, 3, model, bufferData, bufferSize, primitive, "POSITION", TINYGLTF_TYPE_VEC3, TINYGLTF_COMPONENT_TYPE_SHORT, false);
+
+    node.translation = { center[0], center[1], center[2] };
+    node.scale = { scale, scale, scale };
+
+    // Texture coordinates as unorm16 if they fit, otherwise left as floats
+    if (!meshData.texcoords.empty() && meshData.texture != nullptr)
+    {
+        const bool inUnitRange = std::all_of(meshData.texcoords.begin(), meshData.texcoords.end(),
+            [](float v) { return v >= 0.0f && v <= 1.0f; });
+        if (inUnitRange)
+        {
+            std::vector<uint16_t> texcoords(meshData.texcoords.size());
+            for (size_t i = 0; i < texcoords.size(); ++i)
+                texcoords[i] = static_cast<uint16_t>(lroundf(meshData.texcoords[i] * 65535.0f));
+            AddQuantizedAttributeToBuffer(texcoords, 2, model, bufferData, bufferSize, primitive, "TEXCOORD_0", TINYGLTF_TYPE_VEC2, TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT, true);
+        }
+        else
+        {
+            AddAttributeToBuffer(meshData.texcoords, model, bufferData, bufferSize, primitive, "TEXCOORD_0", TINYGLTF_TYPE_VEC2, TINYGLTF_COMPONENT_TYPE_FLOAT, 2 * sizeof(float));
+        }
+    }
+
+    // snorm8 from a float that is already within -1 to 1
+    auto toSnorm8 = [](float v) { return static_cast<int8_t>(std::max(-127L, std::min(127L, lroundf(v * 127.0f)))); };
+
+    if (!meshData.normals.empty())
+    {
+        std::vector<int8_t> normals(meshData.normals.size());
+        std::transform(meshData.normals.begin(), meshData.normals.end(), normals.begin(), toSnorm8);
+        AddQuantizedAttributeToBuffer(normals, 3, model, bufferData, bufferSize, primitive, "NORMAL", TINYGLTF_TYPE_VEC3, TINYGLTF_COMPONENT_TYPE_BYTE, true);
+    }
+
+    if (!meshData.tangents.empty() && meshData.tangents[3] != 0.0f)
+    {
+        std::vector<int8_t> tangents(meshData.tangents.size());
+        std::transform(meshData.tangents.begin(), meshData.tangents.end(), tangents.begin(), toSnorm8);
+        AddQuantizedAttributeToBuffer(tangents, 4, model, bufferData, bufferSize, primitive, "TANGENT", TINYGLTF_TYPE_VEC4, TINYGLTF_COMPONENT_TYPE_BYTE, true);
+    }
+
+    // Colors are already 8 bit
+    if (!meshData.colors.empty() && vertexCount > 0)
+    {
+        AddAttributeToBuffer(meshData.colors, model, bufferData, bufferSize, primitive, "_COLOR", TINYGLTF_TYPE_VEC4,
+                             TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, 4 * sizeof(uint8_t), true);
+    }
+
+    AddIndicesToBuffer(meshData.indices, model, bufferData, bufferSize, primitive);
+
+    // Quantized attributes can't be read without the extension
+    if (std::find(model.extensionsRequired.begin(), model.extensionsRequired.end(), "KHR_mesh_quantization") == model.extensionsRequired.end())
+    {
+        model.extensionsUsed.push_back("KHR_mesh_quantization");
+        model.extensionsRequired.push_back("KHR_mesh_quantization");
+    }
+}
+
+/**
+ * @brief Adds a quantized vertex attribute, padding each element to 4 bytes as glTF requires.
+ *
+ * @param data The tightly packed vertex attribute data.
+ * @param componentCount The amount of components per vertex.
+ * @param model The GLTF model being constructed.
+ * @param bufferData The buffer data being accumulated.
+ * @param bufferSize The current size of the buffer.
+ * @param primitive The GLTF primitive to which the attribute will be added.
+ * @param attributeName The name of the attribute (e.g., "POSITION", "NORMAL").
+ * @param type The GLTF type of the attribute (e.g., TINYGLTF_TYPE_VEC3).
+ * @param componentType The GLTF component type (e.g., TINYGLTF_COMPONENT_TYPE_SHORT).
+ * @param normalized Whether the attribute data should be normalized.
+ */
+template <typename T>
+void GLTFExportCallback::AddQuantizedAttributeToBuffer(const std::vector<T>& data, size_t componentCount, tinygltf::Model& model, std::vector<unsigned char>& bufferData, size_t& bufferSize, tinygltf::Primitive& primitive, const std::string& attributeName, int type, int componentType, bool normalized)
+{
+    const size_t elementSize = componentCount * sizeof(T);
+    const size_t stride = (elementSize + 3) & ~static_cast<size_t>(3);
+    const size_t count = data.size() / componentCount;
+
+    // Vertex attributes must start 4 byte aligned
+    size_t padding = (4 - (bufferSize % 4)) % 4;
+    bufferData.insert(bufferData.end(), padding, 0);
+    bufferSize += padding;
+
+    tinygltf::BufferView bufferView;
+    bufferView.buffer = 0;
+    bufferView.byteOffset = bufferSize;
+    bufferView.byteLength = count * stride;
+    if (stride != elementSize)
+        bufferView.byteStride = stride;
+    bufferView.target = TINYGLTF_TARGET_ARRAY_BUFFER;
+    model.bufferViews.push_back(bufferView);
+
+    // Copy element by element, leaving the padding zeroed
+    bufferData.resize(bufferData.size() + count * stride, 0);
+    unsigned char* dst = bufferData.data() + bufferSize;
+    for (size_t i = 0; i < count; ++i)
+        std::memcpy(dst + i * stride, &data[i * componentCount], elementSize);
+    bufferSize += count * stride;
+
+    tinygltf::Accessor accessor;
+    accessor.bufferView = static_cast<int>(model.bufferViews.size() - 1);
+    accessor.byteOffset = 0;
+    accessor.componentType = componentType;
+    accessor.count = count;
+    accessor.type = type;
+    accessor.normalized = normalized;
+
+    // Min and max are required for positions, in the quantized units
+    if (attributeName == "POSITION")
+        CalculateAccessorMinMax(data, accessor);
+
+    model.accessors.push_back(accessor);
+    primitive.attributes[attributeName] = static_cast<int>(model.accessors.size() - 1);
+}
+
 /**
  * @brief Adds a vertex attribute to the GLTF buffer and primitive.
  *
@@ -710,7 +1456,7 @@ void GLTFExportCallback::AddPrimitiveExtras(MeshData& meshData, tinygltf::Primit
 }
 
 /**
- * @brief Processes a texture by extracting it, encoding to PNG, and adding it to the GLTF model.
+ * @brief Processes a texture by adding its PNG, encoded earlier by EncodeTextures, to the GLTF model.
  *
  * @param meshData The mesh data containing the texture.
  * @param model The GLTF model being constructed.
@@ -722,33 +1468,13 @@ void GLTFExportCallback::ProcessTexture(MeshData& meshData, tinygltf::Model& mod
     // Check if texture is already loaded
     if (mTextureMap.find(meshData.texture) == mTextureMap.end())
     {
-        // Extract texture data to RGBA
-        std::vector<unsigned char> rgbaData;
-        int texWidth, texHeight;
-        bool success = ExtractTextureToRGBA(meshData.texture, rgbaData, &texWidth, &texHeight);
-        if (!success)
-        {
-            RIO_LOG("Error: Failed to extract texture.\n");
+        // Image data was encoded ahead of time by EncodeTextures
+        const auto encoded = mEncodedTextures.find(meshData.texture);
+        if (encoded == mEncodedTextures.end())
             return; // Skip this texture
-        }
 
-        // Modify texture data based on modulate mode
-        ApplyModulateMode(meshData, rgbaData);
-
-        // Encode RGBA data to PNG
-        std::vector<unsigned char> pngData;
-        success = EncodeRGBADataToPNG(rgbaData, texWidth, texHeight, pngData);
-        if (!success)
-        {
-            RIO_LOG("Error: Failed to encode texture to PNG.\n");
-            return; // Skip this texture
-        }
-
-        // Add the PNG data to the buffer and create a BufferView
-        int imageIndex = AddImageToModel(model, bufferData, bufferSize, pngData, "Texture_" + std::to_string(mTextureMap.size()));
-
-        // Create a GLTF Texture and Sampler
-        int textureIndex = AddTextureToModel(model, imageIndex);
+        // Add the image data to the buffer and create a GLTF Texture and Sampler
+        int textureIndex = AddEncodedTextureToModel(model, bufferData, bufferSize, encoded->second, "Texture_" + std::to_string(mTextureMap.size()));
 
         // Map the texture to avoid duplicate entries
         mTextureMap[meshData.texture] = textureIndex;
@@ -761,7 +1487,7 @@ void GLTFExportCallback::ProcessTexture(MeshData& meshData, tinygltf::Model& mod
  * @param meshData The mesh data containing modulation parameters.
  * @param rgbaData The RGBA texture data to modify.
  */
-void GLTFExportCallback::ApplyModulateMode(MeshData& meshData, std::vector<unsigned char>& rgbaData)
+void GLTFExportCallback::ApplyModulateMode(const MeshData& meshData, std::vector<unsigned char>& rgbaData)
 {
     switch (meshData.modulateMode)
     {
@@ -816,16 +1542,18 @@ void GLTFExportCallback::ApplyModulateMode(MeshData& meshData, std::vector<unsig
  * @param model The GLTF model being constructed.
  * @param bufferData The buffer data being accumulated.
  * @param bufferSize The current size of the buffer.
- * @param pngData The PNG-encoded image data.
+ * @param pngData The encoded image data.
  * @param imageName The name to assign to the image.
+ * @param mimeType The MIME type of the encoded image data.
  * @return The index of the added image in the model's images array.
  */
-int GLTFExportCallback::AddImageToModel(tinygltf::Model& model, std::vector<unsigned char>& bufferData, size_t& bufferSize, const std::vector<unsigned char>& pngData, const std::string& imageName)
+int GLTFExportCallback::AddImageToModel(tinygltf::Model& model, std::vector<unsigned char>& bufferData, size_t& bufferSize, const std::vector<unsigned char>& pngData, const std::string& imageName, const char* mimeType)
 {
     tinygltf::Image image;
     image.name = imageName;
-    image.mimeType = "image/png";
-    image.image = pngData;
+    image.mimeType = mimeType;
+    // image.image is left empty, tinygltf only writes
+    // the bufferView for images that have one
 
     // Align buffer to 4 bytes for consistency
     size_t alignment = 4;
@@ -884,6 +1612,39 @@ int GLTFExportCallback::AddTextureToModel(tinygltf::Model& model, int imageIndex
     return textureIndex;
 }
 
+/**
+ * @brief Adds an encoded texture to the GLTF model, with its KTX2 variant if one was encoded.
+ *
+ * The PNG stays the texture's regular source as a fallback, the KTX2 image
+ * is referenced through the KHR_texture_basisu extension.
+ *
+ * @param model The GLTF model being constructed.
+ * @param bufferData The buffer data being accumulated.
+ * @param bufferSize The current size of the buffer.
+ * @param encoded The encoded image data for this texture.
+ * @param imageName The name to assign to the image(s).
+ * @return The index of the added texture in the model's textures array.
+ */
+int GLTFExportCallback::AddEncodedTextureToModel(tinygltf::Model& model, std::vector<unsigned char>& bufferData, size_t& bufferSize, const EncodedTexture& encoded, const std::string& imageName)
+{
+    const int imageIndex = AddImageToModel(model, bufferData, bufferSize, encoded.pngData, imageName);
+    const int textureIndex = AddTextureToModel(model, imageIndex);
+
+    if (!encoded.ktx2Data.empty())
+    {
+        const int ktx2ImageIndex = AddImageToModel(model, bufferData, bufferSize, encoded.ktx2Data, imageName + "_KTX2", "image/ktx2");
+        model.textures[textureIndex].extensions["KHR_texture_basisu"] = tinygltf::Value(tinygltf::Value::Object{
+            {"source", tinygltf::Value(ktx2ImageIndex)}
+        });
+
+        // Used but not required, viewers without it take the PNG
+        if (std::find(model.extensionsUsed.begin(), model.extensionsUsed.end(), "KHR_texture_basisu") == model.extensionsUsed.end())
+            model.extensionsUsed.push_back("KHR_texture_basisu");
+    }
+
+    return textureIndex;
+}
+
 /**
  * @brief Assigns a material to the primitive based on modulation mode and texture presence.
  *
@@ -1069,30 +1830,17 @@ void GLTFExportCallback::HandleAdditionalMaskTextures(tinygltf::Model& model, st
             if (mTextureMap.find(texture) != mTextureMap.end())
                 continue;
 
-            // Extract texture to RGBA
-            std::vector<unsigned char> rgbaData;
-            int texWidth, texHeight;
-            bool success = ExtractTextureToRGBA(texture, rgbaData, &texWidth, &texHeight);
-            if (!success)
+            // Image data was encoded ahead of time by EncodeTextures
+            const auto encoded = mEncodedTextures.find(texture);
+            if (encoded == mEncodedTextures.end())
             {
                 RIO_LOG("Failed to extract mask texture for expression %d\n", expr);
                 continue;
             }
 
-            // Encode RGBA data to PNG
-            std::vector<unsigned char> pngData;
-            if (!EncodeRGBADataToPNG(rgbaData, texWidth, texHeight, pngData))
-            {
-                RIO_LOG("Failed to encode mask texture to PNG for expression %d\n", expr);
-                continue;
-            }
-
-            // Add the PNG data to the buffer and create a BufferView
-            int imageIndex = AddImageToModel(model, bufferData, bufferSize, pngData, "MaskTexture_" + std::to_string(expr));
-
-            // Create a GLTF Texture and Sampler for the mask texture
-            int textureIndex = AddTextureToModel(model, imageIndex);
-            model.textures.back().name = "MaskTexture_" + std::to_string(expr);
+            // Add the image data to the buffer and create a GLTF Texture and Sampler for the mask texture
+            int textureIndex = AddEncodedTextureToModel(model, bufferData, bufferSize, encoded->second, "MaskTexture_" + std::to_string(expr));
+            model.textures[textureIndex].name = "MaskTexture_" + std::to_string(expr);
 
             // Map the texture to avoid duplicate entries
             mTextureMap[texture] = textureIndex;
@@ -1185,4 +1933,92 @@ bool GLTFExportCallback::WriteModelToFileOrStream(const tinygltf::Model& model,
     return true;
 }
 
+#define GLB_MAGIC         0x46546C67 // "glTF"
+#define GLB_VERSION       2
+#define GLB_CHUNK_JSON    0x4E4F534A // "JSON"
+#define GLB_CHUNK_BIN     0x004E4942 // "BIN\0"
+
+/**
+ * @brief Writes the GLTF model as a GLB to a socket, using bufferData as the BIN chunk.
+ *
+ * Only the JSON chunk is serialized into memory. The GLB header, JSON chunk and BIN
+ * chunk are sent with one vectored write so bufferData never gets copied.
+ *
+ * @param model The GLTF model to write, which must not contain any buffers.
+ * @param bufferData The buffer data that all buffer views refer to as buffer 0.
+ * @param socket The socket handle to write to.
+ * @return true if writing was successful, false otherwise.
+ */
+bool GLTFExportCallback::WriteGLBToSocket(const tinygltf::Model& model, const std::vector<unsigned char>& bufferData, int socket)
+{
+    RIO_ASSERT(model.buffers.empty());
+
+    // Serialize everything but the buffers as plain JSON
+    tinygltf::TinyGLTF gltfContext;
+    std::ostringstream jsonStream;
+    if (!gltfContext.WriteGltfSceneToStream(&model, jsonStream, false, false))
+    {
+        RIO_LOG("Failed to serialize glTF JSON.\n");
+        return false;
+    }
+    std::string json = jsonStream.str();
+
+    // Declare buffer 0 by hand, as it would have been serialized from buffer.data
+    const size_t closingBrace = json.rfind('}');
+    if (closingBrace == std::string::npos)
+        return false;
+    json.erase(closingBrace);
+    // Static meshes are spliced in right after the buffer data
+    size_t dataSize = bufferData.size();
+    for (const StaticMesh* pStaticMesh : mSplicedMeshes)
+        dataSize += pStaticMesh->data.size();
+    if (dataSize != 0)
+        json += ",\"buffers\":[{\"byteLength\":" + std::to_string(dataSize) + "}]";
+    json += '}';
+
+    // Chunks must be 4 byte aligned: JSON is padded with spaces, BIN with zeroes
+    json.append((4 - json.size() % 4) % 4, ' ');
+    static const uint8_t cZeroPadding[4] = { 0, 0, 0, 0 };
+    const uint32_t binPadding = static_cast<uint32_t>((4 - dataSize % 4) % 4);
+    const uint32_t binLength = static_cast<uint32_t>(dataSize) + binPadding;
+
+    const uint32_t totalLength = 12 + 8 + static_cast<uint32_t>(json.size())
+                               + (dataSize == 0 ? 0 : 8 + binLength);
+
+    // GLB header followed by the JSON chunk header
+    const uint32_t glbHeader[5] = {
+        GLB_MAGIC, GLB_VERSION, totalLength,
+        static_cast<uint32_t>(json.size()), GLB_CHUNK_JSON
+    };
+    const uint32_t binHeader[2] = { binLength, GLB_CHUNK_BIN };
+
+    // Body and hat at most, which keeps this within buffers and within
+    // what sendBuffersToSocket takes. Nothing was sent yet, so the
+    // client can still get an error instead of a cut off GLB.
+    if (mSplicedMeshes.size() > 2)
+    {
+        RIO_LOG("WriteGLBToSocket: %u static meshes, only 2 fit in one response\n",
+                static_cast<u32>(mSplicedMeshes.size()));
+        static const char cError[] = "ERROR: too many static meshes in the glTF model";
+        sendAllToSocket(socket, cError, sizeof(cError) - 1);
+        return false;
+    }
+    SocketBuffer buffers[7] = {
+        { glbHeader, sizeof(glbHeader) },
+        { json.data(), json.size() },
+        { binHeader, dataSize == 0 ? 0 : sizeof(binHeader) },
+        { bufferData.data(), bufferData.size() }
+    };
+    u32 bufferCount = 4;
+    for (const StaticMesh* pStaticMesh : mSplicedMeshes)
+        buffers[bufferCount++] = { pStaticMesh->data.data(), pStaticMesh->data.size() };
+    buffers[bufferCount++] = { cZeroPadding, binPadding };
+
+    if (!sendBuffersToSocket(socket, buffers, bufferCount))
+        return false;
+
+    RIO_LOG("Wrote %u bytes out to socket.\n", totalLength);
+    return true;
+}
+
 #endif // NO_GLTF
@@ -45,38 +45,40 @@ void HatModel::draw(rio::Matrix34f& model_mtx, rio::BaseMtx34f& view_mtx, rio::B
 
     const rio::mdl::Mesh* meshes = mpHatModel->meshes(); // Hat mesh.
 
-    // Render each mesh in order
-    for (u32 i = 0; i < mpHatModel->numMeshes(); i++)
-    {
-        const rio::mdl::Mesh& mesh = meshes[i];
+    // Bind shader once, the material is set per mesh.
+    IShader* pShader = mpModel->getShader();
+    pShader->bind(lightEnable, pCharInfo);
+    IShader::setCulling(FFL_CULL_MODE_BACK);
 
-        // Bind shader and set hat material.
-        IShader* pShader = mpModel->getShader();
-        pShader->bind(lightEnable, pCharInfo);
+    // make new matrix for body
+    rio::Matrix34f modelMtxHat = rio::Matrix34f::ident;//model_mtx;
 
-        const FFLColor modulateColor = mHatColor;
-        const FFLModulateParam modulateParam = {
-            FFL_MODULATE_MODE_CONSTANT, // no texture for now
-            CUSTOM_MATERIAL_PARAM_HAT, // decides which material is bound
-            &modulateColor, // constant color (R)
-            nullptr, // no color G
-            nullptr, // no color B
-            nullptr  // no texture
-        };
+    // apply original model matrix (rotation)
+    modelMtxHat.setMul(model_mtx, modelMtxHat);
 
-        pShader->setModulate(modulateParam);
+    // same for every mesh
+    pShader->setViewUniform(modelMtxHat, view_mtx, proj_mtx);
 
-        // make new matrix for body
-        rio::Matrix34f modelMtxHat = rio::Matrix34f::ident;//model_mtx;
+    // every hat mesh uses the same material
+    const FFLColor modulateColor = mHatColor;
+    const FFLModulateParam modulateParam = {
+        FFL_MODULATE_MODE_CONSTANT, // no texture for now
+        CUSTOM_MATERIAL_PARAM_HAT, // decides which material is bound
+        &modulateColor, // constant color (R)
+        nullptr, // no color G
+        nullptr, // no color B
+        nullptr  // no texture
+    };
 
-        // apply original model matrix (rotation)
-        modelMtxHat.setMul(model_mtx, modelMtxHat);
+    pShader->setModulate(modulateParam);
 
-        pShader->setViewUniform(modelMtxHat, view_mtx, proj_mtx);
+    // Render each mesh in order
+    for (u32 i = 0; i < mpHatModel->numMeshes(); i++)
+    {
+        const rio::mdl::Mesh& mesh = meshes[i];
 
-        rio::RenderState render_state;
-        render_state.setCullingMode(rio::Graphics::CULLING_MODE_BACK);
-        render_state.applyCullingAndPolygonModeAndPolygonOffset();
         mesh.draw();
+        // the mesh binds its own VAO
+        IShader::forgetBoundState(IShader::BOUND_STATE_VERTEX_ARRAY);
     }
 }
\ No newline at end of file
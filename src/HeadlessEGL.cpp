@@ -0,0 +1,304 @@
+#include <HeadlessEGL.h>
+
+#ifdef USE_EGL_HEADLESS
+
+#ifdef RIO_USE_GLEW
+#error "USE_EGL_HEADLESS needs GLAD, GLEW loads its functions through GLX"
+#endif
+
+#include <EGL/eglext.h>
+
+#include <cstring>
+
+// not in every eglext.h yet
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+// EGL_MESA_query_driver
+typedef const char* (EGLAPIENTRYP GetDisplayDriverNameProc)(EGLDisplay display);
+
+EGLDisplay  HeadlessEGL::sDisplay    = EGL_NO_DISPLAY;
+EGLConfig   HeadlessEGL::sConfig     = nullptr;
+EGLContext  HeadlessEGL::sContext    = EGL_NO_CONTEXT;
+const char* HeadlessEGL::sDeviceName = "";
+
+// A worker's own context, destroyed when the thread exits
+// (ThreadPool workers live until the pool is destroyed).
+struct ThreadContext
+{
+    EGLContext context = EGL_NO_CONTEXT;
+    ~ThreadContext() { HeadlessEGL::releaseThisThread(); }
+};
+static thread_local ThreadContext sThreadContext;
+
+static bool hasExtension(const char* extensions, const char* name)
+{
+    if (extensions == nullptr)
+        return false;
+
+    const size_t length = strlen(name);
+    for (const char* p = strstr(extensions, name); p != nullptr; p = strstr(p + length, name))
+        // whole words only, EGL_EXT_device_base would match EGL_EXT_device_base_foo
+        if ((p == extensions || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0'))
+            return true;
+
+    return false;
+}
+
+bool HeadlessEGL::initializeDisplay_()
+{
+    // client extensions, EGL_NO_DISPLAY is fine here since EGL 1.5
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+        eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (getPlatformDisplay == nullptr)
+    {
+        RIO_LOG("EGL: eglGetPlatformDisplayEXT is missing, libEGL is too old\n");
+        return false;
+    }
+
+    EGLDeviceEXT softwareDevice = EGL_NO_DEVICE_EXT;
+
+    // a GPU first, any device that is not Mesa's software one
+    if (hasExtension(clientExtensions, "EGL_EXT_device_enumeration")
+        && hasExtension(clientExtensions, "EGL_EXT_platform_device"))
+    {
+        auto queryDevices = reinterpret_cast<PFNEGLQUERYDEVICESEXTPROC>(
+            eglGetProcAddress("eglQueryDevicesEXT"));
+        auto queryDeviceString = reinterpret_cast<PFNEGLQUERYDEVICESTRINGEXTPROC>(
+            eglGetProcAddress("eglQueryDeviceStringEXT"));
+
+        EGLDeviceEXT devices[16];
+        EGLint deviceCount = 0;
+        if (queryDevices != nullptr && queryDevices(16, devices, &deviceCount))
+        {
+            for (EGLint i = 0; i < deviceCount; i++)
+            {
+                const char* deviceExtensions = queryDeviceString != nullptr
+                    ? queryDeviceString(devices[i], EGL_EXTENSIONS) : nullptr;
+                if (hasExtension(deviceExtensions, "EGL_MESA_device_software"))
+                {
+                    if (softwareDevice == EGL_NO_DEVICE_EXT)
+                        softwareDevice = devices[i];
+                    continue;
+                }
+
+                EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_DEVICE_EXT, devices[i], nullptr);
+                if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr))
+                {
+                    sDisplay = display;
+                    return true;
+                }
+            }
+        }
+    }
+
+    // then Mesa without a window system, which picks the GPU
+    // through the render node when it can and llvmpipe otherwise
+    if (hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless"))
+    {
+        EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr))
+        {
+            sDisplay = display;
+            return true;
+        }
+    }
+
+    // and llvmpipe as a device as the last resort
+    if (softwareDevice != EGL_NO_DEVICE_EXT)
+    {
+        EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_DEVICE_EXT, softwareDevice, nullptr);
+        if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr))
+        {
+            sDisplay = display;
+            return true;
+        }
+    }
+
+    RIO_LOG("EGL: no display without a window system, need EGL_EXT_platform_device or EGL_MESA_platform_surfaceless\n");
+    return false;
+}
+
+EGLContext HeadlessEGL::createContext_(EGLContext shareContext)
+{
+    static const EGLint cContextAttribs[] = {
+#if RIO_GLES
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 0,
+#else
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+#endif
+        EGL_NONE
+    };
+
+    return eglCreateContext(sDisplay, sConfig, shareContext, cContextAttribs);
+}
+
+bool HeadlessEGL::initialize()
+{
+    RIO_ASSERT(sDisplay == EGL_NO_DISPLAY);
+
+    if (!initializeDisplay_())
+        return false;
+
+    const char* displayExtensions = eglQueryString(sDisplay, EGL_EXTENSIONS);
+    if (!hasExtension(displayExtensions, "EGL_KHR_surfaceless_context"))
+    {
+        RIO_LOG("EGL: EGL_KHR_surfaceless_context is missing\n");
+        finalize();
+        return false;
+    }
+
+#if RIO_GLES
+    const EGLenum api = EGL_OPENGL_ES_API;
+    const EGLint renderableType = EGL_OPENGL_ES3_BIT;
+#else
+    const EGLenum api = EGL_OPENGL_API;
+    const EGLint renderableType = EGL_OPENGL_BIT;
+#endif
+
+    // no surface type: everything goes into RenderTexture FBOs
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE,    0,
+        EGL_RENDERABLE_TYPE, renderableType,
+        EGL_NONE
+    };
+    EGLint configCount = 0;
+    if (!eglBindAPI(api)
+        || !eglChooseConfig(sDisplay, configAttribs, &sConfig, 1, &configCount)
+        || configCount == 0)
+    {
+        RIO_LOG("EGL: no config for the API (error 0x%04X)\n", eglGetError());
+        finalize();
+        return false;
+    }
+
+    sContext = createContext_(EGL_NO_CONTEXT);
+    if (sContext == EGL_NO_CONTEXT
+        || !eglMakeCurrent(sDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, sContext))
+    {
+        RIO_LOG("EGL: could not make a context current (error 0x%04X)\n", eglGetError());
+        finalize();
+        return false;
+    }
+
+    // the window's function pointers do not belong to this context
+#if RIO_GLES
+    const int loaded = gladLoadGLES2Loader(reinterpret_cast<GLADloadproc>(eglGetProcAddress));
+#else
+    const int loaded = gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress));
+#endif
+    if (!loaded)
+    {
+        RIO_LOG("EGL: could not load the GL functions\n");
+        finalize();
+        return false;
+    }
+
+    // prefer the driver name over the vendor, "llvmpipe" says more than "Mesa"
+    auto getDisplayDriverName = hasExtension(displayExtensions, "EGL_MESA_query_driver")
+        ? reinterpret_cast<GetDisplayDriverNameProc>(eglGetProcAddress("eglGetDisplayDriverName"))
+        : nullptr;
+    const char* driverName = getDisplayDriverName != nullptr ? getDisplayDriverName(sDisplay) : nullptr;
+    sDeviceName = driverName != nullptr ? driverName : eglQueryString(sDisplay, EGL_VENDOR);
+
+    RIO_LOG("EGL: rendering on %s (%s), %s\n", sDeviceName,
+            reinterpret_cast<const char*>(glGetString(GL_RENDERER)),
+            reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+    return true;
+}
+
+void HeadlessEGL::finalize()
+{
+    if (sDisplay == EGL_NO_DISPLAY)
+        return;
+
+    releaseThisThread();
+    eglMakeCurrent(sDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (sContext != EGL_NO_CONTEXT)
+        eglDestroyContext(sDisplay, sContext);
+    // also destroys the contexts of workers that are still around,
+    // they only forget theirs when they exit, see releaseThisThread
+    eglTerminate(sDisplay);
+
+    sDisplay = EGL_NO_DISPLAY;
+    sConfig = nullptr;
+    sContext = EGL_NO_CONTEXT;
+    sDeviceName = "";
+}
+
+bool HeadlessEGL::makeCurrent()
+{
+    RIO_ASSERT(sContext != EGL_NO_CONTEXT);
+
+    // catches another EGL context, or ours being released. OSMesa
+    // does not tell EGL when it takes over, which is why RootTask
+    // never makes rio's window context current with this enabled
+    if (eglGetCurrentContext() == sContext)
+        return true;
+
+    RIO_LOG("EGL: the context was not current anymore, making it current again\n");
+    if (!eglMakeCurrent(sDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, sContext))
+    {
+        RIO_LOG("EGL: could not make the context current again (error 0x%04X)\n", eglGetError());
+        return false;
+    }
+    return true;
+}
+
+bool HeadlessEGL::makeCurrentOnThisThread()
+{
+    RIO_ASSERT(sContext != EGL_NO_CONTEXT);
+
+    // the render thread, or a worker that already has its own
+    const EGLContext current = eglGetCurrentContext();
+    if (current == sContext
+        || (current != EGL_NO_CONTEXT && current == sThreadContext.context))
+        return true;
+
+    if (sThreadContext.context == EGL_NO_CONTEXT)
+    {
+        // eglBindAPI is per thread
+#if RIO_GLES
+        eglBindAPI(EGL_OPENGL_ES_API);
+#else
+        eglBindAPI(EGL_OPENGL_API);
+#endif
+        sThreadContext.context = createContext_(sContext);
+        if (sThreadContext.context == EGL_NO_CONTEXT)
+        {
+            RIO_LOG("EGL: could not make a context for a worker (error 0x%04X)\n", eglGetError());
+            return false;
+        }
+    }
+
+    // the function pointers from initialize work with any context on
+    // the same display, so there is nothing to load again
+    if (!eglMakeCurrent(sDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, sThreadContext.context))
+    {
+        RIO_LOG("EGL: could not make a worker's context current (error 0x%04X)\n", eglGetError());
+        return false;
+    }
+    return true;
+}
+
+void HeadlessEGL::releaseThisThread()
+{
+    if (sThreadContext.context == EGL_NO_CONTEXT)
+        return;
+
+    // after finalize, eglTerminate already took care of it
+    if (sDisplay != EGL_NO_DISPLAY)
+    {
+        eglMakeCurrent(sDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(sDisplay, sThreadContext.context);
+    }
+    sThreadContext.context = EGL_NO_CONTEXT;
+}
+
+#endif // USE_EGL_HEADLESS
@@ -0,0 +1,95 @@
+#include <IShader.h>
+
+#include <gpu/rio_RenderState.h>
+
+#define BOUND_TEXTURE_SLOT_MAX 8
+
+static rio::Shader*                 sBoundProgram = nullptr;
+#if RIO_IS_WIN
+static u32                          sBoundVertexArray = GL_NONE;
+#endif
+static const rio::TextureSampler2D* sBoundSampler[BOUND_TEXTURE_SLOT_MAX] = {};
+static const rio::Texture2D*        sBoundTexture[BOUND_TEXTURE_SLOT_MAX] = {};
+static FFLCullMode                  sCullMode = FFL_CULL_MODE_MAX; // unknown
+
+void IShader::forgetBoundState(u32 states)
+{
+    if (states & BOUND_STATE_PROGRAM)
+        sBoundProgram = nullptr;
+#if RIO_IS_WIN
+    if (states & BOUND_STATE_VERTEX_ARRAY)
+        sBoundVertexArray = GL_NONE;
+#endif
+    if (states & BOUND_STATE_TEXTURE)
+    {
+        for (u32 i = 0; i < BOUND_TEXTURE_SLOT_MAX; i++)
+        {
+            sBoundSampler[i] = nullptr;
+            sBoundTexture[i] = nullptr;
+        }
+    }
+    if (states & BOUND_STATE_CULL_MODE)
+        sCullMode = FFL_CULL_MODE_MAX;
+}
+
+void IShader::bindProgram_(rio::Shader* pProgram)
+{
+    if (pProgram == sBoundProgram)
+        return;
+
+    pProgram->bind();
+    sBoundProgram = pProgram;
+    // sampler uniforms are per program, so bind them again
+    forgetBoundState(BOUND_STATE_TEXTURE);
+}
+
+#if RIO_IS_WIN
+void IShader::bindVertexArray_(u32 handle)
+{
+    if (handle == sBoundVertexArray)
+        return;
+
+    RIO_GL_CALL(glBindVertexArray(handle));
+    sBoundVertexArray = handle;
+}
+#endif
+
+void IShader::bindSamplerTexture_(rio::TextureSampler2D& sampler, const rio::Texture2D* pTexture, s32 location, u32 slot)
+{
+    if (slot < BOUND_TEXTURE_SLOT_MAX)
+    {
+        if (sBoundSampler[slot] == &sampler && sBoundTexture[slot] == pTexture)
+            return;
+        sBoundSampler[slot] = &sampler;
+        sBoundTexture[slot] = pTexture;
+    }
+
+    sampler.linkTexture2D(pTexture);
+    sampler.tryBindFS(location, slot);
+}
+
+void IShader::setCulling(FFLCullMode mode)
+{
+    if (mode > FFL_CULL_MODE_FRONT || mode == sCullMode)
+        return;
+
+    rio::RenderState render_state;
+
+    switch (mode)
+    {
+    case FFL_CULL_MODE_NONE:
+        render_state.setCullingMode(rio::Graphics::CULLING_MODE_NONE);
+        break;
+    case FFL_CULL_MODE_BACK:
+        render_state.setCullingMode(rio::Graphics::CULLING_MODE_BACK);
+        break;
+    case FFL_CULL_MODE_FRONT:
+        render_state.setCullingMode(rio::Graphics::CULLING_MODE_FRONT);
+        break;
+    default:
+        break;
+    }
+
+    render_state.applyCullingAndPolygonModeAndPolygonOffset();
+    sCullMode = mode;
+}
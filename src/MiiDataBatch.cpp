@@ -0,0 +1,77 @@
+#include <MiiDataBatch.h>
+#include <ThreadPool.h>
+
+#include <nn/ffl/FFLiMiiData.h>
+#include <nn/ffl/FFLiMiiDataCore.h>
+
+#include <mii_ext_MiiPort.h>
+
+#include <atomic>
+
+// records handed to a thread at a time, decoding one
+// is way cheaper than waking up a worker for it
+static const u32 cRecordsPerTask = 512;
+
+static bool pickupRecord_(const MiiDataBatchRecord& record, MiiDataBatchResult* pResult,
+                          const MiiDataBatchOptions& options)
+{
+    pResult->verifyReason = FFLI_VERIFY_CHAR_INFO_REASON_OK;
+
+    if (options.inputType < 0)
+    {
+        MiiDataInputType inputType;
+        // checked here so that bad sizes don't spam the log
+        if (!getMiiDataInputType(record.dataLength, &inputType))
+        {
+            pResult->result = FFL_RESULT_ERROR;
+            return false;
+        }
+        pResult->result = pickupCharInfoFromDataWithType(&pResult->charInfo, record.data, inputType, options.verifyCRC16);
+    }
+    else
+    {
+        const MiiDataInputType inputType = static_cast<MiiDataInputType>(options.inputType);
+        const u32 minLength = getMiiDataInputTypeSize(inputType);
+        // forced type, so make sure that the record is long enough for it
+        if (minLength == 0 || record.dataLength < minLength)
+        {
+            pResult->result = FFL_RESULT_ERROR;
+            return false;
+        }
+        pResult->result = pickupCharInfoFromDataWithType(&pResult->charInfo, record.data, inputType, options.verifyCRC16);
+    }
+
+    if (pResult->result != FFL_RESULT_OK)
+        return false;
+
+    if (options.verifyCharInfo)
+    {
+        // don't verify name, same as requests
+        pResult->verifyReason = FFLiVerifyCharInfoWithReason(&pResult->charInfo, false);
+        if (pResult->verifyReason != FFLI_VERIFY_CHAR_INFO_REASON_OK)
+            return false;
+    }
+    return true;
+}
+
+u32 pickupCharInfoBatch(const MiiDataBatchRecord* records, u32 count,
+                        MiiDataBatchResult* results,
+                        const MiiDataBatchOptions& options)
+{
+    std::atomic<u32> okCount(0);
+
+    const u32 taskCount = (count + cRecordsPerTask - 1) / cRecordsPerTask;
+    ThreadPool::instance().parallelFor(taskCount, [&](u32 task)
+    {
+        const u32 begin = task * cRecordsPerTask;
+        const u32 end = begin + cRecordsPerTask < count ? begin + cRecordsPerTask : count;
+
+        u32 ok = 0;
+        for (u32 i = begin; i < end; i++)
+            if (pickupRecord_(records[i], &results[i], options))
+                ok++;
+        okCount += ok;
+    });
+
+    return okCount;
+}
@@ -0,0 +1,281 @@
+// standalone tool for converting/validating Mii data in bulk
+// uses the same decoding as the server, but never starts RIO,
+// GL or the socket, so it can run on any machine
+
+#include <MiiDataBatch.h>
+#include <Fingerprint.h>
+#include <ThreadPool.h>
+#include <EnumStrings.h>
+
+#include <mii_ext_MiiPort.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+enum OutputFormat {
+    OUTPUT_FORMAT_CHARINFO,    // FFLiCharInfo as-is
+    OUTPUT_FORMAT_STUDIO,      // raw (not obfuscated) studio data
+    OUTPUT_FORMAT_FINGERPRINT, // u64 getCharInfoFingerprint, little endian
+    OUTPUT_FORMAT_NONE,        // only report
+};
+
+static void printUsage(const char* name)
+{
+    fprintf(stderr,
+        "usage: %s [options] <input file or folder> [output file]\n"
+        "  input is either a folder with one Mii per file,\n"
+        "  or a packed file of records that are all --size bytes\n"
+        "options:\n"
+        "  --size <n>       record size of a packed input file\n"
+        "  --type <n>       MiiDataInputType, instead of picking it from the size\n"
+        "  --format <fmt>   charinfo (default), studio, fingerprint or none\n"
+        "  --report <file>  per-record errors (default: stderr)\n"
+        "  --no-crc         don't verify CRC16 of store data\n"
+        "  --no-verify      don't run FFLiVerifyCharInfoWithReason\n"
+        "  --self-check     only check the decoders and conversions against\n"
+        "                   each other, exits with failure on a mismatch\n",
+        name);
+}
+
+static bool readFile(const std::filesystem::path& path, std::vector<char>& data)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+        return false;
+    data.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(data.data(), data.size());
+    return file.good() || file.eof();
+}
+
+// the studio decoder has an SSE2 path that has to match the original,
+// and every input type has to give the same Mii as studio data
+static int runSelfCheck()
+{
+    if (!studioURLObfuscationSelfCheck())
+    {
+        fprintf(stderr, "studio data decoding does not match the reference, see the log\n");
+        return EXIT_FAILURE;
+    }
+    if (!miiDataConversionSelfCheck())
+    {
+        fprintf(stderr, "coreData or NX charInfo conversion does not match studio data, see the log\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("self check passed\n");
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char* argv[])
+{
+    u32 recordSize = 0;
+    OutputFormat outputFormat = OUTPUT_FORMAT_CHARINFO;
+    const char* reportPath = nullptr;
+    const char* inputPath = nullptr;
+    const char* outputPath = nullptr;
+
+    MiiDataBatchOptions options;
+    options.verifyCRC16 = true;
+    options.verifyCharInfo = true;
+    options.inputType = -1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--self-check")
+            return runSelfCheck();
+        else if (arg == "--size" && hasValue)
+            recordSize = static_cast<u32>(atoi(argv[++i]));
+        else if (arg == "--type" && hasValue)
+            options.inputType = atoi(argv[++i]);
+        else if (arg == "--format" && hasValue)
+        {
+            const std::string format = argv[++i];
+            if (format == "charinfo")
+                outputFormat = OUTPUT_FORMAT_CHARINFO;
+            else if (format == "studio")
+                outputFormat = OUTPUT_FORMAT_STUDIO;
+            else if (format == "fingerprint")
+                outputFormat = OUTPUT_FORMAT_FINGERPRINT;
+            else if (format == "none")
+                outputFormat = OUTPUT_FORMAT_NONE;
+            else
+            {
+                printUsage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+        else if (arg == "--report" && hasValue)
+            reportPath = argv[++i];
+        else if (arg == "--no-crc")
+            options.verifyCRC16 = false;
+        else if (arg == "--no-verify")
+            options.verifyCharInfo = false;
+        else if (arg[0] != '-' && inputPath == nullptr)
+            inputPath = argv[i];
+        else if (arg[0] != '-' && outputPath == nullptr)
+            outputPath = argv[i];
+        else
+        {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (inputPath == nullptr || (outputPath == nullptr && outputFormat != OUTPUT_FORMAT_NONE))
+    {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const auto startTime = std::chrono::steady_clock::now();
+
+    // --- read input
+
+    std::vector<char> packedData;               // packed file contents
+    std::vector<std::vector<char>> fileDatas;   // or one entry per file
+    std::vector<std::string> names;             // for the report
+    std::vector<MiiDataBatchRecord> records;
+
+    std::error_code ec;
+    if (std::filesystem::is_directory(inputPath, ec))
+    {
+        std::vector<std::filesystem::path> paths;
+        for (const auto& entry : std::filesystem::directory_iterator(inputPath, ec))
+        {
+            // skip dotfiles, not regular files
+            if (!entry.is_regular_file() || entry.path().filename().string().at(0) == '.')
+                continue;
+            paths.push_back(entry.path());
+        }
+        // sort so that the output order does not depend on the file system
+        std::sort(paths.begin(), paths.end());
+
+        fileDatas.resize(paths.size());
+        for (size_t i = 0; i < paths.size(); i++)
+        {
+            if (!readFile(paths[i], fileDatas[i]))
+                fprintf(stderr, "could not read %s\n", paths[i].string().c_str());
+            names.push_back(paths[i].filename().string());
+            records.push_back({ fileDatas[i].data(), static_cast<u32>(fileDatas[i].size()) });
+        }
+    }
+    else
+    {
+        if (!readFile(inputPath, packedData))
+        {
+            fprintf(stderr, "could not read %s\n", inputPath);
+            return EXIT_FAILURE;
+        }
+
+        // one record if no size was given
+        if (recordSize == 0)
+            recordSize = static_cast<u32>(packedData.size());
+        if (recordSize == 0 || packedData.size() % recordSize != 0)
+        {
+            fprintf(stderr, "%s is %zu bytes, which is not a multiple of the record size %u\n",
+                    inputPath, packedData.size(), recordSize);
+            return EXIT_FAILURE;
+        }
+
+        const size_t count = packedData.size() / recordSize;
+        records.reserve(count);
+        for (size_t i = 0; i < count; i++)
+            records.push_back({ packedData.data() + i * recordSize, recordSize });
+    }
+
+    const u32 count = static_cast<u32>(records.size());
+
+    // --- decode
+
+    std::vector<MiiDataBatchResult> results(count);
+    const u32 okCount = pickupCharInfoBatch(records.data(), count, results.data(), options);
+
+    // --- write output, failed records are zeroes so that indexes line up
+
+    if (outputFormat != OUTPUT_FORMAT_NONE)
+    {
+        size_t outputRecordSize = sizeof(FFLiCharInfo);
+        if (outputFormat == OUTPUT_FORMAT_STUDIO)
+            outputRecordSize = sizeof(charInfoStudio);
+        else if (outputFormat == OUTPUT_FORMAT_FINGERPRINT)
+            outputRecordSize = sizeof(u64);
+        std::vector<u8> output(count * outputRecordSize, 0);
+
+        ThreadPool::instance().parallelFor(count, [&](u32 i)
+        {
+            const MiiDataBatchResult& result = results[i];
+            if (result.result != FFL_RESULT_OK || result.verifyReason != FFLI_VERIFY_CHAR_INFO_REASON_OK)
+                return;
+            u8* dest = output.data() + i * outputRecordSize;
+            if (outputFormat == OUTPUT_FORMAT_STUDIO)
+                charInfoToStudio(reinterpret_cast<charInfoStudio*>(dest), &result.charInfo);
+            else if (outputFormat == OUTPUT_FORMAT_FINGERPRINT)
+            {
+                const u64 fingerprint = getCharInfoFingerprint(&result.charInfo);
+                for (u32 j = 0; j < sizeof(u64); j++)
+                    dest[j] = static_cast<u8>(fingerprint >> (j * 8));
+            }
+            else
+                memcpy(dest, &result.charInfo, sizeof(FFLiCharInfo));
+        });
+
+        std::ofstream outFile(outputPath, std::ios::binary);
+        if (!outFile.write(reinterpret_cast<const char*>(output.data()), output.size()))
+        {
+            fprintf(stderr, "could not write %s\n", outputPath);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // --- report
+
+    FILE* report = stderr;
+    if (reportPath != nullptr && (report = fopen(reportPath, "w")) == nullptr)
+    {
+        fprintf(stderr, "could not open %s\n", reportPath);
+        return EXIT_FAILURE;
+    }
+
+    for (u32 i = 0; i < count; i++)
+    {
+        const MiiDataBatchResult& result = results[i];
+        if (result.result == FFL_RESULT_OK && result.verifyReason == FFLI_VERIFY_CHAR_INFO_REASON_OK)
+            continue;
+        // index, name (folders only), pickup result, verify reason
+        fprintf(report, "%u\t%s\t%s\t%s\n", i,
+                names.empty() ? "-" : names[i].c_str(),
+                FFLResultToString(result.result),
+                result.result == FFL_RESULT_OK ? FFLiVerifyCharInfoReasonToString(result.verifyReason) : "-");
+    }
+
+    if (report != stderr)
+        fclose(report);
+
+    // the same Mii in different formats counts once
+    std::unordered_set<u64> fingerprints;
+    for (u32 i = 0; i < count; i++)
+    {
+        const MiiDataBatchResult& result = results[i];
+        if (result.result == FFL_RESULT_OK && result.verifyReason == FFLI_VERIFY_CHAR_INFO_REASON_OK)
+            fingerprints.insert(getCharInfoFingerprint(&result.charInfo));
+    }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - startTime).count();
+    printf("%u/%u records ok, %u failed, %zu unique (%lld ms, %u threads)\n",
+           okCount, count, count - okCount, fingerprints.size(), static_cast<long long>(elapsed),
+           ThreadPool::instance().getConcurrency());
+
+    return okCount == count ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,9 +1,11 @@
 #include <Model.h>
 #include <IShader.h>
+#include <TextureMemory.h>
 
 #include <gfx/rio_Window.h>
 #include <gpu/rio_RenderState.h>
 #include <math/rio_Matrix.h>
+#include <misc/rio_MemUtil.h>
 
 #ifdef ENABLE_BENCHMARK
 #include <chrono>
@@ -18,18 +20,41 @@ Model::Model()
     , mIsEnableSpecialDraw(false)
     , mLightEnable(true)
     , mIsInitialized(false)
+    , mInitializeCpuResult(FFL_RESULT_OK)
+    , mTextureMemorySize(0)
 {
     mpCharModel = new FFLCharModel();
 }
 
 Model::~Model()
+{
+    finalize();
+    delete mpCharModel;
+}
+
+void Model::finalize()
 {
     if (mIsInitialized)
     {
         FFLDeleteCharModel(mpCharModel);
+        TextureMemory::instance().remove(TEXTURE_MEMORY_KIND_CHAR_MODEL, mTextureMemorySize);
         mIsInitialized = false;
+        // its textures are gone, the next one may get the same address
+        IShader::forgetBoundState(IShader::BOUND_STATE_TEXTURE);
     }
-    delete mpCharModel;
+
+    // same as a new FFLCharModel()
+    rio::MemUtil::set(mpCharModel, 0, sizeof(FFLCharModel));
+    mCharModelDesc = FFLCharModelDesc();
+    mMtxRT = rio::Matrix34f::ident;
+    mScale = { 1.0f, 1.0f, 1.0f };
+    mMtxSRT = rio::Matrix34f::ident;
+    mpShader = nullptr;
+    mIsEnableSpecialDraw = false;
+    mLightEnable = true;
+    // a pooled model should not report the last one's failure
+    mInitializeCpuResult = FFL_RESULT_OK;
+    mTextureMemorySize = 0;
 }
 
 void Model::initialize_(const FFLCharModelDesc* p_desc, const FFLCharModelSource* p_source)
@@ -138,6 +163,8 @@ void Model::drawOpaSpecial_()
     render_state.setBlendEnable(false);
     render_state.setColorMask(true, true, true, true);
     render_state.apply();
+    // apply() sets culling as well
+    IShader::forgetBoundState(IShader::BOUND_STATE_CULL_MODE);
 
     FFLDrawOpa(mpCharModel);
 }
@@ -170,6 +197,7 @@ void Model::drawXluNormal_()
     render_state.setBlendFactorDstAlpha(rio::Graphics::BLEND_MODE_ONE);
 
     render_state.apply();
+    IShader::forgetBoundState(IShader::BOUND_STATE_CULL_MODE);
 
     FFLDrawXlu(mpCharModel);
 }
@@ -188,6 +216,7 @@ void Model::drawXluSpecial_()
         render_state.setBlendEquation(rio::Graphics::BLEND_FUNC_ADD);
         render_state.setColorMask(true, true, true, false);
         render_state.apply();
+        IShader::forgetBoundState(IShader::BOUND_STATE_CULL_MODE);
 
         mpShader->applyAlphaTestEnable();
 
@@ -206,6 +235,7 @@ void Model::drawXluSpecial_()
         render_state.setBlendEquation(rio::Graphics::BLEND_FUNC_ADD);
         render_state.setColorMask(true, true, true, true);
         render_state.apply();
+        IShader::forgetBoundState(IShader::BOUND_STATE_CULL_MODE);
 
         mpShader->applyAlphaTestEnable();
 
@@ -251,6 +281,11 @@ void Model::initializeGpu_(IShader& shader)
     start = std::chrono::high_resolution_clock::now();
 #endif
     FFLInitCharModelGPUStep(mpCharModel);
+    // FFL draws the faceline and mask textures with its own
+    // copy shader and may reuse texture addresses from before
+    IShader::forgetBoundState();
+    mTextureMemorySize = TextureMemory::calcCharModelSize(mCharModelDesc);
+    TextureMemory::instance().add(TEXTURE_MEMORY_KIND_CHAR_MODEL, mTextureMemorySize);
 #ifdef ENABLE_BENCHMARK
     end = std::chrono::high_resolution_clock::now();
     duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
@@ -0,0 +1,113 @@
+#include <ModelPool.h>
+#include <Model.h>
+
+#include <cstdio>
+
+#if defined(__GLIBC__)
+    #include <malloc.h>
+    #if __GLIBC_PREREQ(2, 33)
+        #define MODEL_POOL_HAS_MALLINFO2
+    #endif
+#endif
+
+ModelPool& ModelPool::instance()
+{
+    static ModelPool sInstance;
+    return sInstance;
+}
+
+ModelPool::ModelPool(u32 maxFree)
+    : mMaxFree(maxFree)
+    , mLiveCount(0)
+    , mPeakLiveCount(0)
+    , mAllocCount(0)
+    , mReuseCount(0)
+{
+}
+
+ModelPool::~ModelPool()
+{
+    setMaxFree(0);
+}
+
+void ModelPool::setMaxFree(u32 maxFree)
+{
+    mMaxFree = maxFree;
+    while (mFree.size() > mMaxFree)
+    {
+        delete mFree.back();
+        mFree.pop_back();
+    }
+}
+
+Model* ModelPool::alloc()
+{
+    Model* pModel;
+    if (!mFree.empty())
+    {
+        pModel = mFree.back();
+        mFree.pop_back();
+        mReuseCount++;
+    }
+    else
+        pModel = new Model();
+
+    mAllocCount++;
+    mLiveCount++;
+    if (mLiveCount > mPeakLiveCount)
+        mPeakLiveCount = mLiveCount;
+    return pModel;
+}
+
+void ModelPool::free(Model* pModel)
+{
+    if (pModel == nullptr)
+        return;
+
+    RIO_ASSERT(mLiveCount > 0);
+    mLiveCount--;
+
+    if (mFree.size() >= mMaxFree)
+    {
+        delete pModel;
+        return;
+    }
+
+    // the CharModel and its textures go now, only the storage stays
+    pModel->finalize();
+    mFree.push_back(pModel);
+}
+
+std::string ModelPool::formatMetrics() const
+{
+    char line[160];
+    std::string metrics;
+
+    snprintf(line, sizeof(line), "ffl_testing_model_pool_live %u\n", mLiveCount);
+    metrics += line;
+    snprintf(line, sizeof(line), "ffl_testing_model_pool_live_peak %u\n", mPeakLiveCount);
+    metrics += line;
+    snprintf(line, sizeof(line), "ffl_testing_model_pool_free %u\n", static_cast<u32>(mFree.size()));
+    metrics += line;
+    snprintf(line, sizeof(line), "ffl_testing_model_pool_allocs_total %llu\n",
+             static_cast<unsigned long long>(mAllocCount));
+    metrics += line;
+    snprintf(line, sizeof(line), "ffl_testing_model_pool_reuses_total %llu\n",
+             static_cast<unsigned long long>(mReuseCount));
+    metrics += line;
+
+#ifdef MODEL_POOL_HAS_MALLINFO2
+    // The whole process from the allocator, FFL's allocations included
+    // but also everything else, nothing here is per model. Pooling only
+    // saves the Model and FFLCharModel allocations, what FFL allocates
+    // for a model is still freed by finalize.
+    const struct mallinfo2 info = mallinfo2();
+    snprintf(line, sizeof(line), "ffl_testing_heap_in_use_bytes %llu\n",
+             static_cast<unsigned long long>(info.uordblks + info.hblkhd));
+    metrics += line;
+    snprintf(line, sizeof(line), "ffl_testing_heap_reserved_bytes %llu\n",
+             static_cast<unsigned long long>(info.arena + info.hblkhd));
+    metrics += line;
+#endif
+    return metrics;
+}
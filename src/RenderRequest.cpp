@@ -0,0 +1,162 @@
+#include <rio.h>
+
+#include <RenderRequest.h>
+
+#include <cstddef>
+#include <cstring>
+
+struct RenderRequestFieldDesc
+{
+    u16 tag;
+    u16 offset; // in RenderRequest
+    u16 size;
+};
+
+#define RENDER_REQUEST_FIELD(tag, member) \
+    { tag, offsetof(RenderRequest, member), sizeof(RenderRequest::member) }
+
+// every fixed size field, indexed by tag
+static const RenderRequestFieldDesc cRenderRequestFields[] = {
+    { 0, 0, 0 }, // no tag 0
+    { RENDER_REQUEST_TAG_DATA, offsetof(RenderRequest, data), 0 }, // handled separately
+    RENDER_REQUEST_FIELD(RENDER_REQUEST_TAG_MODEL_FLAG, modelFlag),
+    RENDER_REQUEST_FIELD(RENDER_REQUEST_TAG_RESPONSE_FORMAT, responseFormat),
+    RENDER_REQUEST_FIELD(RENDER_REQUEST_TAG_RESOLUTION, resolution),
+    RENDER_REQUEST_FIELD(RENDER_REQUEST_TAG_TEX_RESOLUTION, texResolution),
+    RENDER_REQUEST_FIELD(RENDER_REQUEST_TAG_VIEW_TYPE, viewType),
+    RENDER_REQUEST_FIELD(RENDER_REQUEST_TAG_RESOURCE_TYPE, resourceType),
+    RENDER_REQUEST_FIELD(RENDER_REQUEST_TAG_SHADER_TYPE, shaderType),
+    RENDER_REQUEST_FIELD(RENDER_REQUEST_TAG_EXPRESSION, expression),
+    RENDER_REQUEST_FIELD(RENDER_REQUEST_TAG_EXPRESSION_FLAG, expressionFlag),
+    RENDER_REQUEST_FIELD(RENDER_REQUEST_TAG_CAMERA_ROTATE, cameraRotate),
+    RENDER_REQUEST_FIELD(RENDER_REQUEST_TAG_MODEL_ROTATE, modelRotate),
+    RENDER_REQUEST_FIELD(RENDER_REQUEST_TAG_BACKGROUND_COLOR, backgroundColor),
+    RENDER_REQUEST_FIELD(RENDER_REQUEST_TAG_AA_METHOD, aaMethod),
+    RENDER_REQUEST_FIELD(RENDER_REQUEST_TAG_DRAW_STAGE_MODE, drawStageMode),
+    RENDER_REQUEST_FIELD(RENDER_REQUEST_TAG_VERIFY_CHAR_INFO, verifyCharInfo),
+    RENDER_REQUEST_FIELD(RENDER_REQUEST_TAG_VERIFY_CRC16, verifyCRC16),
+    RENDER_REQUEST_FIELD(RENDER_REQUEST_TAG_LIGHT_ENABLE, lightEnable),
+    RENDER_REQUEST_FIELD(RENDER_REQUEST_TAG_CLOTHES_COLOR, clothesColor),
+    RENDER_REQUEST_FIELD(RENDER_REQUEST_TAG_PANTS_COLOR, pantsColor),
+    RENDER_REQUEST_FIELD(RENDER_REQUEST_TAG_BODY_TYPE, bodyType),
+    RENDER_REQUEST_FIELD(RENDER_REQUEST_TAG_HAT_TYPE, hatType),
+    RENDER_REQUEST_FIELD(RENDER_REQUEST_TAG_HAT_COLOR, hatColor),
+    RENDER_REQUEST_FIELD(RENDER_REQUEST_TAG_INSTANCE_COUNT, instanceCount),
+    RENDER_REQUEST_FIELD(RENDER_REQUEST_TAG_INSTANCE_ROTATION_MODE, instanceRotationMode),
+    RENDER_REQUEST_FIELD(RENDER_REQUEST_TAG_LIGHT_DIRECTION, lightDirection),
+    RENDER_REQUEST_FIELD(RENDER_REQUEST_TAG_SPLIT_MODE, splitMode),
+    { RENDER_REQUEST_TAG_BATCH_DATA, 0, 0 },  // handled separately
+    { RENDER_REQUEST_TAG_DEADLINE_MS, 0, 0 }, // ^^
+    { RENDER_REQUEST_TAG_PRIORITY, 0, 0 },    // ^^
+};
+
+static const u32 cRenderRequestFieldCount = sizeof(cRenderRequestFields) / sizeof(cRenderRequestFields[0]);
+
+void initRenderRequestDefaults(RenderRequest* pRequest)
+{
+    memset(pRequest, 0, sizeof(RenderRequest));
+    pRequest->resolution = 512;
+    pRequest->resourceType = -1;   // default (high)
+    pRequest->verifyCharInfo = true;
+    pRequest->verifyCRC16 = true;
+    pRequest->lightEnable = true;
+    pRequest->clothesColor = -1;   // favorite color
+    pRequest->pantsColor = -1;     // default for shader
+    pRequest->bodyType = -1;       // ^^
+    pRequest->instanceCount = 1;
+    pRequest->lightDirection[0] = -1; // unset
+    pRequest->lightDirection[1] = -1;
+    pRequest->lightDirection[2] = -1;
+}
+
+bool isRenderRequestHeaderV2(const RenderRequestHeaderV2* pHeader)
+{
+    return pHeader->magic == RENDER_REQUEST_V2_MAGIC
+        && pHeader->version == RENDER_REQUEST_VERSION_2;
+}
+
+const char* parseRenderRequestBodyV2(RenderRequest* pRequest, RenderRequestExtra* pExtra, RenderRequestBatch* pBatch, const void* body, uint32_t bodySize)
+{
+    const u8* pData = static_cast<const u8*>(body);
+    const u8* pEnd = pData + bodySize;
+    bool hasTexResolution = false;
+    pExtra->deadlineMs = 0;
+    pExtra->priority = RENDER_REQUEST_PRIORITY_DEFAULT;
+    pBatch->count = 0;
+
+    while (pData < pEnd)
+    {
+        if (static_cast<size_t>(pEnd - pData) < sizeof(RenderRequestFieldHeaderV2))
+            return "Truncated field header.\n";
+
+        RenderRequestFieldHeaderV2 field;
+        memcpy(&field, pData, sizeof(field)); // may be unaligned
+        pData += sizeof(field);
+
+        if (static_cast<size_t>(pEnd - pData) < field.length)
+            return "Field is longer than the request.\n";
+
+        const u8* pValue = pData;
+        pData += field.length;
+
+        // from a newer client, fine to ignore
+        if (field.tag == 0 || field.tag >= cRenderRequestFieldCount)
+            continue;
+
+        if (field.tag == RENDER_REQUEST_TAG_DATA)
+        {
+            if (field.length > sizeof(pRequest->data))
+                return "Mii data is too long.\n";
+            memcpy(pRequest->data, pValue, field.length);
+            pRequest->dataLength = field.length;
+            continue;
+        }
+
+        if (field.tag == RENDER_REQUEST_TAG_BATCH_DATA)
+        {
+            if (field.length > sizeof(pRequest->data))
+                return "Mii data is too long.\n";
+            if (pBatch->count >= RENDER_REQUEST_BATCH_MAX)
+                return "Too many Miis in the batch.\n";
+            pBatch->pData[pBatch->count] = pValue;
+            pBatch->dataLength[pBatch->count] = field.length;
+            pBatch->count++;
+            continue;
+        }
+
+        if (field.tag == RENDER_REQUEST_TAG_DEADLINE_MS)
+        {
+            if (field.length != sizeof(pExtra->deadlineMs))
+                return "Field has the wrong size for its tag.\n";
+            memcpy(&pExtra->deadlineMs, pValue, sizeof(pExtra->deadlineMs));
+            continue;
+        }
+
+        if (field.tag == RENDER_REQUEST_TAG_PRIORITY)
+        {
+            if (field.length != sizeof(pExtra->priority))
+                return "Field has the wrong size for its tag.\n";
+            if (*pValue >= RENDER_REQUEST_PRIORITY_MAX)
+                return "Unknown priority.\n";
+            pExtra->priority = *pValue;
+            continue;
+        }
+
+        const RenderRequestFieldDesc& desc = cRenderRequestFields[field.tag];
+        RIO_ASSERT(desc.tag == field.tag);
+        if (field.length != desc.size)
+            return "Field has the wrong size for its tag.\n";
+
+        memcpy(reinterpret_cast<u8*>(pRequest) + desc.offset, pValue, desc.size);
+        if (field.tag == RENDER_REQUEST_TAG_TEX_RESOLUTION)
+            hasTexResolution = true;
+    }
+
+    if (pRequest->dataLength == 0 && pBatch->count == 0)
+        return "No Mii data in the request.\n";
+
+    if (!hasTexResolution)
+        pRequest->texResolution = static_cast<int16_t>(pRequest->resolution);
+
+    return nullptr;
+}
@@ -4,6 +4,8 @@
 #include <gpu/rio_VertexArray.h>
 #include <gpu/rio_TextureSampler.h>
 #include <gpu/rio_Shader.h>
+#include <IShader.h>
+#include <TextureMemory.h>
 
 static const rio::TextureFormat cColorFormat = rio::TEXTURE_FORMAT_R8_G8_B8_A8_UNORM;
 static const rio::TextureFormat cDepthFormat = rio::DEPTH_TEXTURE_FORMAT_R32_FLOAT;
@@ -12,6 +14,7 @@ RenderTexture::RenderTexture(u32 width, u32 height)
     : mRenderBuffer(width, height)
     // default color format
     , mColorFormat(cColorFormat)
+    , mMemorySize(0)
     , mRenderTextureColor(mColorFormat, width, height, 1)
     , mRenderTextureDepth(cDepthFormat, width, height, 1)
 {
@@ -22,6 +25,7 @@ RenderTexture::RenderTexture(u32 width, u32 height, rio::TextureFormat colorForm
     : mRenderBuffer(width, height)
     // default color format
     , mColorFormat(colorFormat)
+    , mMemorySize(0)
     , mRenderTextureColor(mColorFormat, width, height, 1)
     , mRenderTextureDepth(cDepthFormat, width, height, 1)
 {
@@ -30,6 +34,7 @@ RenderTexture::RenderTexture(u32 width, u32 height, rio::TextureFormat colorForm
 
 RenderTexture::~RenderTexture()
 {
+    TextureMemory::instance().remove(TEXTURE_MEMORY_KIND_RENDER_TEXTURE, mMemorySize);
     mColorTarget.invalidateGPUCache();
     mDepthTarget.invalidateGPUCache();
 }
@@ -41,6 +46,11 @@ void RenderTexture::linkTargets_()
 
     mRenderBuffer.setRenderTargetColor(&mColorTarget);
     mRenderBuffer.setRenderTargetDepth(&mDepthTarget);
+
+    const u64 pixelCount = static_cast<u64>(mRenderTextureColor.getWidth()) * mRenderTextureColor.getHeight();
+    // depth is always R32_FLOAT
+    mMemorySize = pixelCount * (rio::TextureFormatUtil::getPixelByteSize(mColorFormat) + sizeof(f32));
+    TextureMemory::instance().add(TEXTURE_MEMORY_KIND_RENDER_TEXTURE, mMemorySize);
 }
 
 #include <gpu/rio_VertexBuffer.h>
@@ -48,15 +58,12 @@ void RenderTexture::linkTargets_()
 #include <gpu/win/rio_Texture2DUtilWin.h>
 
 // for socket
+#include <SocketWriter.h>
 #if RIO_IS_WIN && defined(_WIN32)
-    #include <winsock2.h>
     #pragma comment(lib, "ws2_32.lib")
-#elif RIO_IS_WIN
-    #define closesocket close
-    #include <sys/socket.h>
 #endif // RIO_IS_WIN && defined(_WIN32)
 
-void copyAndSendRenderBufferToSocket(rio::Texture2D* texture, int socket, int ssaaFactor)
+bool copyAndSendRenderBufferToSocket(rio::Texture2D* texture, int socket, int ssaaFactor, const void* header, u32 headerSize)
 {
     // does operations on the renderbuffer assuming it is already bound
 #ifdef TRY_SCALING
@@ -176,6 +183,8 @@ void copyAndSendRenderBufferToSocket(rio::Texture2D* texture, int socket, int ss
     // will be called at the end of this function.
 
     downsampleShader.unload();
+    // program, VAO and texture were bound behind the shaders' backs
+    IShader::forgetBoundState();
 
     renderBufferDownsample.bind();
 
@@ -229,12 +238,18 @@ void copyAndSendRenderBufferToSocket(rio::Texture2D* texture, int socket, int ss
     // this should be compatible with OpenGL 3.3 and OpenGL ES 3.0
     RIO_GL_CALL(readBuffer = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bufferSize, GL_MAP_READ_BIT));
 
+    bool sent = false;
     // don't dereference a null pointer
     if (readBuffer)
     {
         // Process the data in readBuffer
         RIO_LOG("Rendered data read successfully from the buffer.\n");
-        send(socket, reinterpret_cast<char*>(readBuffer), bufferSize, 0);
+        // header and pixels go out together, straight from the mapping
+        const SocketBuffer buffers[2] = {
+            { header, headerSize },
+            { readBuffer, bufferSize }
+        };
+        sent = sendBuffersToSocket(socket, buffers, 2);
         RIO_GL_CALL(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
     }
     else
@@ -249,10 +264,17 @@ void copyAndSendRenderBufferToSocket(rio::Texture2D* texture, int socket, int ss
     //rio::MemUtil::set(readBuffer, 0xFF, bufferSize);
     // NOTE: UNTESTED
     renderBuffer.read(0, readBuffer, renderBuffer.getSize().x, renderBuffer.getSize().y, nativeFormat);
-    send(socket, reinterpret_cast<char*>(&header), TGA_HEADER_SIZE, 0); // send tga header
-    send(socket, reinterpret_cast<char*>(readBuffer), bufferSize, 0);
+    const SocketBuffer buffers[2] = {
+        { header, headerSize },
+        { readBuffer, bufferSize }
+    };
+    const bool sent = sendBuffersToSocket(socket, buffers, 2);
     delete[] readBuffer;
 #endif
 
-    RIO_LOG("Wrote %d bytes out to socket.\n", bufferSize);
+    if (sent)
+        RIO_LOG("Wrote %d bytes out to socket.\n", headerSize + bufferSize);
+    else
+        RIO_LOG("Failed to write %d bytes out to socket.\n", headerSize + bufferSize);
+    return sent;
 }
@@ -0,0 +1,110 @@
+#include <RequestQueue.h>
+
+#include <cstdio>
+
+static const char* cShedReasonNames[SHED_REASON_MAX] = {
+    "queue_full",   // SHED_REASON_QUEUE_FULL
+    "deadline",     // SHED_REASON_DEADLINE
+    "disconnected", // SHED_REASON_DISCONNECTED
+};
+
+static const char* cPriorityNames[RENDER_REQUEST_PRIORITY_MAX] = {
+    "interactive", // RENDER_REQUEST_PRIORITY_INTERACTIVE
+    "bulk",        // RENDER_REQUEST_PRIORITY_BULK
+};
+
+RequestQueue::RequestQueue(u32 maxDepth)
+    : mMaxDepth(maxDepth > 0 ? maxDepth : 1)
+    , mInteractiveWeight(REQUEST_QUEUE_INTERACTIVE_WEIGHT_DEFAULT)
+    , mInteractiveStreak(0)
+    , mAcceptedCount{ 0 }
+    , mRenderedCount{ 0 }
+    , mShedCount{ { 0 } }
+{
+}
+
+bool RequestQueue::isEmpty() const
+{
+    for (u32 i = 0; i < RENDER_REQUEST_PRIORITY_MAX; i++)
+        if (!mRequests[i].empty())
+            return false;
+    return true;
+}
+
+bool RequestQueue::push(PendingRequest&& request)
+{
+    const RenderRequestPriority priority = request.priority;
+    if (isFull(priority))
+    {
+        countShed(priority, SHED_REASON_QUEUE_FULL);
+        return false;
+    }
+    mRequests[priority].push_back(std::move(request));
+    mAcceptedCount[priority]++;
+    return true;
+}
+
+void RequestQueue::requeue(PendingRequest&& request)
+{
+    mRequests[request.priority].push_front(std::move(request));
+}
+
+bool RequestQueue::pop(PendingRequest* pRequest)
+{
+    const bool hasInteractive = !isEmpty(RENDER_REQUEST_PRIORITY_INTERACTIVE);
+    const bool hasBulk = !isEmpty(RENDER_REQUEST_PRIORITY_BULK);
+    if (!hasInteractive && !hasBulk)
+        return false;
+
+    // weighted round robin, the streak only counts while bulk waits
+    RenderRequestPriority priority = RENDER_REQUEST_PRIORITY_INTERACTIVE;
+    if (!hasInteractive || (hasBulk && mInteractiveWeight != 0 && mInteractiveStreak >= mInteractiveWeight))
+        priority = RENDER_REQUEST_PRIORITY_BULK;
+
+    if (priority == RENDER_REQUEST_PRIORITY_BULK)
+        mInteractiveStreak = 0;
+    else if (hasBulk)
+        mInteractiveStreak++;
+
+    *pRequest = std::move(mRequests[priority].front());
+    mRequests[priority].pop_front();
+    return true;
+}
+
+std::string RequestQueue::formatMetrics() const
+{
+    char line[160];
+    std::string metrics;
+
+    // every line of a metric has to be next to each other
+    snprintf(line, sizeof(line), "ffl_testing_queue_depth_max %u\n", mMaxDepth);
+    metrics += line;
+    for (u32 i = 0; i < RENDER_REQUEST_PRIORITY_MAX; i++)
+    {
+        snprintf(line, sizeof(line), "ffl_testing_queue_depth{priority=\"%s\"} %u\n",
+                 cPriorityNames[i], getDepth(static_cast<RenderRequestPriority>(i)));
+        metrics += line;
+    }
+    for (u32 i = 0; i < RENDER_REQUEST_PRIORITY_MAX; i++)
+    {
+        snprintf(line, sizeof(line), "ffl_testing_requests_accepted_total{priority=\"%s\"} %llu\n",
+                 cPriorityNames[i], static_cast<unsigned long long>(mAcceptedCount[i]));
+        metrics += line;
+    }
+    for (u32 i = 0; i < RENDER_REQUEST_PRIORITY_MAX; i++)
+    {
+        snprintf(line, sizeof(line), "ffl_testing_requests_rendered_total{priority=\"%s\"} %llu\n",
+                 cPriorityNames[i], static_cast<unsigned long long>(mRenderedCount[i]));
+        metrics += line;
+    }
+    for (u32 i = 0; i < RENDER_REQUEST_PRIORITY_MAX; i++)
+    {
+        for (u32 j = 0; j < SHED_REASON_MAX; j++)
+        {
+            snprintf(line, sizeof(line), "ffl_testing_requests_shed_total{priority=\"%s\",reason=\"%s\"} %llu\n",
+                     cPriorityNames[i], cShedReasonNames[j], static_cast<unsigned long long>(mShedCount[i][j]));
+            metrics += line;
+        }
+    }
+    return metrics;
+}
@@ -24,22 +24,35 @@
 
 #include <nn/ffl/detail/FFLiCrc.h>
 #include <RenderTexture.h>
+#include <SocketWriter.h>
 #include <BodyModel.h>
+#include <ViewTypes.h>
+#include <Fingerprint.h>
+#include <TextureMemory.h>
+#include <ModelPool.h>
+#include <HeadlessEGL.h>
 
+#include <cstring>
 #include <string>
 
 // Forward declarations
 //void handleRenderRequest(char* buf, Model* pModel, int socket);
 
-#ifndef NO_GLTF
-void handleGLTFRequest(RenderRequest* renderRequest, Model* pModel, int socket);
-#endif
 
 // Static members.
 const char* RootTask::sServerOnlyFlag     = nullptr;
 const char* RootTask::sServerPort         = nullptr;
 const char* RootTask::sResourceSearchPath = nullptr;
 const char* RootTask::sResourceHighPath   = nullptr;
+const char* RootTask::sQueueDepth         = nullptr;
+const char* RootTask::sDeadlineMs         = nullptr;
+const char* RootTask::sBulkPort           = nullptr;
+const char* RootTask::sInteractiveWeight  = nullptr;
+const char* RootTask::sUnixSocketPath     = nullptr;
+const char* RootTask::sBulkUnixSocketPath = nullptr;
+const char* RootTask::sPreloadList        = nullptr;
+const char* RootTask::sCharModelCacheSize = nullptr;
+const char* RootTask::sTextureBudgetMB    = nullptr;
 
 RootTask::RootTask()
     : ITask("FFL Testing")
@@ -50,17 +63,29 @@ RootTask::RootTask()
     , mpShaders{ nullptr }
     , mProjMtx()
     , mProjMtxIconBody()
+    , mProjMtxAllBodySugar()
     , mCamera()
     , mCounter(0.0f)
     , mMiiCounter(0)
     , mpModel(nullptr)
+    , mCharModelCache()
     , mpBodyModels{ nullptr }
     , mpHatModels{ nullptr }
+    , mServerFD(-1)
+#if RIO_IS_WIN
+    , mBulkServerFD(-1)
+    , mDefaultDeadlineMs(0)
+#endif
 {
-#ifdef RIO_USE_OSMESA // off screen rendering
+#if defined(RIO_USE_OSMESA) || defined(USE_EGL_HEADLESS) // off screen rendering
     sServerOnlyFlag = "1"; // force it truey
 #endif
     rio::MemUtil::set(mpBodyModels, 0, sizeof(mpBodyModels));
+#if RIO_IS_WIN
+    mCurrentRequest.socket = -1;
+    mCurrentRequest.batch.count = 0;
+    mCurrentRequest.batchNext = 0;
+#endif
 }
 
 #include <nn/ffl/FFLiMiiData.h>
@@ -112,6 +137,113 @@ void RootTask::fillStoreDataArray_()
 
 #define PORT_DEFAULT 12346 // default port to listen on
 
+// Creates a TCP socket listening on every address at port,
+// returns -1 after printing why if that did not work.
+static int openListenSocket(int port, sockaddr_in* pAddress)
+{
+    int fd;
+    // Creating socket file descriptor
+    if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+    {
+        perror("socket failed");
+        return -1;
+    }
+
+    const int opt = 1; // into setsockopt()
+
+    // Attach socket to the address.
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&opt), sizeof(opt)))
+    {
+        perror("setsockopt");
+        closesocket(fd);
+        return -1;
+    }
+
+    pAddress->sin_family = AF_INET;
+    pAddress->sin_addr.s_addr = INADDR_ANY;
+    pAddress->sin_port = htons(port); // set port
+
+    // bind socket handle fd with pAddress
+    if (bind(fd, (struct sockaddr *)pAddress, sizeof(*pAddress)) < 0)
+    {
+        perror("bind failed");
+        closesocket(fd);
+        return -1;
+    }
+
+    if (listen(fd, LISTEN_BACKLOG_DEFAULT) < 0)
+    {
+        perror("listen");
+        closesocket(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+// Creates a unix domain socket listening at path, so that a web
+// server on the same machine skips the TCP stack. Anything at
+// path is replaced. Returns -1 after printing why on failure.
+static int openUnixListenSocket(const char* path)
+{
+#ifdef _WIN32
+    RIO_LOG("unix sockets are not supported on Windows, use --port\n");
+    return -1;
+#else
+    sockaddr_un address;
+    if (strlen(path) >= sizeof(address.sun_path))
+    {
+        RIO_LOG("unix socket path is longer than %zu characters: %s\n", sizeof(address.sun_path) - 1, path);
+        return -1;
+    }
+
+    int fd;
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+    {
+        perror("socket failed");
+        return -1;
+    }
+
+    rio::MemUtil::set(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    rio::MemUtil::copy(address.sun_path, path, strlen(path));
+
+    // left over from the last run, bind fails otherwise
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0)
+    {
+        perror("bind failed");
+        closesocket(fd);
+        return -1;
+    }
+    // the web server may run as another user, same as its own socket
+    chmod(path, 0666);
+
+    if (listen(fd, LISTEN_BACKLOG_DEFAULT) < 0)
+    {
+        perror("listen");
+        closesocket(fd);
+        return -1;
+    }
+
+    return fd;
+#endif // _WIN32
+}
+
+// accept() blocks by default, this is needed
+// in server only mode but the mode will be
+// set to non-blocking without
+static void setSocketNonBlocking(int fd, bool nonBlocking = true)
+{
+#ifdef _WIN32
+    u_long mode = nonBlocking ? 1 : 0;
+    ioctlsocket(fd, FIONBIO, &mode);
+#else
+    const int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, nonBlocking ? flags | O_NONBLOCK : flags & ~O_NONBLOCK);
+#endif // _WIN32
+}
+
 // Setup socket to send data to, and print message.
 void RootTask::setupSocket_()
 {
@@ -122,9 +254,15 @@ void RootTask::setupSocket_()
         int n_fds = sd_listen_fds(0);
         if (n_fds > 0)
         {
-            mServerFD = SD_LISTEN_FDS_START + 0; // Use only one socket
+            mServerFD = SD_LISTEN_FDS_START + 0;
+            // a second socket in the unit is the bulk lane
+            if (n_fds > 1)
+                mBulkServerFD = SD_LISTEN_FDS_START + 1;
             mSocketIsListening = true;
-            RIO_LOG("\033[1mUsing systemd socket activation, socket fd: %d\033[0m\n", mServerFD);
+            // ListenStream= can be a port or a path, accept() doesn't care
+            RIO_LOG("\033[1mUsing systemd socket activation, socket fd: %d (%s), bulk socket fd: %d\033[0m\n",
+                    mServerFD, sd_is_socket_unix(mServerFD, SOCK_STREAM, 1, nullptr, 0) > 0 ? "unix" : "tcp",
+                    mBulkServerFD);
 
             sServerOnlyFlag = "1"; // force server only when using systemd socket
             return; // Exit the function as the socket is already set up
@@ -146,79 +284,40 @@ void RootTask::setupSocket_()
     }
 #endif // _WIN32
 
-    // Creating socket file descriptor
-    if ((mServerFD = socket(AF_INET, SOCK_STREAM, 0)) == 0)
-    {
-        perror("socket failed");
-        rio::Exit();
-        exit(EXIT_FAILURE);
-    }
-
-    const int opt = 1; // into setsockopt()
-
-    // Attach socket to the address.
-    if (setsockopt(mServerFD, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&opt), sizeof(opt)))
-    {
-        perror("setsockopt");
-        rio::Exit();
-        exit(EXIT_FAILURE);
-    }
-
-    mServerAddress.sin_family = AF_INET;
-    mServerAddress.sin_addr.s_addr = INADDR_ANY;
-
-    // Get port number from arguments or use the default.
-    char portReminder[] =" \033[2m(change with --port)\033[0m"; // will be set to blank
-
-    int port = PORT_DEFAULT; // default port
-    if (sServerPort)
-    {
-        port = atoi(sServerPort);
-        portReminder[0] = '\0'; // remove port reminder
-    }
-
-    // bind socket handle mServerFD with mServerAddress
-    mServerAddress.sin_port = htons(port); // set port
-    if (bind(mServerFD, (struct sockaddr *)&mServerAddress, sizeof(mServerAddress)) < 0)
-    {
-        perror("bind failed");
-        RIO_LOG("\033[1m" \
-        "TIP: Change the default port of 12346 with the --port argument." \
-        "\033[0m\n");
-        rio::Exit();
-        exit(EXIT_FAILURE);
-    }
-
-    s32 listenBacklog = LISTEN_BACKLOG_DEFAULT;
+    char serverOnlyReminder[] = "\033[1mRemember to use the --server argument to hide the window.\n\033[0m";
+    if (sServerOnlyFlag)
+        // don't show the reminder with server only
+        serverOnlyReminder[0] = '\0';
 
-    if (listen(mServerFD, listenBacklog) < 0)
+    if (sUnixSocketPath)
     {
-        perror("listen");
-        rio::Exit();
-        exit(EXIT_FAILURE);
+        if ((mServerFD = openUnixListenSocket(sUnixSocketPath)) < 0)
+        {
+            rio::Exit();
+            exit(EXIT_FAILURE);
+        }
+        RIO_LOG("\033[1munix socket server listening at %s\033[0m\n%s", sUnixSocketPath, serverOnlyReminder);
     }
-
     else
     {
-        char serverOnlyReminder[] = "\033[1mRemember to use the --server argument to hide the window.\n\033[0m";
+        // Get port number from arguments or use the default.
+        char portReminder[] =" \033[2m(change with --port)\033[0m"; // will be set to blank
 
-        // accept() blocks by default, this is needed
-        // in server only mode but the mode will be
-        // set to non-blocking without
-        if (!sServerOnlyFlag)
+        int port = PORT_DEFAULT; // default port
+        if (sServerPort)
         {
-#ifdef _WIN32
-            const u_long mode = 1;
-            ioctlsocket(mServerFD, FIONBIO, &mode);
-#else
-            fcntl(mServerFD, F_SETFL, O_NONBLOCK);
-#endif // _WIN32
+            port = atoi(sServerPort);
+            portReminder[0] = '\0'; // remove port reminder
         }
-        else
-            // don't show the reminder with server only
-            serverOnlyReminder[0] = '\0';
 
-        mSocketIsListening = true;
+        if ((mServerFD = openListenSocket(port, &mServerAddress)) < 0)
+        {
+            RIO_LOG("\033[1m" \
+            "TIP: Change the default port of 12346 with the --port argument." \
+            "\033[0m\n");
+            rio::Exit();
+            exit(EXIT_FAILURE);
+        }
 
         // print bold/blue, portReminder, serverOnlyReminder
         RIO_LOG("\033[1m" \
@@ -227,6 +326,38 @@ void RootTask::setupSocket_()
         "%s",
         port, portReminder, serverOnlyReminder);
     }
+
+    // requests that come in here wait in the bulk lane
+    if (sBulkUnixSocketPath)
+    {
+        if ((mBulkServerFD = openUnixListenSocket(sBulkUnixSocketPath)) < 0)
+        {
+            rio::Exit();
+            exit(EXIT_FAILURE);
+        }
+        RIO_LOG("\033[1munix socket server listening for bulk requests at %s\033[0m\n", sBulkUnixSocketPath);
+    }
+    else if (sBulkPort)
+    {
+        const int bulkPort = atoi(sBulkPort);
+        sockaddr_in bulkAddress;
+        if ((mBulkServerFD = openListenSocket(bulkPort, &bulkAddress)) < 0)
+        {
+            RIO_LOG("\033[1mCould not listen on bulk port %d.\033[0m\n", bulkPort);
+            rio::Exit();
+            exit(EXIT_FAILURE);
+        }
+        RIO_LOG("\033[1mtcp server listening for bulk requests on port %d\033[0m\n", bulkPort);
+    }
+
+    if (!sServerOnlyFlag)
+    {
+        setSocketNonBlocking(mServerFD);
+        if (mBulkServerFD >= 0)
+            setSocketNonBlocking(mBulkServerFD);
+    }
+
+    mSocketIsListening = true;
 }
 #endif
 
@@ -318,10 +449,36 @@ FFLResourceType RootTask::getDefaultResourceType_()
     return preferred;
 }
 
+// for the startup time breakdown
+static s64 getMillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
 void RootTask::prepare_()
 {
     mInitialized = false;
 
+    const auto startTime = std::chrono::steady_clock::now();
+    auto stepTime = startTime;
+    auto logStartupStep = [&stepTime](const char* step)
+    {
+        RIO_LOG("startup: %s took %lld ms\n", step, static_cast<long long>(getMillisecondsSince(stepTime)));
+        stepTime = std::chrono::steady_clock::now();
+    };
+
+#ifdef USE_EGL_HEADLESS
+    // replaces the window's context before anything is made on it
+    if (!HeadlessEGL::initialize())
+    {
+        fprintf(stderr, "Could not create a headless EGL context, see the log for why.\n");
+        rio::Exit();
+        exit(EXIT_FAILURE);
+    }
+    logStartupStep("EGL context");
+#endif
+
     FFLInitDesc init_desc = {
         .fontRegion = FFL_FONT_REGION_JP_US_EU,
         ._c = false,
@@ -331,6 +488,7 @@ void RootTask::prepare_()
 #ifndef TEST_FFL_DEFAULT_RESOURCE_LOADING
 
     loadResourceFiles_();
+    logStartupStep("reading resource files");
 
     FFLResult result = FFLInitResEx(&init_desc, &mResourceDesc);
 #else
@@ -348,8 +506,7 @@ void RootTask::prepare_()
 
     RIO_ASSERT(FFLIsAvailable());
     FFLInitResGPUStep(); // No-op on Win but still needed
-
-    initializeShaders_();
+    logStartupStep("FFLInitResEx");
 
     // Create projection matrices.
 
@@ -385,14 +542,31 @@ void RootTask::prepare_()
         );
         mProjMtxIconBody = mProjIconBody.getMatrix();
 
+        // VIEW_TYPE_ALL_BODY_SUGAR is 3:4
+        mProjAllBodySugar = mProjIconBody;
+        mProjAllBodySugar.setAspect(3.0f / 4.0f);
+        mProjMtxAllBodySugar = mProjAllBodySugar.getMatrix();
+
     }
 
-    // load body models
-    loadBodyModels_();
+    // shaders and body/hat models load on first use otherwise
+    preloadAssets_();
+    logStartupStep("--preload");
 
 #if RIO_IS_WIN
     fillStoreDataArray_();
+    if (sCharModelCacheSize)
+        mCharModelCache.setMaxSize(static_cast<u32>(atoi(sCharModelCacheSize)));
+    if (sTextureBudgetMB)
+        TextureMemory::instance().setBudget(static_cast<u64>(atoi(sTextureBudgetMB)) * 1024 * 1024);
+    if (sQueueDepth)
+        mRequestQueue.setMaxDepth(static_cast<u32>(atoi(sQueueDepth)));
+    if (sDeadlineMs)
+        mDefaultDeadlineMs = static_cast<u32>(atoi(sDeadlineMs));
+    if (sInteractiveWeight)
+        mRequestQueue.setInteractiveWeight(static_cast<u32>(atoi(sInteractiveWeight)));
     setupSocket_();
+    logStartupStep("socket setup");
 #ifndef RIO_NO_GLFW_CALLS
     // Set window aspect ratio, so that when resizing it will not change
     GLFWwindow *glfwWindow = rio::Window::instance()->getNativeWindow().getGLFWwindow();
@@ -402,67 +576,107 @@ void RootTask::prepare_()
 
     mMiiCounter = 0;
     createModel_();
+    logStartupStep("first model");
 
-    // load body/hat models
-    loadBodyModels_();
-    loadHatModels_();
-
+    RIO_LOG("\033[1mstartup took %lld ms\033[0m\n", static_cast<long long>(getMillisecondsSince(startTime)));
     mInitialized = true;
 }
 
-void RootTask::loadBodyModels_()
+rio::mdl::Model* RootTask::loadBodyModel_(BodyType type, FFLGender gender)
 {
-    RIO_LOG("loading body models: ");
-    for (u32 bodyType = 0; bodyType < BODY_TYPE_MAX; bodyType++)
+    if (mpBodyModels[type][gender] != nullptr)
+        return mpBodyModels[type][gender];
+
+    const char* bodyTypeString = cBodyTypeStrings[type];
+    const char* genderString = cBodyGenderStrings[gender];
+
+    char bodyPathC[64];
+    // make sure that will not overfloowwwww
+    //RIO_ASSERT((strlen(bodyTypeString) + strlen(genderString) + strlen(cBodyFileNameFormat)) < 64);
+
+    snprintf(bodyPathC, sizeof(bodyPathC), cBodyFileNameFormat, bodyTypeString, genderString);
+
+    RIO_LOG("loading body model: %s\n", bodyPathC);
+    const rio::mdl::res::Model* resModel = rio::mdl::res::ModelCacher::instance()->loadModel(bodyPathC, bodyPathC);
+
+    if (resModel == nullptr)
     {
-        for (u32 gender = 0; gender < FFL_GENDER_MAX; gender++)
-        {
-            const char* bodyTypeString = cBodyTypeStrings[bodyType];
-            const char* genderString = cBodyGenderStrings[gender];
+        // only fails the request that wanted it, see createModel_,
+        // use --preload bodies to find out at startup instead
+        RIO_LOG("Body model not found: %s\n", bodyPathC);
+        return nullptr;
+    }
 
-            char bodyPathC[64];
-            // make sure that will not overfloowwwww
-            //RIO_ASSERT((strlen(bodyTypeString) + strlen(genderString) + strlen(cBodyFileNameFormat)) < 64);
+    mpBodyModels[type][gender] = new rio::mdl::Model(resModel);
+#ifndef NO_GLTF
+    GLTFExportCallback::EncodeStaticMesh(*resModel, mGLTFBodyMeshes[type][gender]);
+#endif
+    return mpBodyModels[type][gender];
+}
 
-            snprintf(bodyPathC, sizeof(bodyPathC), cBodyFileNameFormat, bodyTypeString, genderString);
+rio::mdl::Model* RootTask::loadHatModel_(u32 hatType)
+{
+    if (mpHatModels[hatType] != nullptr)
+        return mpHatModels[hatType];
 
-            RIO_LOG("%s, ", bodyPathC);
-            const rio::mdl::res::Model* resModel = rio::mdl::res::ModelCacher::instance()->loadModel(bodyPathC, bodyPathC);
+    char hatPathC[64];
+    snprintf(hatPathC, sizeof(hatPathC), cHatFileNameFormat, hatType);
 
-            RIO_ASSERT(resModel);
-            if (resModel == nullptr)
-            {
-                fprintf(stderr, "\nBody model not found: %s. Exiting.\n", bodyPathC);
-                rio::Exit();
-                exit(EXIT_FAILURE);
-            }
+    RIO_LOG("loading hat model: %s\n", hatPathC);
+    const rio::mdl::res::Model* resModel = rio::mdl::res::ModelCacher::instance()->loadModel(hatPathC, hatPathC);
 
-            mpBodyModels[bodyType][gender] = new rio::mdl::Model(resModel);
-        }
+    if (resModel == nullptr)
+    {
+        // only fails the request that wanted it, see createModel_
+        RIO_LOG("Hat model not found: %s\n", hatPathC);
+        return nullptr;
     }
-    // print bold/blue:
-    RIO_LOG("\033[1m(all loaded successfully)\033[0m\n");
+
+    mpHatModels[hatType] = new rio::mdl::Model(resModel);
+#ifndef NO_GLTF
+    GLTFExportCallback::EncodeStaticMesh(*resModel, mGLTFHatMeshes[hatType]);
+#endif
+    return mpHatModels[hatType];
 }
 
-void RootTask::loadHatModels_()
+// --preload takes "all" or any of "shaders,bodies,hats",
+// for when the first request should not wait for them
+void RootTask::preloadAssets_()
 {
-    for (u32 hatType = cMinHats; hatType < cMaxHats; hatType++)
+    if (sPreloadList == nullptr)
+        return;
+
+    const std::string list = std::string(",") + sPreloadList + ",";
+    const bool preloadAll = list.find(",all,") != std::string::npos;
+    auto hasItem = [&list, preloadAll](const char* item)
     {
-        char hatPathC[64];
+        return preloadAll || list.find(std::string(",") + item + ",") != std::string::npos;
+    };
 
-        snprintf(hatPathC, sizeof(hatPathC), cHatFileNameFormat, hatType);
+    if (hasItem("shaders"))
+        for (u32 type = 0; type < SHADER_TYPE_MAX; type++)
+            getShader_(static_cast<ShaderType>(type));
 
-        RIO_LOG("loading hat model: %s\n", hatPathC);
-        const rio::mdl::res::Model* resModel = rio::mdl::res::ModelCacher::instance()->loadModel(hatPathC, hatPathC);
+    // anything missing is logged, all of it before giving up
+    bool isComplete = true;
 
-        RIO_ASSERT(resModel);
-        if (resModel == nullptr)
-        {
-            fprintf(stderr, "Hat model not found: %s. Exiting.\n", hatPathC);
-            exit(EXIT_FAILURE);
-        }
+    if (hasItem("bodies"))
+        for (u32 bodyType = 0; bodyType < BODY_TYPE_MAX; bodyType++)
+            for (u32 gender = 0; gender < FFL_GENDER_MAX; gender++)
+                if (loadBodyModel_(static_cast<BodyType>(bodyType), static_cast<FFLGender>(gender)) == nullptr)
+                    isComplete = false;
 
-        mpHatModels[hatType] = new rio::mdl::Model(resModel);
+    if (hasItem("hats"))
+        for (u32 hatType = cMinHats; hatType < cMaxHats; hatType++)
+            if (loadHatModel_(hatType) == nullptr)
+                isComplete = false;
+
+    // the point of preloading is to find out now, not on a request
+    if (!isComplete)
+    {
+        fprintf(stderr, "\n--preload: some models could not be loaded, see the log for which. Exiting.\n");
+        rio::Exit();
+        exit(EXIT_FAILURE);
     }
 }
 
@@ -533,11 +747,11 @@ mMiiCounter = (mMiiCounter + 1) % maxMiis;
         .index = 0
     };
 
-    mpModel = new Model();
+    mpModel = ModelPool::instance().alloc();
     ShaderType shaderType = SHADER_TYPE_WIIU;//(mMiiCounter-1) % (SHADER_TYPE_MAX);
-    if (!mpModel->initialize(arg, *mpShaders[shaderType]))
+    if (!mpModel->initialize(arg, *getShader_(shaderType)))
     {
-        delete mpModel;
+        ModelPool::instance().free(mpModel);
         mpModel = nullptr;
     }
     /*else
@@ -676,9 +890,20 @@ FFLResult pickupCharInfoFromRenderRequest(FFLiCharInfo *pCharInfo, RenderRequest
 }
 
 const std::string socketErrorPrefix = "ERROR: ";
+// not rendered because of load, the web server maps these to 503/504
+const std::string socketBusyPrefix = "BUSY: ";
+const std::string socketExpiredPrefix = "EXPIRED: ";
+
+// Sends an error as the whole response, the web
+// server shows anything with the prefix to the user.
+static void sendSocketError(int socket, const std::string& errMsg, const std::string& prefix = socketErrorPrefix)
+{
+    const std::string response = prefix + errMsg;
+    send(socket, response.c_str(), static_cast<int>(response.length()), 0);
+}
 
 // create model for render request
-bool RootTask::createModel_(RenderRequest* req, int socket_handle)
+bool RootTask::createModel_(RenderRequest* req, std::string* pErrMsg)
 {
     FFLiCharInfo charInfo;
 
@@ -697,8 +922,7 @@ bool RootTask::createModel_(RenderRequest* req, int socket_handle)
             errMsg = "Unknown data type (pickupCharInfoFromData failed)\n";
 
         RIO_LOG("%s", errMsg.c_str());
-        errMsg = socketErrorPrefix + errMsg;
-        send(socket_handle, errMsg.c_str(), static_cast<int>(errMsg.length()), 0);
+        *pErrMsg = errMsg;
         return false;
     }
 
@@ -717,8 +941,7 @@ bool RootTask::createModel_(RenderRequest* req, int socket_handle)
             // CHARINFO IS INVALID, FAIL!
             errMsg = "FFLiVerifyCharInfoWithReason (data verification) failed: " + std::string(FFLiVerifyCharInfoReasonToString(verifyCharInfoReason)) + "\n";
             RIO_LOG("%s", errMsg.c_str());
-            errMsg = socketErrorPrefix + errMsg;
-            send(socket_handle, errMsg.c_str(), static_cast<int>(errMsg.length()), 0);
+            *pErrMsg = errMsg;
             return false;
         }
 /*
@@ -726,8 +949,7 @@ bool RootTask::createModel_(RenderRequest* req, int socket_handle)
         {
             errMsg = "FFLiIsNullMiiID returned true (this data will not work on a real console)\n";
             RIO_LOG("%s", errMsg.c_str());
-            errMsg = socketErrorPrefix + errMsg;
-            send(socket_handle, errMsg.c_str(), errMsg.length(), 0);
+            *pErrMsg = errMsg;
             return false;
         }
 
@@ -735,8 +957,7 @@ bool RootTask::createModel_(RenderRequest* req, int socket_handle)
         {
             errMsg = "FFLiIsValidMiiID returned false (this data will not work on a real console)\n";
             RIO_LOG("%s", errMsg.c_str());
-            errMsg = socketErrorPrefix + errMsg;
-            send(socket_handle, errMsg.c_str(), errMsg.length(), 0);
+            *pErrMsg = errMsg;
             return false;
         }
 */
@@ -804,6 +1025,37 @@ bool RootTask::createModel_(RenderRequest* req, int socket_handle)
         charInfo.parts.hairType = FFL_HAIR_BALD;
     }
 
+    // bodies and hats are loaded the first time one is asked for, so
+    // check here, where the request can still fail before anything is sent
+    const ViewType viewType = static_cast<ViewType>(req->viewType);
+    const ViewPreset& viewPreset = viewType < VIEW_TYPE_MAX
+                                 ? cViewPresets[viewType]
+                                 : cViewPresetDefault;
+    if (viewPreset.drawBody)
+    {
+        // same as handleRenderRequest
+        BodyType bodyType = static_cast<BodyType>(req->bodyType);
+        if (bodyType <= BODY_TYPE_DEFAULT_FOR_SHADER
+            || bodyType >= BODY_TYPE_MAX)
+            bodyType = cShaderTypeDefaultBodyType[req->shaderType % SHADER_TYPE_MAX];
+        const FFLGender gender = static_cast<FFLGender>(charInfo.gender % FFL_GENDER_MAX);
+
+        if (loadBodyModel_(bodyType, gender) == nullptr)
+        {
+            errMsg = "Body model " + std::string(cBodyTypeStrings[bodyType]) + " could not be loaded.\n";
+            *pErrMsg = errMsg;
+            return false;
+        }
+    }
+
+    if (req->hatType > 0 && req->hatType < cMaxHats
+        && loadHatModel_(req->hatType) == nullptr)
+    {
+        errMsg = "Hat model " + std::to_string(req->hatType) + " could not be loaded.\n";
+        *pErrMsg = errMsg;
+        return false;
+    }
+
     // otherwise just fall through and use default
     Model::InitArgStoreData arg = {
         .desc = {
@@ -818,8 +1070,6 @@ bool RootTask::createModel_(RenderRequest* req, int socket_handle)
         .index = 0
     };
 
-    mpModel = new Model();
-
     ShaderType whichShader = SHADER_TYPE_WIIU;
     if (req->shaderType < SHADER_TYPE_MAX)
         whichShader = static_cast<ShaderType>(req->shaderType);
@@ -842,33 +1092,101 @@ bool RootTask::createModel_(RenderRequest* req, int socket_handle)
         charInfo.height = 83;
     }
 
-    if (!mpModel->initialize(arg, *mpShaders[whichShader]))
+    IShader* pShader = getShader_(whichShader);
+
+    // the same Mii was made into a model with the same textures
+    // recently, only the shader it is drawn with may differ
+    const CharModelCacheKey cacheKey = {
+        .charInfo = getCharInfoFingerprint(&charInfo), // after the changes above
+        .expressionFlag = { expressionFlag.flags[0], expressionFlag.flags[1], expressionFlag.flags[2] },
+        .resolution = static_cast<u32>(texResolution),
+        .modelFlag = modelFlag,
+        .resourceType = resourceType,
+        .pTextureShader = pShader->getTextureShader()
+    };
+    mpModel = mCharModelCache.acquire(cacheKey);
+    if (mpModel != nullptr)
+    {
+        mpModel->setShader(*pShader);
+        mCounter = 0.0f;
+        return true;
+    }
+
+    // the request asked for this much, but the budget says no
+    fitTextureResolution_(&arg.desc);
+    // a lowered model is still cached under the resolution that was
+    // asked for, so repeats of this request find it instead of making
+    // another one. req stays as the client sent it, the fingerprint
+    // takes the lowered one from the model, see handleRenderRequest
+
+    mpModel = ModelPool::instance().alloc();
+
+    if (!mpModel->initialize(arg, *pShader))
     {
         errMsg = "FFLInitCharModelCPUStep FAILED while initializing model: "
         + std::string(FFLResultToString(mpModel->getInitializeCpuResult()))
         + "\n";
         RIO_LOG("%s", errMsg.c_str());
-        errMsg = socketErrorPrefix + errMsg;
-        send(socket_handle, errMsg.c_str(), static_cast<int>(errMsg.length()), 0);
-        delete mpModel;
+        *pErrMsg = errMsg;
+        ModelPool::instance().free(mpModel);
         mpModel = nullptr;
         return false;
     }
+    mCharModelCache.insert(cacheKey, mpModel);
 
     mCounter = 0.0f;
     return true;
 }
 
+void RootTask::fitTextureResolution_(FFLCharModelDesc* pDesc)
+{
+    TextureMemory& textureMemory = TextureMemory::instance();
+
+    // cached models nothing uses right now are the cheapest to give up
+    while (!textureMemory.fits(TextureMemory::calcCharModelSize(*pDesc)))
+    {
+        if (!mCharModelCache.evictLeastRecentlyUsed())
+            break;
+    }
+
+    const u32 resolution = pDesc->resolution;
+    u32 fitResolution = resolution;
+    while (!textureMemory.fits(TextureMemory::calcCharModelSize(*pDesc)))
+    {
+        if (fitResolution & FFL_RESOLUTION_MIP_MAP_ENABLE_MASK)
+            fitResolution &= ~FFL_RESOLUTION_MIP_MAP_ENABLE_MASK;
+        else if (fitResolution / 2 >= TEXTURE_MEMORY_MIN_RESOLUTION)
+            fitResolution /= 2;
+        else
+            break; // render it at the minimum anyway
+        pDesc->resolution = static_cast<FFLResolution>(fitResolution);
+    }
+
+    if (fitResolution != resolution)
+    {
+        RIO_LOG("texture memory over budget (%llu of %llu bytes), texResolution lowered from 0x%x to 0x%x\n",
+                static_cast<unsigned long long>(textureMemory.getUsage()),
+                static_cast<unsigned long long>(textureMemory.getBudget()),
+                resolution, fitResolution);
+        textureMemory.countDowngrade();
+    }
+}
+
 #define TGA_HEADER_SIZE 18
+// image ID field right after the header, holds the render fingerprint
+#define TGA_IMAGE_ID_SIZE RENDER_FINGERPRINT_STRING_LENGTH
+#define TGA_HEADER_WITH_ID_SIZE (TGA_HEADER_SIZE + TGA_IMAGE_ID_SIZE)
 
-static void writeTGAHeaderToSocket(int socket, u32 width, u32 height, rio::TextureFormat textureFormat)
+// pFingerprint = nullptr leaves out the image ID, which older
+// clients don't expect. Returns how much of header is used.
+static u32 makeTGAHeader(u8 (&header)[TGA_HEADER_WITH_ID_SIZE], u32 width, u32 height, rio::TextureFormat textureFormat, const RenderFingerprint* pFingerprint)
 {
     const u8 bitsPerPixel = rio::TextureFormatUtil::getPixelByteSize(textureFormat) * 8;
 
-    // create tga header for this texture
-    u8 header[TGA_HEADER_SIZE]; // tga header size = 0x12
+    // create tga header for this texture, size = 0x12
     // set all fields to 0 initially including unused ones
-    rio::MemUtil::set(&header, 0, TGA_HEADER_SIZE);
+    rio::MemUtil::set(&header, 0, TGA_HEADER_WITH_ID_SIZE);
+    header[0] = pFingerprint != nullptr ? TGA_IMAGE_ID_SIZE : 0; // idLength, the web server uses the ID as the ETag
     header[2] = 2;                     // imageType, 2 = uncomp_true_color
     header[12] = width & 0xff;         // width MSB
     header[13] = (width >> 8) & 0xff;  // width LSB
@@ -877,9 +1195,13 @@ static void writeTGAHeaderToSocket(int socket, u32 width, u32 height, rio::Textu
     header[16] = bitsPerPixel;
     header[17] = 8; // 32 = Flag that sets the image origin to the top left
                     // nnas standard tgas set this to 8 to be upside down
-    // tga header will be written to socket at the same time pixels are reads
+    // tga header will be written to socket at the same time pixels are read
+
+    if (pFingerprint == nullptr)
+        return TGA_HEADER_SIZE;
 
-    send(socket, reinterpret_cast<char*>(&header), TGA_HEADER_SIZE, 0); // send tga header
+    formatRenderFingerprint(reinterpret_cast<char*>(header + TGA_HEADER_SIZE), *pFingerprint);
+    return TGA_HEADER_WITH_ID_SIZE;
 }
 
 
@@ -895,10 +1217,9 @@ rio::mdl::Model* RootTask::getBodyModel_(Model* pModel, BodyType type)
     // Clamp the value of gender.
     const FFLGender gender = static_cast<FFLGender>(genderTmp % FFL_GENDER_MAX);
 
-    // Select body model.
-    rio::mdl::Model* model = mpBodyModels[type][gender]; // Based on gender.
-
-    RIO_ASSERT(model); // make sure it is not null
+    // Select body model. Requests had it checked in
+    // createModel_, nullptr only if the file is missing.
+    rio::mdl::Model* model = loadBodyModel_(type, gender); // Based on gender.
     return model;
 }
 
@@ -912,7 +1233,7 @@ rio::mdl::Model* RootTask::getHatModel_(Model* pModel, uint8_t type)
     const uint8_t hatTypeNew = static_cast<FFLGender>(type % cMaxHats);
 
     // Select hat model.
-    rio::mdl::Model* model = mpHatModels[hatTypeNew]; // Based on gender.
+    rio::mdl::Model* model = loadHatModel_(hatTypeNew); // Based on gender.
 
     RIO_ASSERT(model); // make sure it is not null
     return model;
@@ -924,148 +1245,45 @@ rio::mdl::Model* RootTask::getHatModel_(Model* pModel, uint8_t type)
 // ... to handle the view type appropriately
 void RootTask::setViewTypeParams(ViewType viewType, rio::LookAtCamera* pCamera, rio::PerspectiveProjection* proj, rio::BaseMtx44f* projMtx, f32* aspectHeightFactor, bool* isCameraPosAbsolute, bool* willDrawBody, FFLiCharInfo* pCharInfo)
 {
-    switch (viewType)
+    // use default if request is head only
+    const ViewPreset& preset = viewType < VIEW_TYPE_MAX
+                             ? cViewPresets[viewType]
+                             : cViewPresetDefault;
+
+    switch (preset.projection)
     {
-        case VIEW_TYPE_FACE_ONLY:
-            *willDrawBody = false;
-            [[fallthrough]]; // goal is actually same view as face
-                             // both cdn-mii 2.0.0 and 1.0.0 do this
-        case VIEW_TYPE_FACE:
-        {
+        case VIEW_PROJECTION_ICON_BODY:
             // if it has body then use the matrix we just defined
             *projMtx = mProjMtxIconBody;
             *proj = mProjIconBody;
-
-            //RIO_LOG("x = %i, y = %i, z = %i\n", req->cameraRotate.x, req->cameraRotate.y, req->cameraRotate.z);
-            /*
-            rio::Vec3f fCameraPosition = {
-                fmod(static_cast<f32>(req->cameraRotate.x), 360),
-                fmod(static_cast<f32>(req->cameraRotate.y), 360),
-                fmod(static_cast<f32>(req->cameraRotate.z), 360),
-            };*/
-
-            // FFLMakeIconWithBody view uses 37.05f, 415.53f
-            // below values are extracted from wii u mii maker
-            pCamera->pos() = { 0.0f, 33.016785f, 411.181793f };
-            pCamera->at() = { 0.0f, 34.3f, 0.0f };//33.016785f, 0.0f };
-            pCamera->setUp({ 0.0f, 1.0f, 0.0f });
-            break;
-        }
-        case VIEW_TYPE_NNMII_VARIABLEICONBODY:
-        {
-            *projMtx = mProjMtxIconBody;
-            *proj = mProjIconBody;
-            // nn::mii::VariableIconBody::StoreCameraMatrix values
-            pCamera->pos() = { 0.0f, 37.0f, 380.0f };
-            pCamera->at() = { 0.0f, 37.0f, 0.0f };
-            pCamera->setUp({ 0.0f, 1.0f, 0.0f });
-            break;
-        }
-        case VIEW_TYPE_FFLICONWITHBODY:
-        {
-            *projMtx = mProjMtxIconBody;
-            *proj = mProjIconBody;
-            // FFLMakeIconWithBody view
-            pCamera->pos() = { 0.0f, 37.05f, 415.53f };
-            pCamera->at() = { 0.0f, 37.05f, 0.0f };
-            pCamera->setUp({ 0.0f, 1.0f, 0.0f });
-            break;
-        }
-        case VIEW_TYPE_ALL_BODY:
-        {
-            *projMtx = mProjMtxIconBody;
-            *proj = mProjIconBody;
-            *isCameraPosAbsolute = true;
-            // made to be closer to mii studio looking value but still not actually accurate
-            //pCamera->pos() = { 0.0f, 50.0f, 805.0f };
-            //pCamera->at() = { 0.0f, 98.0f, 0.0f };
-            // initial values:
-            pCamera->pos() = { 0.0f, 9.0f, 900.0f };
-            pCamera->at() = { 0.0f, 105.0f, 0.0f };
-
-            pCamera->setUp({ 0.0f, 1.0f, 0.0f });
             break;
-        }
-        case VIEW_TYPE_ALL_BODY_SUGAR: // like mii maker/nnid
-        {
-            static const f32 aspect = 3.0f / 4.0f;
-            *aspectHeightFactor = 1.0f / aspect;
-
-            rio::PerspectiveProjection projAllBodyAspect = mProjIconBody;
-            projAllBodyAspect.setAspect(aspect);
-
-            static const rio::BaseMtx44f projMtxAllBodyAspect = rio::BaseMtx44f(projAllBodyAspect.getMatrix());
-            *projMtx = projMtxAllBodyAspect;
-            *proj = projAllBodyAspect;
-
-        *isCameraPosAbsolute = true;
-
-        // NOTE: wii u mii maker does some strange
-        // camera zooming, to make the character
-        // bigger when it's shorter and smaller
-        // when it's taller, purely based on height
-
-        // this is an ATTEMPT??? to simulate that
-        // via interpolation which is... meh
-
-            const f32 scaleFactorY = BodyModel::calcBodyScale(pCharInfo->build, pCharInfo->height).y;
-
-        // These camera parameters look right when the character is tallest
-        const rio::Vector3f posStart = {0.0f, 30.0f, 550.0f};
-        const rio::Vector3f atStart = {0.0f, 65.0f, 0.0f};
-
-        // Likewise these look correct when it's shortest.
-        const rio::Vector3f posEnd = {0.0f, 9.0f, 850.0f};
-        const rio::Vector3f atEnd = {0.0f, 90.0f, 0.0f};
-
-            // Calculate interpolation factor (normalized to range [0, 1])
-            f32 t = (scaleFactorY - 0.5f) / (1.264f - 0.5f);
-
-
-
-        // Interpolate between start and end positions
-        rio::Vector3f pos = {
-            posStart.x + t * (posEnd.x - posStart.x),
-            posStart.y + t * (posEnd.y - posStart.y),
-            posStart.z + t * (posEnd.z - posStart.z)};
-
-        // Interpolate between start and end target positions
-        rio::Vector3f at = {
-            atStart.x + t * (atEnd.x - atStart.x),
-            atStart.y + t * (atEnd.y - atStart.y),
-            atStart.z + t * (atEnd.z - atStart.z)};
-
-        /*
-        // height = 127, 1.264
-        pCamera->pos() = { 0.0f, 9.0f, 850.0f };
-        pCamera->at() = { 0.0f, 90.0f, 0.0f }; // higher = model is lower
-        // height = 0,   0.5
-        pCamera->pos() = { 0.0f, 30.0f, 550.0f }; // lower = closer
-        pCamera->at() = { 0.0f, 65.0f, 0.0f };
-        */
-
-            pCamera->pos() = pos;
-            pCamera->at() = at;
-            //pCamera->pos() = { 0.0f, 9.0f, 900.0f };
-            //pCamera->at() = { 0.0f, 6.0f, 0.0f };
-            pCamera->setUp({ 0.0f, 1.0f, 0.0f });
+        case VIEW_PROJECTION_ALL_BODY_SUGAR:
+            *projMtx = mProjMtxAllBodySugar;
+            *proj = mProjAllBodySugar;
             break;
-        }
         default:
-        {
-            // default, face only (FFLMakeIcon)
-            // use default if request is head only
             *projMtx = mProjMtx;
             *proj = mProj;
-            *willDrawBody = false;
+            break;
+    }
 
-        pCamera->at() = {0.0f, 34.5f, 0.0f};
-        pCamera->setUp({0.0f, 1.0f, 0.0f});
+    *aspectHeightFactor = preset.aspectHeightFactor;
+    *isCameraPosAbsolute = preset.isCameraPosAbsolute;
+    *willDrawBody = preset.drawBody;
 
-        pCamera->pos() = {0.0f, 34.5f, 600.0f};
-        break;
-    }
+    ViewCamera camera = preset.camera;
+    if (viewType == VIEW_TYPE_ALL_BODY_SUGAR)
+    {
+        // zoom depends on the height, interpolated at compile time
+        const u32 height = static_cast<u32>(pCharInfo->height);
+        camera = height < VIEW_BODY_HEIGHT_MAX
+               ? cViewAllBodySugarCameras.cameras[height]
+               : calcViewAllBodySugarCamera(static_cast<f32>(height));
     }
+
+    pCamera->pos() = { camera.pos[0], camera.pos[1], camera.pos[2] };
+    pCamera->at() = { camera.at[0], camera.at[1], camera.at[2] };
+    pCamera->setUp({ 0.0f, 1.0f, 0.0f });
 }
 
 // Convert degrees to radians
@@ -1136,29 +1354,33 @@ static f32 getTransformedZ(const rio::BaseMtx34f model_mtx, const rio::BaseMtx34
 }
 
 // TODO: this is still using class instances: getBodyModel
-void RootTask::handleRenderRequest(char* buf, Model** ppModel, int socket)
+void RootTask::handleRenderRequest(char* buf, Model** ppModel, int socket, bool sendImageID)
 {
     // Cast pModel. ppModel is provided so that
     // it can be deleted from inside this function
     Model* pModel = *ppModel;
 
     if (pModel == nullptr)
-    {
-        // error was already sent by now?
-        closesocket(socket);
-        return;
-    }
+        return; // error was already sent by now?
     RIO_LOG("handleRenderRequest: socket handle: %d\n", socket);
 
     // hopefully renderrequest is proper
     RenderRequest* req = reinterpret_cast<RenderRequest*>(buf);
 
-    if (req->responseFormat == RESPONSE_FORMAT_GLTF_MODEL)
+    // same for every input format of the same Mii, sent in the tga header.
+    // texResolution is what the model has, the budget may have lowered it
+    RenderRequest renderedReq = *req;
+    const u32 resolution = pModel->getCharModelDesc().resolution;
+    const s16 resolutionSize = static_cast<s16>(resolution & ~FFL_RESOLUTION_MIP_MAP_ENABLE_MASK);
+    renderedReq.texResolution = (resolution & FFL_RESOLUTION_MIP_MAP_ENABLE_MASK) ? -resolutionSize : resolutionSize;
+    const RenderFingerprint fingerprint = makeRenderFingerprint(pModel->getCharInfo(), &renderedReq);
+    const RenderFingerprint* pImageID = sendImageID ? &fingerprint : nullptr;
+
+    if ((req->responseFormat & RESPONSE_FORMAT_MASK) == RESPONSE_FORMAT_GLTF_MODEL)
     {
 #ifndef NO_GLTF
-        ::handleGLTFRequest(req, pModel, socket);
+        handleGLTFRequest(req, pModel, socket);
 #endif
-        closesocket(socket);
         return;
     }
 
@@ -1185,10 +1407,11 @@ void RootTask::handleRenderRequest(char* buf, Model** ppModel, int socket)
 
         rio::Texture2D* pTexture = pRenderTexture->pTexture2D;
 
-        writeTGAHeaderToSocket(socket, pTexture->getWidth(), pTexture->getHeight(), pTexture->getTextureFormat());
+        u8 header[TGA_HEADER_WITH_ID_SIZE];
+        const u32 headerSize = makeTGAHeader(header, pTexture->getWidth(), pTexture->getHeight(), pTexture->getTextureFormat(), pImageID);
 
         // NOTE the resolution of this is the texture resolution so that would have to match what the client expects
-        copyAndSendRenderBufferToSocket(pTexture, socket, 1);
+        copyAndSendRenderBufferToSocket(pTexture, socket, 1, header, headerSize);
 
         // CharModel does not have shapes (maybe) and
         // should not be drawn anymore
@@ -1198,14 +1421,13 @@ void RootTask::handleRenderRequest(char* buf, Model** ppModel, int socket)
             // when you make a model with this flag
             // it will actually make it so that it
             // will crash if you try to draw any shapes
-            // so we are simply deleting the model
-            delete pModel;
+            // so we are simply letting go of the model
+            mCharModelCache.release(pModel);
             *ppModel = nullptr;
         }
 #endif // FFL_ENABLE_NEW_MASK_ONLY_FLAG
 
 #endif // FFL_NO_RENDER_TEXTURE
-        closesocket(socket);
         return;
     }
 
@@ -1245,23 +1467,76 @@ void RootTask::handleRenderRequest(char* buf, Model** ppModel, int socket)
     setViewTypeParams(viewType, &camera, &proj,
                       &projMtx, &aspectHeightFactor,
                       &isCameraPosAbsolute, &willDrawBody, pCharInfo);
-
-    // Total width/height accounting for instance count.
+    // every instance starts from the same view
+    const rio::LookAtCamera cameraPreset = camera;
+    const rio::PerspectiveProjection projPreset = proj;
+    const rio::BaseMtx44f projMtxPreset = projMtx;
+
+    // SPLIT_MODE_BOTH sends the front and then the back layer of
+    // each instance, stacked the same way instances are
+    // unknown values render unsplit instead of as a front split
+    const SplitMode splitMode = req->splitMode < SPLIT_MODE_MAX
+                              ? static_cast<SplitMode>(req->splitMode) : SPLIT_MODE_NONE;
+    const u32 layerCount = splitMode == SPLIT_MODE_BOTH ? 2 : 1;
+
+    // Total width/height accounting for instance and layer count.
     const u32 totalWidth = req->resolution;
     const u32 totalHeight = static_cast<u32>((ceilf(
         static_cast<f32>(req->resolution
-        * aspectHeightFactor * instanceTotal)
+        * aspectHeightFactor * instanceTotal * layerCount)
     ) / 2) * 2);
 
     RIO_LOG("Total resolution: %dx%d\n", totalWidth, totalHeight);
 
     bool hasWrittenTGAHeader = false;
 
-    instanceCountNewRender:
+    // Body and hat only differ in rotation between instances,
+    // so set them up once. Their meshes stay loaded in
+    // mpBodyModels/mpHatModels across requests anyway.
+    BodyType bodyType = static_cast<BodyType>(req->bodyType);
+    if (bodyType <= BODY_TYPE_DEFAULT_FOR_SHADER
+        || bodyType >= BODY_TYPE_MAX)
+        bodyType = cShaderTypeDefaultBodyType[req->shaderType % SHADER_TYPE_MAX];
 
-    setViewTypeParams(viewType, &camera,
-                      &proj, &projMtx, &aspectHeightFactor,
-                      &isCameraPosAbsolute, &willDrawBody, pCharInfo);
+    BodyModel bodyModel(willDrawBody ? getBodyModel_(pModel, bodyType) : nullptr, bodyType);
+    PantsColor pantsColor = static_cast<PantsColor>(req->pantsColor);
+    if (pantsColor <= PANTS_COLOR_DEFAULT_FOR_SHADER
+        || pantsColor >= PANTS_COLOR_MAX)
+        pantsColor = cShaderTypeDefaultPantsType[req->shaderType % SHADER_TYPE_MAX];
+
+    if (willDrawBody)
+        // Initializes scale factors:
+        bodyModel.initialize(pModel, pantsColor);
+
+    HatModel hatModel(willDrawHat ? getHatModel_(pModel, req->hatType) : nullptr);
+    // hat relative to the rotated model
+    rio::Matrix34f hatLocalMtx = rio::Matrix34f::ident;
+    if (willDrawHat)
+    {
+        if (willDrawBody)
+            // Apply head model position
+            hatLocalMtx = bodyModel.getHeadModelMatrix();
+
+        // THANK YOU ARIAN
+        FFLPartsTransform partsTransform;
+        FFLGetPartsTransform(&partsTransform, mpModel->getCharModel());
+
+        hatLocalMtx.applyTranslationLocal({
+            partsTransform.hatTranslate.x,
+            partsTransform.hatTranslate.y,
+            partsTransform.hatTranslate.z
+        });
+
+        // Initialize model:
+        hatModel.initialize(pModel, req->hatColor);
+    }
+
+    instanceCountNewRender:
+
+    // undo what the previous instance did to the camera and projection
+    camera = cameraPreset;
+    proj = projPreset;
+    projMtx = projMtxPreset;
 
     // Update camera position
     const rio::Vector3f cameraPosInitial = camera.pos();
@@ -1295,22 +1570,8 @@ void RootTask::handleRenderRequest(char* buf, Model** ppModel, int socket)
     position.y += cameraPosInitial.y;
     const rio::Vector3f upVector = calculateUpVector(cameraRotate);
 
-    BodyType bodyType = static_cast<BodyType>(req->bodyType);
-    if (bodyType <= BODY_TYPE_DEFAULT_FOR_SHADER
-        || bodyType >= BODY_TYPE_MAX)
-        bodyType = cShaderTypeDefaultBodyType[req->shaderType % SHADER_TYPE_MAX];
-
-    BodyModel bodyModel(getBodyModel_(pModel, bodyType), bodyType);
-    PantsColor pantsColor = static_cast<PantsColor>(req->pantsColor);
-    if (pantsColor <= PANTS_COLOR_DEFAULT_FOR_SHADER
-        || pantsColor >= PANTS_COLOR_MAX)
-        pantsColor = cShaderTypeDefaultPantsType[req->shaderType % SHADER_TYPE_MAX];
-
     if (willDrawBody)
     {
-        // Initializes scale factors:
-        bodyModel.initialize(pModel, pantsColor);
-
         rio::Vector3f translate = bodyModel.getHeadTranslation();
         // Translate camera position up:
         position.setAdd(position, translate);
@@ -1343,35 +1604,37 @@ void RootTask::handleRenderRequest(char* buf, Model** ppModel, int socket)
     camera.getMatrix(&view_mtx);
 
 
-    const SplitMode splitMode = static_cast<SplitMode>(req->splitMode);
+    // One projection per layer. The model is only set up once, each
+    // layer is drawn again with near/far cut at the head's center.
+    rio::BaseMtx44f layerProjMtx[2] = { projMtx, projMtx };
     if (splitMode != SPLIT_MODE_NONE)
     {
-        // Copy projection matrix and set near/far on it.
-        rio::PerspectiveProjection projCopy = proj;
-
         const f32 zSplit = getTransformedZ(model_mtx, view_mtx);
         RIO_LOG("z split: %f\n", zSplit);
 
-        if (splitMode == SPLIT_MODE_FRONT)
-        {
-            projCopy.setNear(projCopy.getNear());
-            projCopy.setFar(zSplit);
-        }
-        else if (splitMode == SPLIT_MODE_BACK)
+        // Copy projection and set near/far on it.
+        rio::PerspectiveProjection projFront = proj;
+        projFront.setFar(zSplit);
+        rio::PerspectiveProjection projBack = proj;
+        projBack.setNear(zSplit);
+
+        if (splitMode == SPLIT_MODE_BACK)
+            layerProjMtx[0] = projBack.getMatrix();
+        else
         {
-            projCopy.setNear(zSplit);
-            projCopy.setFar(projCopy.getFar());
+            layerProjMtx[0] = projFront.getMatrix();
+            if (splitMode == SPLIT_MODE_BOTH)
+                layerProjMtx[1] = projBack.getMatrix();
         }
-        // TODO: SPLIT_MODE_BOTH.. how are we going to do that.
-        projMtx = projCopy.getMatrix();
     }
+    projMtx = layerProjMtx[0];
 
 #if RIO_IS_WIN
     // if default gl clip control is being used, or the response needs flipped y for tga...
     bool flipY = false;
 
     // When RIO_NO_CLIP_CONTROL is not defined, we only flip Y if the response format requires it
-    if (req->responseFormat == RESPONSE_FORMAT_TGA_BGRA_FLIP_Y)
+    if ((req->responseFormat & RESPONSE_FORMAT_MASK) == RESPONSE_FORMAT_TGA_BGRA_FLIP_Y)
         flipY = true;
 
 #ifdef RIO_NO_CLIP_CONTROL
@@ -1385,6 +1648,8 @@ void RootTask::handleRenderRequest(char* buf, Model** ppModel, int socket)
     {
         // Flip the Y-axis of the projection matrix
         projMtx.m[1][1] *= -1.f;
+        for (u32 layer = 0; layer < layerCount; layer++)
+            layerProjMtx[layer].m[1][1] *= -1.f;
         // Save the current front face state
         RIO_GL_CALL(glGetIntegerv(GL_FRONT_FACE, &prevFrontFace));
         // Change the front face culling
@@ -1420,7 +1685,7 @@ void RootTask::handleRenderRequest(char* buf, Model** ppModel, int socket)
     // however golang does not support this and png, jpeg, webp aren't using this anyway so
     textureFormat = rio::TEXTURE_FORMAT_B8_G8_R8_A8_UNORM;
 #elif RIO_IS_WIN //&& !defined(RIO_GLES) // not supported in gles core
-    if (req->responseFormat == RESPONSE_FORMAT_TGA_BGRA_FLIP_Y
+    if ((req->responseFormat & RESPONSE_FORMAT_MASK) == RESPONSE_FORMAT_TGA_BGRA_FLIP_Y
 #ifdef RIO_GLES
             && GLAD_GL_EXT_texture_format_BGRA8888
 #endif
@@ -1455,6 +1720,8 @@ void RootTask::handleRenderRequest(char* buf, Model** ppModel, int socket)
     renderTexture.bind();
 
     RIO_LOG("Render buffer bound.\n");
+    // whatever ran since the last request may have changed GL state
+    IShader::forgetBoundState();
 
     // Set light direction.
     // Reset uniforms first
@@ -1479,106 +1746,101 @@ void RootTask::handleRenderRequest(char* buf, Model** ppModel, int socket)
 
     DrawStageMode drawStages = static_cast<DrawStageMode>(req->drawStageMode);
 
-    // Render the first frame to the buffer
-    if (drawStages == DRAW_STAGE_MODE_ALL
-        || drawStages == DRAW_STAGE_MODE_OPA_ONLY
-        || drawStages == DRAW_STAGE_MODE_XLU_DEPTH_MASK)
-        pModel->drawOpa(view_mtx, projMtx);
-    RIO_LOG("drawOpa rendered to the buffer.\n");
-
-    // draw body?
-    if (willDrawBody)
-    {
-        const FFLFavoriteColor originalFavoriteColor = pCharInfo->favoriteColor;
-        if (req->clothesColor >= 0
-            // verify favorite color is in range here bc it is NOT verified in drawMiiBodyREAL
-            && req->clothesColor < FFL_FAVORITE_COLOR_MAX
-        )
-            // change favorite color after drawing opa
-            pCharInfo->favoriteColor = static_cast<FFLFavoriteColor>(req->clothesColor);
-
-        bodyModel.draw(rotationMtx, view_mtx, projMtx);
-        // restore original favorite color tho
-        pCharInfo->favoriteColor = originalFavoriteColor;
-    }
-
-    // Custom hat model :D
-    if (willDrawHat)
+    bool sent = true;
+    for (u32 layer = 0; layer < layerCount && sent; layer++)
     {
-        RIO_LOG("WE WILL DRAW HAT %i!! YAYY!!!\n", req->hatType);
+        if (layer > 0)
+        {
+            // same model, body, hat and uniforms, only the depth range changes
+            projMtx = layerProjMtx[layer];
+            renderTexture.clear(rio::RenderBuffer::CLEAR_FLAG_COLOR_DEPTH_STENCIL, fBackgroundColor);
+            renderTexture.bind();
+        }
 
-        // Prepare hat model
-        HatModel hatModel(getHatModel_(pModel, req->hatType));
-        
-        rio::Matrix34f hat_mtx = rotationMtx;
+        // Render the first frame to the buffer
+        if (drawStages == DRAW_STAGE_MODE_ALL
+            || drawStages == DRAW_STAGE_MODE_OPA_ONLY
+            || drawStages == DRAW_STAGE_MODE_XLU_DEPTH_MASK)
+            pModel->drawOpa(view_mtx, projMtx);
+        RIO_LOG("drawOpa rendered to the buffer.\n");
 
+        // draw body?
         if (willDrawBody)
         {
-            // Apply head model position
-            rio::Matrix34f head_mtx = bodyModel.getHeadModelMatrix();
-            hat_mtx.setMul(hat_mtx, head_mtx);
+            const FFLFavoriteColor originalFavoriteColor = pCharInfo->favoriteColor;
+            if (req->clothesColor >= 0
+                // verify favorite color is in range here bc it is NOT verified in drawMiiBodyREAL
+                && req->clothesColor < FFL_FAVORITE_COLOR_MAX
+            )
+                // change favorite color after drawing opa
+                pCharInfo->favoriteColor = static_cast<FFLFavoriteColor>(req->clothesColor);
+
+            bodyModel.draw(rotationMtx, view_mtx, projMtx);
+            // restore original favorite color tho
+            pCharInfo->favoriteColor = originalFavoriteColor;
         }
 
-        // THANK YOU ARIAN
-        FFLPartsTransform partsTransform;
-        FFLGetPartsTransform(&partsTransform, mpModel->getCharModel());
-
-        hat_mtx.applyTranslationLocal({ 
-            partsTransform.hatTranslate.x, 
-            partsTransform.hatTranslate.y, 
-            partsTransform.hatTranslate.z
-        });
-
-        // Initialize model:
-        hatModel.initialize(pModel, req->hatColor);
-        hatModel.draw(hat_mtx, view_mtx, projMtx);
-    } 
-
-    // draw xlu mask only after body is drawn
-    // in case there are elements of the mask that go in the body region
-    if (drawStages == DRAW_STAGE_MODE_ALL
-        || drawStages == DRAW_STAGE_MODE_XLU_ONLY
-        || drawStages == DRAW_STAGE_MODE_XLU_DEPTH_MASK)
-    {
-        if (drawStages == DRAW_STAGE_MODE_XLU_DEPTH_MASK
-            || drawStages == DRAW_STAGE_MODE_XLU_ONLY)
+        // Custom hat model :D
+        if (willDrawHat)
         {
-            // Use faceline color as background color.
-            const FFLColor facelineColor = FFLGetFacelineColor(pCharInfo->parts.facelineColor);
-            // Clear color but not depth. This punches out
-            // depth for DrawOpa, intended for overlaying
-            // this image over a DrawOpa image.
-            renderTexture.clear(rio::RenderBuffer::CLEAR_FLAG_COLOR, { facelineColor.r, facelineColor.g, facelineColor.b, fBackgroundColor.a });
-            // ^^ use alpha from original background color
-
-            // Color was cleared, now determine to clear depth
-            if (drawStages == DRAW_STAGE_MODE_XLU_ONLY)
-                renderTexture.clear(rio::RenderBuffer::CLEAR_FLAG_DEPTH_STENCIL, fBackgroundColor);
-            // Bind renderbuffer again
-            renderTexture.bind();
-        }
+            RIO_LOG("WE WILL DRAW HAT %i!! YAYY!!!\n", req->hatType);
+
+            rio::Matrix34f hat_mtx;
+            hat_mtx.setMul(rotationMtx, hatLocalMtx);
+            hatModel.draw(hat_mtx, view_mtx, projMtx);
+        } 
+
+        // draw xlu mask only after body is drawn
+        // in case there are elements of the mask that go in the body region
+        if (drawStages == DRAW_STAGE_MODE_ALL
+            || drawStages == DRAW_STAGE_MODE_XLU_ONLY
+            || drawStages == DRAW_STAGE_MODE_XLU_DEPTH_MASK)
+        {
+            if (drawStages == DRAW_STAGE_MODE_XLU_DEPTH_MASK
+                || drawStages == DRAW_STAGE_MODE_XLU_ONLY)
+            {
+                // Use faceline color as background color.
+                const FFLColor facelineColor = FFLGetFacelineColor(pCharInfo->parts.facelineColor);
+                // Clear color but not depth. This punches out
+                // depth for DrawOpa, intended for overlaying
+                // this image over a DrawOpa image.
+                renderTexture.clear(rio::RenderBuffer::CLEAR_FLAG_COLOR, { facelineColor.r, facelineColor.g, facelineColor.b, fBackgroundColor.a });
+                // ^^ use alpha from original background color
+
+                // Color was cleared, now determine to clear depth
+                if (drawStages == DRAW_STAGE_MODE_XLU_ONLY)
+                    renderTexture.clear(rio::RenderBuffer::CLEAR_FLAG_DEPTH_STENCIL, fBackgroundColor);
+                // Bind renderbuffer again
+                renderTexture.bind();
+            }
 
-        pModel->drawXlu(view_mtx, projMtx);
-    }
-    RIO_LOG("drawXlu rendered to the buffer.\n");
+            pModel->drawXlu(view_mtx, projMtx);
+        }
+        RIO_LOG("drawXlu rendered to the buffer.\n");
 
 
 #ifdef ENABLE_BENCHMARK
-    std::chrono::time_point<std::chrono::high_resolution_clock> start, end;
-    start = std::chrono::high_resolution_clock::now();
+        std::chrono::time_point<std::chrono::high_resolution_clock> start, end;
+        start = std::chrono::high_resolution_clock::now();
 #endif
-    if (!hasWrittenTGAHeader)
-        writeTGAHeaderToSocket(socket, totalWidth, totalHeight, renderTexture.getColorFormat());
-
-    copyAndSendRenderBufferToSocket(renderTexture.getColorTexture(), socket, ssaaFactor);
-    hasWrittenTGAHeader = true;
+        u8 header[TGA_HEADER_WITH_ID_SIZE];
+        u32 headerSize = 0;
+        if (!hasWrittenTGAHeader)
+            headerSize = makeTGAHeader(header, totalWidth, totalHeight, renderTexture.getColorFormat(), pImageID);
+
+        // only the first instance and layer carries the header
+        sent = copyAndSendRenderBufferToSocket(renderTexture.getColorTexture(), socket, ssaaFactor,
+            hasWrittenTGAHeader ? nullptr : header, headerSize);
+        hasWrittenTGAHeader = true;
 #ifdef ENABLE_BENCHMARK
-    end = std::chrono::high_resolution_clock::now();
-    long long int duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-    RIO_LOG("copyAndSendRenderBufferToSocket: %lld µs\n", duration);
+        end = std::chrono::high_resolution_clock::now();
+        long long int duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        RIO_LOG("copyAndSendRenderBufferToSocket: %lld µs\n", duration);
 #endif
+    }
 
-    if (instanceCurrent < instanceTotal - 1)
+    // no point in rendering the rest if the client is gone
+    if (sent && instanceCurrent < instanceTotal - 1)
     {
         instanceCurrent++;
         goto instanceCountNewRender; // jump back earlier
@@ -1595,64 +1857,486 @@ void RootTask::handleRenderRequest(char* buf, Model** ppModel, int socket)
     }
 #endif
 
-    closesocket(socket);
-    RIO_LOG("Closed socket %d.\n", socket);
 }
 
-void RootTask::calc_()
+#if RIO_IS_WIN
+
+#if defined(_WIN32)
+    #define socketPoll WSAPoll
+    #define socketWouldBlock() (WSAGetLastError() == WSAEWOULDBLOCK)
+#else
+    #include <poll.h>
+    #include <cerrno>
+    #define socketPoll poll
+    #define socketWouldBlock() (errno == EAGAIN || errno == EWOULDBLOCK)
+#endif // _WIN32
+
+// Checks if the client hung up while its request was
+// waiting, it sends nothing after the request otherwise.
+static bool isSocketDisconnected(int socket)
 {
-    if (!mInitialized)
+    pollfd pfd;
+    pfd.fd = socket;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    if (socketPoll(&pfd, 1, 0) <= 0)
+        return false; // nothing happened
+    if (pfd.revents & (POLLERR | POLLHUP))
+        return true;
+
+    // 0 is the client shutting down its sending side, which is fine
+    // after a full request (shutdown(SHUT_WR)), it still reads the
+    // response. Only a reset means that nobody is listening anymore,
+    // which is why the web server resets when a request is cancelled.
+    char peek;
+    if (recv(socket, &peek, 1, MSG_PEEK) >= 0)
+        return false;
+#ifdef _WIN32
+    return WSAGetLastError() == WSAECONNRESET;
+#else
+    return errno == ECONNRESET;
+#endif
+}
+
+bool RootTask::readIncomingRequest_(IncomingRequest* pIncoming)
+{
+    // v1 is longer than the v2 header, so read that much first either way
+    static_assert(sizeof(RenderRequestHeaderV2) <= RENDERREQUEST_SIZE, "v2 header must be shorter than v1");
+    static const u32 cHeaderSize = sizeof(RenderRequestHeaderV2);
+
+    PendingRequest* pPending = &pIncoming->pending;
+    const int socket = pPending->socket;
+    while (true)
+    {
+        // where the next bytes go: the header, then the rest
+        // of the v1 struct after it or the v2 body
+        u8* pDest;
+        u32 size;
+        if (pIncoming->received < cHeaderSize)
+        {
+            pDest = reinterpret_cast<u8*>(&pIncoming->header) + pIncoming->received;
+            size = cHeaderSize - pIncoming->received;
+        }
+        else if (!pIncoming->isV2)
+        {
+            pDest = reinterpret_cast<u8*>(&pPending->request) + pIncoming->received;
+            size = RENDERREQUEST_SIZE - pIncoming->received;
+        }
+        else
+        {
+            const u32 bodyReceived = pIncoming->received - cHeaderSize;
+            pDest = pPending->body.data() + bodyReceived;
+            size = pIncoming->header.bodySize - bodyReceived;
+        }
+
+        if (size == 0)
+        {
+            queueIncomingRequest_(pIncoming);
+            return false;
+        }
+
+        const int readBytes = recv(socket, reinterpret_cast<char*>(pDest), static_cast<int>(size), 0);
+        if (readBytes < 0)
+        {
+#ifndef _WIN32
+            if (errno == EINTR)
+                continue;
+#endif
+            if (socketWouldBlock())
+                break; // the rest comes later
+        }
+        if (readBytes <= 0)
+        {
+            RIO_LOG("readIncomingRequest_: socket %d closed after %u bytes of its request, dropping\n", socket, pIncoming->received);
+            closesocket(socket);
+            return false;
+        }
+
+        pIncoming->received += readBytes;
+        if (pIncoming->received != cHeaderSize)
+            continue;
+
+        // header is complete, now it is known how much follows
+        pIncoming->isV2 = isRenderRequestHeaderV2(&pIncoming->header);
+        if (!pIncoming->isV2)
+            // v1: the header was the start of the fixed struct
+            rio::MemUtil::copy(&pPending->request, &pIncoming->header, cHeaderSize);
+        else if (pIncoming->header.bodySize > RENDER_REQUEST_V2_MAX_BODY_SIZE)
+        {
+            RIO_LOG("readIncomingRequest_: body of %u bytes is too large\n", pIncoming->header.bodySize);
+            sendSocketError(socket, "Request body is too large.\n");
+            closesocket(socket);
+            return false;
+        }
+        else
+            pPending->body.resize(pIncoming->header.bodySize);
+    }
+
+    // one deadline for the whole request, not per read
+    if (std::chrono::steady_clock::now() > pIncoming->deadline)
+    {
+        RIO_LOG("readIncomingRequest_: socket %d sent %u bytes in %d ms, dropping\n",
+                socket, pIncoming->received, RENDER_REQUEST_RECV_TIMEOUT_MS);
+        closesocket(socket);
+        return false;
+    }
+    return true;
+}
+
+void RootTask::queueIncomingRequest_(IncomingRequest* pIncoming)
+{
+    PendingRequest* pPending = &pIncoming->pending;
+    RenderRequest* pRequest = &pPending->request;
+    const RenderRequestHeaderV2& header = pIncoming->header;
+    const int socket = pPending->socket;
+    // it was only non-blocking for reading, responses are sent in one go
+    setSocketNonBlocking(socket, false);
+
+    std::string errMsg;
+    if (pIncoming->isV2)
+    {
+        if (header.flags & RENDER_REQUEST_V2_FLAG_METRICS)
+        {
+            const std::string metrics = mRequestQueue.formatMetrics() + mCharModelCache.formatMetrics()
+                + TextureMemory::instance().formatMetrics() + ModelPool::instance().formatMetrics();
+            sendAllToSocket(socket, metrics.c_str(), metrics.length());
+            closesocket(socket);
+            return; // nothing to render
+        }
+
+        initRenderRequestDefaults(pRequest);
+        const char* parseError = parseRenderRequestBodyV2(pRequest, &pPending->extra, &pPending->batch,
+                                                          pPending->body.data(), header.bodySize);
+        if (parseError != nullptr)
+            errMsg = parseError;
+        // the header is not part of what the body parser sees
+        pPending->extra.sendImageID = (header.flags & RENDER_REQUEST_V2_FLAG_IMAGE_ID) != 0;
+    }
+
+    if (errMsg.empty()
+        && pPending->batch.count > 0
+        && (pRequest->responseFormat & RESPONSE_FORMAT_MASK) == RESPONSE_FORMAT_GLTF_MODEL)
+        errMsg = "Batch requests can only render images.\n";
+
+    if (!errMsg.empty())
+    {
+        RIO_LOG("%s", errMsg.c_str());
+        sendSocketError(socket, errMsg);
+        closesocket(socket);
         return;
+    }
 
-#if RIO_IS_WIN
-    char buf[RENDERREQUEST_SIZE];
+    pPending->priority = pPending->extra.priority != RENDER_REQUEST_PRIORITY_DEFAULT
+                       ? static_cast<RenderRequestPriority>(pPending->extra.priority) : pIncoming->lane;
 
-    bool hasSocketRequest = false;
+    // the deadline starts when the request is read, so the
+    // clocks of the client and the renderer don't need to match
+    const u32 deadlineMs = pPending->extra.deadlineMs != 0
+                         ? pPending->extra.deadlineMs : mDefaultDeadlineMs;
+    pPending->deadline = deadlineMs != 0
+                       ? std::chrono::steady_clock::now() + std::chrono::milliseconds(deadlineMs)
+                       : std::chrono::steady_clock::time_point::max();
+
+    // reject right away instead of leaving it in the backlog
+    const RenderRequestPriority lane = pPending->priority;
+    if (!mRequestQueue.push(std::move(*pPending)))
+    {
+        RIO_LOG("queueIncomingRequest_: lane %u is full (%u), turning away socket %d\n", lane, mRequestQueue.getDepth(lane), socket);
+        sendSocketError(socket, "Render queue is full.\n", socketBusyPrefix);
+        closesocket(socket);
+    }
+}
 
-    const size_t addrlen = sizeof(mServerAddress);
+void RootTask::acceptRequests_()
+{
+    const u32 listenCount = mBulkServerFD >= 0 ? 2 : 1;
+    std::vector<pollfd> pfds;
 
-    if (mSocketIsListening &&
-        (mServerSocket = accept(mServerFD, (struct sockaddr *)&mServerAddress, (socklen_t*)&addrlen)) > 0)
+    // under a flood, stop after a while so that rendering can go on
+    for (u32 i = 0; i < mRequestQueue.getMaxDepth(); i++)
     {
-        int read_bytes =
-            recv(mServerSocket, buf, RENDERREQUEST_SIZE, 0);
+        // the lane of the requests coming in on each listening
+        // socket, then every request that is still arriving
+        pfds.resize(listenCount + mIncoming.size());
+        pfds[RENDER_REQUEST_PRIORITY_INTERACTIVE].fd = mServerFD;
+        if (listenCount > RENDER_REQUEST_PRIORITY_BULK)
+            pfds[RENDER_REQUEST_PRIORITY_BULK].fd = mBulkServerFD;
+        for (u32 j = 0; j < mIncoming.size(); j++)
+            pfds[listenCount + j].fd = mIncoming[j].pending.socket;
+        for (pollfd& pfd : pfds)
+        {
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+        }
 
-        if (read_bytes == RENDERREQUEST_SIZE)
+        // only wait when there is nothing to render (server only,
+        // otherwise the listening sockets are non-blocking anyway),
+        // and then no longer than the first request that is due
+        int timeoutMs = 0;
+        if (sServerOnlyFlag && mRequestQueue.isEmpty())
         {
-            delete mpModel;
-            hasSocketRequest = true;
+            timeoutMs = -1;
+            const auto now = std::chrono::steady_clock::now();
+            for (const IncomingRequest& incoming : mIncoming)
+            {
+                const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(incoming.deadline - now).count();
+                const int leftMs = left > 0 ? static_cast<int>(left) + 1 : 0;
+                if (timeoutMs < 0 || leftMs < timeoutMs)
+                    timeoutMs = leftMs;
+            }
+        }
 
-            RenderRequest* req = reinterpret_cast<RenderRequest*>(buf);
+        const int ret = socketPoll(pfds.data(), static_cast<u32>(pfds.size()), timeoutMs);
+        if (ret < 0)
+            return;
 
-            if (!createModel_(req, mServerSocket))
+        // Read whatever arrived without waiting for more, so a client
+        // that trickles its request in never holds up rendering.
+        // Backwards, so that erasing leaves the rest at their pollfd.
+        const auto now = std::chrono::steady_clock::now();
+        for (u32 j = static_cast<u32>(mIncoming.size()); j-- > 0;)
+        {
+            IncomingRequest& incoming = mIncoming[j];
+            bool keep;
+            if (pfds[listenCount + j].revents != 0)
+                keep = readIncomingRequest_(&incoming);
+            else if (now > incoming.deadline)
             {
-                mpModel = nullptr;
-                mCounter = 0.0f;
-            };
+                RIO_LOG("acceptRequests_: socket %d sent %u bytes in %d ms, dropping\n",
+                        incoming.pending.socket, incoming.received, RENDER_REQUEST_RECV_TIMEOUT_MS);
+                closesocket(incoming.pending.socket);
+                keep = false;
+            }
+            else
+                keep = true;
+
+            if (!keep)
+                mIncoming.erase(mIncoming.begin() + j);
+        }
+
+        for (u32 priority = 0; priority < listenCount; priority++)
+        {
+            if (!(pfds[priority].revents & POLLIN))
+                continue;
+            // the rest stay in the backlog until some of these are done
+            if (mIncoming.size() >= RENDER_REQUEST_INCOMING_MAX)
+                break;
+
+            int socket;
+            sockaddr_storage clientAddress; // tcp or unix
+            socklen_t addrlen = sizeof(clientAddress);
+            if ((socket = accept(pfds[priority].fd, (struct sockaddr *)&clientAddress, &addrlen)) <= 0)
+                continue;
+            // reads only take what is there, see readIncomingRequest_
+            setSocketNonBlocking(socket);
+
+            IncomingRequest incoming;
+            incoming.pending.socket = socket;
+            incoming.pending.extra.deadlineMs = 0;
+            incoming.pending.extra.priority = RENDER_REQUEST_PRIORITY_DEFAULT;
+            incoming.pending.extra.sendImageID = false;
+            incoming.pending.batch.count = 0;
+            incoming.pending.batchNext = 0;
+            incoming.lane = static_cast<RenderRequestPriority>(priority);
+            incoming.received = 0;
+            incoming.isV2 = false;
+            incoming.deadline = std::chrono::steady_clock::now()
+                              + std::chrono::milliseconds(RENDER_REQUEST_RECV_TIMEOUT_MS);
+
+            // usually the whole request is already there
+            if (readIncomingRequest_(&incoming))
+                mIncoming.push_back(std::move(incoming));
+        }
+
+        if (ret == 0)
+            return;
+    }
+}
+
+bool RootTask::popRequest_(PendingRequest* pPending)
+{
+    while (mRequestQueue.pop(pPending))
+    {
+        // a resumed batch already started its response, so
+        // it answers the rest of its Miis as expired itself
+        if (pPending->batchNext == 0 && std::chrono::steady_clock::now() > pPending->deadline)
+        {
+            RIO_LOG("popRequest_: deadline passed for socket %d, dropping\n", pPending->socket);
+            mRequestQueue.countShed(pPending->priority, SHED_REASON_DEADLINE);
+            sendSocketError(pPending->socket, "Deadline passed before rendering.\n", socketExpiredPrefix);
         }
+        else if (isSocketDisconnected(pPending->socket))
+        {
+            RIO_LOG("popRequest_: socket %d disconnected, dropping\n", pPending->socket);
+            mRequestQueue.countShed(pPending->priority, SHED_REASON_DISCONNECTED);
+        }
+        else
+            return true;
+
+        closesocket(pPending->socket);
+    }
+    return false;
+}
+
+bool RootTask::hasWaitingConnection_()
+{
+    pollfd pfds[RENDER_REQUEST_PRIORITY_MAX];
+    pfds[0].fd = mServerFD;
+    pfds[1].fd = mBulkServerFD;
+    for (pollfd& pfd : pfds)
+    {
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+    }
+    return socketPoll(pfds, mBulkServerFD >= 0 ? 2 : 1, 0) > 0;
+}
+
+bool RootTask::handleBatchRequest_(PendingRequest* pPending)
+{
+    RenderRequest* req = &pPending->request;
+    const RenderRequestBatch& batch = pPending->batch;
+    const int socket = pPending->socket;
+
+    RIO_LOG("handleBatchRequest_: Miis %u to %u\n", pPending->batchNext, batch.count);
+
+    // everything but the data stays the same, so the same
+    // shader and projection are used for the whole batch
+    for (u32 i = pPending->batchNext; i < batch.count; i++)
+    {
+        std::string errMsg;
+        bool created = false;
+        if (std::chrono::steady_clock::now() > pPending->deadline)
+            // rest of the batch gets answered but not rendered
+            errMsg = socketExpiredPrefix + "Deadline passed before rendering.\n";
         else
         {
-            RIO_LOG("got a request of length %i (should be %d), dropping\n", read_bytes, static_cast<u32>(RENDERREQUEST_SIZE));
-            closesocket(mServerSocket);
+            rio::MemUtil::copy(req->data, batch.pData[i], batch.dataLength[i]);
+            req->dataLength = batch.dataLength[i];
+
+            mCharModelCache.release(mpModel);
+            created = createModel_(req, &errMsg);
+            if (!created)
+            {
+                mpModel = nullptr;
+                errMsg = socketErrorPrefix + errMsg;
+            }
+        }
+
+        RenderBatchPartHeader partHeader;
+        partHeader.index = static_cast<u16>(i);
+        partHeader.status = created ? RENDER_BATCH_PART_STATUS_OK : RENDER_BATCH_PART_STATUS_ERROR;
+        partHeader.reserved = 0;
+        partHeader.errorLength = created ? 0 : static_cast<u32>(errMsg.length());
+
+        const SocketBuffer buffers[] = {
+            { &partHeader, sizeof(partHeader) },
+            { errMsg.c_str(), partHeader.errorLength },
+        };
+        // the client is gone, no use rendering the rest
+        if (!sendBuffersToSocket(socket, buffers, 2))
+            break;
+
+        if (created)
+            handleRenderRequest(reinterpret_cast<char*>(req), &mpModel, socket, pPending->extra.sendImageID);
+
+        // a bulk batch can be hundreds of renders, don't
+        // make a request that just came in wait behind it
+        if (pPending->priority == RENDER_REQUEST_PRIORITY_BULK && i + 1 < batch.count
+            && (!mRequestQueue.isEmpty(RENDER_REQUEST_PRIORITY_INTERACTIVE) || hasWaitingConnection_()))
+        {
+            pPending->batchNext = i + 1;
+            mCounter = 0.0f;
+            return false;
         }
     }
-    else
+
+    mCounter = 0.0f;
+    return true;
+}
+
+#endif // RIO_IS_WIN
+
+void RootTask::calc_()
+{
+    if (!mInitialized)
+        return;
+
+#ifdef USE_EGL_HEADLESS
+    // nothing can be rendered without it
+    if (!HeadlessEGL::makeCurrent())
+    {
+        fprintf(stderr, "Lost the headless EGL context, see the log for why.\n");
+        rio::Exit();
+        exit(EXIT_FAILURE);
+    }
+#endif
+
+#if RIO_IS_WIN
+    bool hasSocketRequest = false;
+
+    if (mSocketIsListening)
+    {
+        acceptRequests_();
+        if (popRequest_(&mCurrentRequest))
+        {
+            hasSocketRequest = true;
+
+            // batches create each model themselves
+            if (mCurrentRequest.batch.count == 0)
+            {
+                mCharModelCache.release(mpModel);
+                std::string errMsg;
+                if (!createModel_(&mCurrentRequest.request, &errMsg))
+                {
+                    sendSocketError(mCurrentRequest.socket, errMsg);
+                    mpModel = nullptr;
+                    mCounter = 0.0f;
+                }
+            }
+        }
+    }
+
+    if (!hasSocketRequest)
     {
         // otherwise just fall through and use default
         // when mii is directly in front of the camera
 #endif // RIO_IS_WIN
         if (!sServerOnlyFlag && mCounter >= rio::Mathf::pi2())
         {
-            delete mpModel;
+            mCharModelCache.release(mpModel);
             createModel_();
         }
 #if RIO_IS_WIN
     }
-#endif
 
     if (hasSocketRequest)
     {
-        handleRenderRequest(buf, &mpModel, mServerSocket);
+        const int socket = mCurrentRequest.socket;
+        bool isFinished = true;
+        // a batch is answered part by part even if some fail,
+        // a single request has no model when createModel_ failed
+        bool isRendered = true;
+        if (mCurrentRequest.batch.count > 0)
+            isFinished = handleBatchRequest_(&mCurrentRequest);
+        else
+        {
+            isRendered = mpModel != nullptr;
+            handleRenderRequest(reinterpret_cast<char*>(&mCurrentRequest.request), &mpModel, socket,
+                                mCurrentRequest.extra.sendImageID);
+        }
+
+        if (isFinished)
+        {
+            if (isRendered)
+                mRequestQueue.countRendered(mCurrentRequest.priority);
+            closesocket(socket);
+            RIO_LOG("Closed socket %d.\n", socket);
+        }
+        else
+            // picked up again after what is waiting got its turn
+            mRequestQueue.requeue(std::move(mCurrentRequest));
+#ifndef USE_EGL_HEADLESS // server only anyway, and this would replace the EGL context
         if (!sServerOnlyFlag)
         {
             rio::Window::instance()->makeContextCurrent();
@@ -1664,8 +2348,10 @@ void RootTask::calc_()
             rio::Graphics::setScissor(0, 0, width, height);
             RIO_LOG("Viewport and scissor reset to window dimensions: %dx%d\n", width, height);
         }
+#endif
         return;
     }
+#endif // RIO_IS_WIN
 
     if (!sServerOnlyFlag)
     {
@@ -1714,7 +2400,15 @@ void RootTask::calc_()
     mCamera.getMatrix(&view_mtx);
 
     static const BodyType cBodyType = BODY_TYPE_WIIU_MIIBODYMIDDLE;
-    BodyModel bodyModel(getBodyModel_(mpModel, cBodyType), cBodyType);
+    rio::mdl::Model* pBodyModel = getBodyModel_(mpModel, cBodyType);
+    if (pBodyModel == nullptr)
+    {
+        // no request to fail here, this is the window preview
+        fprintf(stderr, "\nBody model for the preview not found. Exiting.\n");
+        rio::Exit();
+        exit(EXIT_FAILURE);
+    }
+    BodyModel bodyModel(pBodyModel, cBodyType);
     bodyModel.initialize(mpModel, PANTS_COLOR_GRAY);
 
     rio::Matrix34f rotationMtx = model_mtx;
@@ -1731,14 +2425,64 @@ void RootTask::calc_()
 #ifndef NO_GLTF
 
 #include "GLTFExportCallback.h"
-#include <sstream>
 
-void handleGLTFRequest(RenderRequest* req, Model* pModel, int socket)
+void RootTask::handleGLTFRequest(RenderRequest* req, Model* pModel, int socket)
 {
     // Initialize ExportShader
     GLTFExportCallback exportShader;
 
     exportShader.SetCharModel(pModel->getCharModel());
+    if (req->responseFormat & GLTF_EXPORT_FLAG_KTX2)
+        exportShader.SetImageFormat(GLTFExportCallback::IMAGE_FORMAT_KTX2);
+    exportShader.SetMeshQuantization(req->responseFormat & GLTF_EXPORT_FLAG_QUANTIZE);
+
+    FFLiCharInfo* pCharInfo = pModel->getCharInfo();
+
+    // full body views export the body, with the head on top of it
+    const ViewType viewType = static_cast<ViewType>(req->viewType);
+    if (viewType == VIEW_TYPE_ALL_BODY || viewType == VIEW_TYPE_ALL_BODY_SUGAR)
+    {
+        BodyType bodyType = static_cast<BodyType>(req->bodyType);
+        if (bodyType <= BODY_TYPE_DEFAULT_FOR_SHADER
+            || bodyType >= BODY_TYPE_MAX)
+            bodyType = cShaderTypeDefaultBodyType[req->shaderType % SHADER_TYPE_MAX];
+
+        PantsColor pantsColor = static_cast<PantsColor>(req->pantsColor);
+        if (pantsColor <= PANTS_COLOR_DEFAULT_FOR_SHADER
+            || pantsColor >= PANTS_COLOR_MAX)
+            pantsColor = cShaderTypeDefaultPantsType[req->shaderType % SHADER_TYPE_MAX];
+
+        BodyModel bodyModel(getBodyModel_(pModel, bodyType), bodyType);
+        bodyModel.initialize(pModel, pantsColor);
+
+        FFLFavoriteColor favoriteColor = pCharInfo->favoriteColor;
+        if (req->clothesColor >= 0 && req->clothesColor < FFL_FAVORITE_COLOR_MAX)
+            favoriteColor = static_cast<FFLFavoriteColor>(req->clothesColor);
+        const FFLColor bodyColor = FFLGetFavoriteColor(favoriteColor);
+
+        const FFLColor* pPantsColor = nullptr;
+        if (pantsColor == PANTS_COLOR_SAME_AS_BODY)
+            pPantsColor = &bodyColor;
+        else if (pantsColor < PANTS_COLOR_COUNT)
+            pPantsColor = &cPantsColors[pantsColor];
+
+        const FFLGender gender = static_cast<FFLGender>(pCharInfo->gender % FFL_GENDER_MAX);
+        exportShader.SetBody(&mGLTFBodyMeshes[bodyType][gender], bodyModel.getBodyScale(), bodyColor, pPantsColor);
+        exportShader.SetHeadTransform(bodyModel.getHeadRotation(), bodyModel.getHeadTranslation());
+    }
+
+    if (req->hatType > 0 && req->hatType < cMaxHats)
+    {
+        HatModel hatModel(getHatModel_(pModel, req->hatType));
+        hatModel.initialize(pModel, req->hatColor);
+
+        FFLPartsTransform partsTransform;
+        FFLGetPartsTransform(&partsTransform, pModel->getCharModel());
+
+        exportShader.SetHat(&mGLTFHatMeshes[req->hatType % cMaxHats],
+            { partsTransform.hatTranslate.x, partsTransform.hatTranslate.y, partsTransform.hatTranslate.z },
+            hatModel.getHatColor());
+    }
 
     RIO_LOG("Created glTF export callback.\n");
 
@@ -1771,33 +2515,12 @@ void handleGLTFRequest(RenderRequest* req, Model* pModel, int socket)
     exportShader.ExportModelToFile(output);
     */
 
-    // Create a stream buffer to hold the GLTF model data
-    std::ostringstream modelStream;
-
-    // Export the GLTF model to the stream
-    if (!exportShader.ExportModelToStream(&modelStream))
+    // Export the GLTF model straight to the socket
+    if (!exportShader.ExportModelToSocket(socket))
     {
-        RIO_LOG("Failed to export GLTF model to stream.\n");
+        RIO_LOG("Failed to export GLTF model to socket.\n");
         return;
     }
-
-    // Get the model data from the stream
-    std::string modelData = modelStream.str();
-
-    // Send the actual GLTF model data
-    unsigned long totalSent = 0;
-    const unsigned long fileSize = modelData.size();
-    while (totalSent < fileSize)
-    {
-        long sent = send(socket, modelData.data() + totalSent, fileSize - totalSent, 0);
-        if (sent < 0)
-        {
-            RIO_LOG("Failed to send GLTF data\n");
-            return;
-        }
-        totalSent += sent;
-    }
-    RIO_LOG("Wrote %lu bytes out to socket.\n", fileSize);
 }
 
 #endif // NO_GLTF
@@ -1810,8 +2533,12 @@ void RootTask::exit_()
     // we need to free stuff that's allocated in our program
     // ... which is usually all pointers
 
-    delete mpModel; // FFLCharModel destruction must happen before FFLExit
+    // FFLCharModel destruction must happen before FFLExit
+    mCharModelCache.release(mpModel);
     mpModel = nullptr;
+    mCharModelCache.clear();
+    // only storage is left in there, no FFL objects
+    ModelPool::instance().setMaxFree(0);
 
     FFLExit();
 
@@ -1832,5 +2559,10 @@ void RootTask::exit_()
         if (mpHatModels[i] != nullptr)
             delete mpHatModels[i];
 
+#ifdef USE_EGL_HEADLESS
+    // every GL object is gone, the context can go too
+    HeadlessEGL::finalize();
+#endif
+
     mInitialized = false;
 }
\ No newline at end of file
@@ -243,12 +243,15 @@ const f32 cRimPower = 2.0f;
 
 }
 
-Shader::Shader()
+Shader::Shader(Shader* pProgramOwner)
+    : mpShader(pProgramOwner != nullptr ? &pProgramOwner->mShader : &mShader)
+    , mpUniformCache(pProgramOwner != nullptr ? &pProgramOwner->mUniformCache : &mUniformCache)
+    , mpTextureShader(pProgramOwner != nullptr ? pProgramOwner : this)
 #if RIO_IS_CAFE
-    : mAttribute()
+    , mAttribute()
     , mFetchShader()
 #elif RIO_IS_WIN
-    : mVBOHandle()
+    , mVBOHandle()
     , mVAOHandle()
 #endif
     , mCallback()
@@ -300,38 +303,39 @@ void Shader::resetUniformsToDefault()
 
 void Shader::initialize()
 {
-    mShader.load("FFLShader", rio::Shader::MODE_UNIFORM_REGISTER);
-
-    mVertexUniformLocation[VERTEX_UNIFORM_IT]   = mShader.getVertexUniformLocation("u_it");
-    mVertexUniformLocation[VERTEX_UNIFORM_MV]   = mShader.getVertexUniformLocation("u_mv");
-    mVertexUniformLocation[VERTEX_UNIFORM_PROJ] = mShader.getVertexUniformLocation("u_proj");
-
-    mPixelUniformLocation[PIXEL_UNIFORM_CONST1]                     = mShader.getFragmentUniformLocation("u_const1");
-    mPixelUniformLocation[PIXEL_UNIFORM_CONST2]                     = mShader.getFragmentUniformLocation("u_const2");
-    mPixelUniformLocation[PIXEL_UNIFORM_CONST3]                     = mShader.getFragmentUniformLocation("u_const3");
-    mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_AMBIENT]              = mShader.getFragmentUniformLocation("u_light_ambient");
-    mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_DIFFUSE]              = mShader.getFragmentUniformLocation("u_light_diffuse");
-    mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_DIR]                  = mShader.getFragmentUniformLocation("u_light_dir");
-    mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_ENABLE]               = mShader.getFragmentUniformLocation("u_light_enable");
-    mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_SPECULAR]             = mShader.getFragmentUniformLocation("u_light_specular");
-    mPixelUniformLocation[PIXEL_UNIFORM_MATERIAL_AMBIENT]           = mShader.getFragmentUniformLocation("u_material_ambient");
-    mPixelUniformLocation[PIXEL_UNIFORM_MATERIAL_DIFFUSE]           = mShader.getFragmentUniformLocation("u_material_diffuse");
-    mPixelUniformLocation[PIXEL_UNIFORM_MATERIAL_SPECULAR]          = mShader.getFragmentUniformLocation("u_material_specular");
-    mPixelUniformLocation[PIXEL_UNIFORM_MATERIAL_SPECULAR_MODE]     = mShader.getFragmentUniformLocation("u_material_specular_mode");
-    mPixelUniformLocation[PIXEL_UNIFORM_MATERIAL_SPECULAR_POWER]    = mShader.getFragmentUniformLocation("u_material_specular_power");
-    mPixelUniformLocation[PIXEL_UNIFORM_MODE]                       = mShader.getFragmentUniformLocation("u_mode");
-    mPixelUniformLocation[PIXEL_UNIFORM_RIM_COLOR]                  = mShader.getFragmentUniformLocation("u_rim_color");
-    mPixelUniformLocation[PIXEL_UNIFORM_RIM_POWER]                  = mShader.getFragmentUniformLocation("u_rim_power");
+    if (mpShader == &mShader)
+        mShader.load("FFLShader", rio::Shader::MODE_UNIFORM_REGISTER);
+
+    mVertexUniformLocation[VERTEX_UNIFORM_IT]   = mpShader->getVertexUniformLocation("u_it");
+    mVertexUniformLocation[VERTEX_UNIFORM_MV]   = mpShader->getVertexUniformLocation("u_mv");
+    mVertexUniformLocation[VERTEX_UNIFORM_PROJ] = mpShader->getVertexUniformLocation("u_proj");
+
+    mPixelUniformLocation[PIXEL_UNIFORM_CONST1]                     = mpShader->getFragmentUniformLocation("u_const1");
+    mPixelUniformLocation[PIXEL_UNIFORM_CONST2]                     = mpShader->getFragmentUniformLocation("u_const2");
+    mPixelUniformLocation[PIXEL_UNIFORM_CONST3]                     = mpShader->getFragmentUniformLocation("u_const3");
+    mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_AMBIENT]              = mpShader->getFragmentUniformLocation("u_light_ambient");
+    mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_DIFFUSE]              = mpShader->getFragmentUniformLocation("u_light_diffuse");
+    mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_DIR]                  = mpShader->getFragmentUniformLocation("u_light_dir");
+    mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_ENABLE]               = mpShader->getFragmentUniformLocation("u_light_enable");
+    mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_SPECULAR]             = mpShader->getFragmentUniformLocation("u_light_specular");
+    mPixelUniformLocation[PIXEL_UNIFORM_MATERIAL_AMBIENT]           = mpShader->getFragmentUniformLocation("u_material_ambient");
+    mPixelUniformLocation[PIXEL_UNIFORM_MATERIAL_DIFFUSE]           = mpShader->getFragmentUniformLocation("u_material_diffuse");
+    mPixelUniformLocation[PIXEL_UNIFORM_MATERIAL_SPECULAR]          = mpShader->getFragmentUniformLocation("u_material_specular");
+    mPixelUniformLocation[PIXEL_UNIFORM_MATERIAL_SPECULAR_MODE]     = mpShader->getFragmentUniformLocation("u_material_specular_mode");
+    mPixelUniformLocation[PIXEL_UNIFORM_MATERIAL_SPECULAR_POWER]    = mpShader->getFragmentUniformLocation("u_material_specular_power");
+    mPixelUniformLocation[PIXEL_UNIFORM_MODE]                       = mpShader->getFragmentUniformLocation("u_mode");
+    mPixelUniformLocation[PIXEL_UNIFORM_RIM_COLOR]                  = mpShader->getFragmentUniformLocation("u_rim_color");
+    mPixelUniformLocation[PIXEL_UNIFORM_RIM_POWER]                  = mpShader->getFragmentUniformLocation("u_rim_power");
     // Custom uniform to set values previously handled by v_color if the color attribute is constant (stride = 0).
-    mPixelUniformLocation[PIXEL_UNIFORM_PARAMETER_MODE]             = mShader.getFragmentUniformLocation("u_parameter_mode");
+    mPixelUniformLocation[PIXEL_UNIFORM_PARAMETER_MODE]             = mpShader->getFragmentUniformLocation("u_parameter_mode");
 
-    mSamplerLocation = mShader.getFragmentSamplerLocation("s_texture");
+    mSamplerLocation = mpShader->getFragmentSamplerLocation("s_texture");
 
-    mAttributeLocation[FFL_ATTRIBUTE_BUFFER_TYPE_POSITION]  = mShader.getVertexAttribLocation("a_position");
+    mAttributeLocation[FFL_ATTRIBUTE_BUFFER_TYPE_POSITION]  = mpShader->getVertexAttribLocation("a_position");
     // 2D planes (faceline/mask) do not have anything but position and texcoord
-    mAttributeLocation[FFL_ATTRIBUTE_BUFFER_TYPE_NORMAL]    = mShader.getVertexAttribLocation("a_normal");
+    mAttributeLocation[FFL_ATTRIBUTE_BUFFER_TYPE_NORMAL]    = mpShader->getVertexAttribLocation("a_normal");
     // hair does not have texcoord
-    mAttributeLocation[FFL_ATTRIBUTE_BUFFER_TYPE_TEXCOORD] = mShader.getVertexAttribLocation("a_texCoord");
+    mAttributeLocation[FFL_ATTRIBUTE_BUFFER_TYPE_TEXCOORD] = mpShader->getVertexAttribLocation("a_texCoord");
     /* NOTE: "color" is not meant as an actual color... it is
      * only here as parameters to control the anisotropic effect
      * color.r - aniso specular blend, param 1 to calculateSpecularBlend
@@ -348,9 +352,9 @@ void Shader::initialize()
      * ... EXCEPT for where R is 0 in: hair type 34/beanie, and hair
      *              for hat meshes: 18, 23, 34, 39, 45, 57, 114, 127
      */
-    mAttributeLocation[FFL_ATTRIBUTE_BUFFER_TYPE_COLOR]     = mShader.getVertexAttribLocation("a_color");
+    mAttributeLocation[FFL_ATTRIBUTE_BUFFER_TYPE_COLOR]     = mpShader->getVertexAttribLocation("a_color");
     // tangent is only set on hair, size and stride are 0 on everything else
-    mAttributeLocation[FFL_ATTRIBUTE_BUFFER_TYPE_TANGENT]   = mShader.getVertexAttribLocation("a_tangent");
+    mAttributeLocation[FFL_ATTRIBUTE_BUFFER_TYPE_TANGENT]   = mpShader->getVertexAttribLocation("a_tangent");
 
 #if RIO_IS_CAFE
     GX2InitAttribStream(
@@ -432,24 +436,25 @@ void Shader::setLightDirection(const rio::Vector3f direction)
 void Shader::bind(bool light_enable, FFLiCharInfo* pCharInfo)
 {
     mpCharInfo = pCharInfo;
-    mShader.bind();
+    bindProgram_(mpShader);
     setShaderCallback_();
 #if RIO_IS_CAFE
     GX2SetFetchShader(&mFetchShader);
 #elif RIO_IS_WIN
-    RIO_GL_CALL(glBindVertexArray(mVAOHandle));
-    for (u32 i = 0; i < FFL_ATTRIBUTE_BUFFER_TYPE_MAX; i++)
-        RIO_GL_CALL(glDisableVertexAttribArray(i));
+    // draw_ enables or disables every attribute it has a location
+    // for, so there is no need to reset them all here
+    bindVertexArray_(mVAOHandle);
 #endif
 
-    mShader.setUniform(mLightDir, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_DIR]);
-    mShader.setUniform(light_enable, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_ENABLE]);
-    mShader.setUniform(getColorUniform(mLightAmbient), u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_AMBIENT]);
-    mShader.setUniform(getColorUniform(mLightDiffuse), u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_DIFFUSE]);
-    mShader.setUniform(getColorUniform(mLightSpecular), u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_SPECULAR]);
+    // only the values that changed since the last bind are set
+    setUniform_(mpShader, *mpUniformCache, mLightDir, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_DIR]);
+    setUniform_(mpShader, *mpUniformCache, light_enable, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_ENABLE]);
+    setUniform_(mpShader, *mpUniformCache, getColorUniform(mLightAmbient), u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_AMBIENT]);
+    setUniform_(mpShader, *mpUniformCache, getColorUniform(mLightDiffuse), u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_DIFFUSE]);
+    setUniform_(mpShader, *mpUniformCache, getColorUniform(mLightSpecular), u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_SPECULAR]);
 
-    mShader.setUniform(getColorUniform(cRimColor), u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_RIM_COLOR]);
-    mShader.setUniform(cRimPower, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_RIM_POWER]);
+    setUniform_(mpShader, *mpUniformCache, getColorUniform(cRimColor), u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_RIM_COLOR]);
+    setUniform_(mpShader, *mpUniformCache, cRimPower, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_RIM_POWER]);
 }
 
 #ifdef FFL_USE_ADJUST_MTX
@@ -458,7 +463,7 @@ rio::Matrix34f g_MV;
 
 void Shader::setViewUniform(const rio::BaseMtx34f& model_mtx, const rio::BaseMtx34f& view_mtx, const rio::BaseMtx44f& proj_mtx) const
 {
-    mShader.setUniform(proj_mtx, mVertexUniformLocation[VERTEX_UNIFORM_PROJ], u32(-1));
+    setUniform_(mpShader, *mpUniformCache, proj_mtx, mVertexUniformLocation[VERTEX_UNIFORM_PROJ], u32(-1));
 
     rio::Matrix34f mv;
     mv.setMul(static_cast<const rio::Matrix34f&>(view_mtx), static_cast<const rio::Matrix34f&>(model_mtx));
@@ -467,7 +472,10 @@ void Shader::setViewUniform(const rio::BaseMtx34f& model_mtx, const rio::BaseMtx
 #endif
     rio::Matrix44f mv44;
     mv44.fromMatrix34(mv);
-    mShader.setUniform(mv44, mVertexUniformLocation[VERTEX_UNIFORM_MV], u32(-1));
+    // same modelview, same normal matrix
+    if (!mpUniformCache->update(mVertexUniformLocation[VERTEX_UNIFORM_MV], u32(-1), mv44))
+        return;
+    mpShader->setUniform(mv44, mVertexUniformLocation[VERTEX_UNIFORM_MV], u32(-1));
 
     rio::Matrix34f it34 = mv;
     it34.setInverseTranspose(mv);
@@ -477,7 +485,8 @@ void Shader::setViewUniform(const rio::BaseMtx34f& model_mtx, const rio::BaseMtx
         it34.m[0][1], it34.m[1][1], it34.m[2][1],
         it34.m[0][2], it34.m[1][2], it34.m[2][2]
     };
-    mShader.setUniformColumnMajor(it, mVertexUniformLocation[VERTEX_UNIFORM_IT], u32(-1));
+    mpUniformCache->update(mVertexUniformLocation[VERTEX_UNIFORM_IT], u32(-1), it);
+    mpShader->setUniformColumnMajor(it, mVertexUniformLocation[VERTEX_UNIFORM_IT], u32(-1));
 }
 
 void Shader::applyAlphaTest(bool enable, rio::Graphics::CompareFunc func, f32 ref) const
@@ -487,31 +496,6 @@ void Shader::applyAlphaTest(bool enable, rio::Graphics::CompareFunc func, f32 re
 #endif
 }
 
-void Shader::setCulling(FFLCullMode mode)
-{
-    if (mode > FFL_CULL_MODE_FRONT)
-        return;
-
-    rio::RenderState render_state;
-
-    switch (mode)
-    {
-    case FFL_CULL_MODE_NONE:
-        render_state.setCullingMode(rio::Graphics::CULLING_MODE_NONE);
-        break;
-    case FFL_CULL_MODE_BACK:
-        render_state.setCullingMode(rio::Graphics::CULLING_MODE_BACK);
-        break;
-    case FFL_CULL_MODE_FRONT:
-        render_state.setCullingMode(rio::Graphics::CULLING_MODE_FRONT);
-        break;
-    default:
-        break;
-    }
-
-    render_state.applyCullingAndPolygonModeAndPolygonOffset();
-}
-
 void Shader::applyAlphaTestCallback_(void* p_obj, bool enable, rio::Graphics::CompareFunc func, f32 ref)
 {
     static_cast<Shader*>(p_obj)->applyAlphaTest(enable, func, ref);
@@ -520,20 +504,17 @@ void Shader::applyAlphaTestCallback_(void* p_obj, bool enable, rio::Graphics::Co
 void Shader::bindTexture_(const FFLModulateParam& modulateParam)
 {
     if (modulateParam.pTexture2D != nullptr)
-    {
-        mSampler.linkTexture2D(reinterpret_cast<const rio::Texture2D*>(modulateParam.pTexture2D));
-        mSampler.tryBindFS(mSamplerLocation, 0);
-    }
+        bindSamplerTexture_(mSampler, reinterpret_cast<const rio::Texture2D*>(modulateParam.pTexture2D), mSamplerLocation, 0);
 }
 
 void Shader::setConstColor_(u32 ps_loc, const FFLColor& color)
 {
-    mShader.setUniform(getColorUniform(color), u32(-1), ps_loc);
+    setUniform_(mpShader, *mpUniformCache, getColorUniform(color), u32(-1), ps_loc);
 }
 
 void Shader::setModulateMode_(FFLModulateMode mode)
 {
-    mShader.setUniform(s32(mode), u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_MODE]);
+    setUniform_(mpShader, *mpUniformCache, s32(mode), u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_MODE]);
 }
 
 void Shader::setModulate_(const FFLModulateParam& modulateParam)
@@ -586,22 +567,22 @@ void Shader::setMaterial_(const FFLModulateType modulateType)
     if (modulateType >= CUSTOM_MATERIAL_PARAM_SIZE)
         return;
 
-    mShader.setUniform(getColorUniform(cMaterialParam[modulateType].ambient), u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_MATERIAL_AMBIENT]);
-    mShader.setUniform(getColorUniform(cMaterialParam[modulateType].diffuse), u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_MATERIAL_DIFFUSE]);
-    mShader.setUniform(getColorUniform(cMaterialParam[modulateType].specular), u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_MATERIAL_SPECULAR]);
-    mShader.setUniform(cMaterialParam[modulateType].specularPower, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_MATERIAL_SPECULAR_POWER]);
+    setUniform_(mpShader, *mpUniformCache, getColorUniform(cMaterialParam[modulateType].ambient), u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_MATERIAL_AMBIENT]);
+    setUniform_(mpShader, *mpUniformCache, getColorUniform(cMaterialParam[modulateType].diffuse), u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_MATERIAL_DIFFUSE]);
+    setUniform_(mpShader, *mpUniformCache, getColorUniform(cMaterialParam[modulateType].specular), u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_MATERIAL_SPECULAR]);
+    setUniform_(mpShader, *mpUniformCache, cMaterialParam[modulateType].specularPower, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_MATERIAL_SPECULAR_POWER]);
 
     if (modulateType == CUSTOM_MATERIAL_PARAM_BODY
         || modulateType == CUSTOM_MATERIAL_PARAM_PANTS)
     {
         // body uses different rim color
-        mShader.setUniform(getColorUniform(cRimColorBody), u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_RIM_COLOR]);
+        setUniform_(mpShader, *mpUniformCache, getColorUniform(cRimColorBody), u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_RIM_COLOR]);
         // set parameter/basically rim light enable
-        mShader.setUniform(1, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_PARAMETER_MODE]); // FFL_PARAMETER_MODE_DEFAULT_1
+        setUniform_(mpShader, *mpUniformCache, 1, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_PARAMETER_MODE]); // FFL_PARAMETER_MODE_DEFAULT_1
     }
     else
         // set default rim color otherwise
-        mShader.setUniform(getColorUniform(cRimColor), u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_RIM_COLOR]);
+        setUniform_(mpShader, *mpUniformCache, getColorUniform(cRimColor), u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_RIM_COLOR]);
 }
 
 void Shader::draw_(const FFLDrawParam& draw_param)
@@ -623,7 +604,7 @@ void Shader::draw_(const FFLDrawParam& draw_param)
         if (draw_param.attributeBufferParam.attributeBuffers[FFL_ATTRIBUTE_BUFFER_TYPE_TANGENT].ptr == nullptr)
             materialSpecularMode = FFL_SPECULAR_MODE_NORMAL;
 
-        mShader.setUniform(materialSpecularMode, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_MATERIAL_SPECULAR_MODE]);
+        setUniform_(mpShader, *mpUniformCache, materialSpecularMode, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_MATERIAL_SPECULAR_MODE]);
     }
 
 #ifdef FFL_USE_ADJUST_MTX
@@ -633,7 +614,7 @@ void Shader::draw_(const FFLDrawParam& draw_param)
         mv.setMul(g_MV, *draw_param.primitiveParam.pAdjustMatrix);
         rio::Matrix44f mv44;
         mv44.fromMatrix34(mv);
-        mShader.setUniform(mv44, mVertexUniformLocation[VERTEX_UNIFORM_MV], u32(-1));
+        setUniform_(mpShader, *mpUniformCache, mv44, mVertexUniformLocation[VERTEX_UNIFORM_MV], u32(-1));
 
 /*
         rio::Matrix34f it34 = mv;
@@ -644,7 +625,7 @@ void Shader::draw_(const FFLDrawParam& draw_param)
             it34.m[0][1], it34.m[1][1], it34.m[2][1],
             it34.m[0][2], it34.m[1][2], it34.m[2][2]
         };
-        mShader.setUniformColumnMajor(it, mVertexUniformLocation[VERTEX_UNIFORM_IT], u32(-1));
+        mpShader->setUniformColumnMajor(it, mVertexUniformLocation[VERTEX_UNIFORM_IT], u32(-1));
 */
     }
 /* NOTE:
@@ -669,9 +650,6 @@ void Shader::draw_(const FFLDrawParam& draw_param)
         }
 #elif RIO_IS_WIN
 
-        GLuint indexBufferHandle;
-        RIO_GL_CALL(glGenBuffers(1, &indexBufferHandle));  // Generate a new buffer
-
         for (int type = FFL_ATTRIBUTE_BUFFER_TYPE_POSITION; type <= FFL_ATTRIBUTE_BUFFER_TYPE_COLOR; ++type)
         {
 
@@ -713,12 +691,12 @@ void Shader::draw_(const FFLDrawParam& draw_param)
                         // Dereference the first value as u8.
                         const u8* color = reinterpret_cast<u8*>(ptr);
                         if (color[0] == 0) // Only possibilities for first component are 0 or 1 (read above).
-                            mShader.setUniform(2, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_PARAMETER_MODE]); // FFL_PARAMETER_MODE_DEFAULT_2
+                            setUniform_(mpShader, *mpUniformCache, 2, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_PARAMETER_MODE]); // FFL_PARAMETER_MODE_DEFAULT_2
                         else
-                            mShader.setUniform(1, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_PARAMETER_MODE]); // FFL_PARAMETER_MODE_DEFAULT_1
+                            setUniform_(mpShader, *mpUniformCache, 1, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_PARAMETER_MODE]); // FFL_PARAMETER_MODE_DEFAULT_1
                         break; // Break out of the switch case.
                     }
-                    mShader.setUniform(0, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_PARAMETER_MODE]); // FFL_PARAMETER_MODE_COLOR
+                    setUniform_(mpShader, *mpUniformCache, 0, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_PARAMETER_MODE]); // FFL_PARAMETER_MODE_COLOR
                     RIO_GL_CALL(glVertexAttribPointer(location, 4, GL_UNSIGNED_BYTE, true, stride, nullptr));
                     break;
                 default:
@@ -748,15 +726,17 @@ void Shader::drawCallback_(void* p_obj, const FFLDrawParam* draw_param)
 
 void Shader::setMatrix_(const rio::BaseMtx44f& matrix)
 {
-    mShader.setUniform(matrix, mVertexUniformLocation[VERTEX_UNIFORM_PROJ], u32(-1));
-    mShader.setUniformColumnMajor(rio::Matrix44f::ident, mVertexUniformLocation[VERTEX_UNIFORM_MV], u32(-1));
+    setUniform_(mpShader, *mpUniformCache, matrix, mVertexUniformLocation[VERTEX_UNIFORM_PROJ], u32(-1));
+    // identity is the same in either order
+    setUniform_(mpShader, *mpUniformCache, rio::Matrix44f::ident, mVertexUniformLocation[VERTEX_UNIFORM_MV], u32(-1));
 
     static const rio::BaseMtx33f ident33 = {
         1.0f, 0.0f, 0.0f,
         0.0f, 1.0f, 0.0f,
         0.0f, 0.0f, 1.0f
     };
-    mShader.setUniformColumnMajor(ident33, mVertexUniformLocation[VERTEX_UNIFORM_IT], u32(-1));
+    if (mpUniformCache->update(mVertexUniformLocation[VERTEX_UNIFORM_IT], u32(-1), ident33))
+        mpShader->setUniformColumnMajor(ident33, mVertexUniformLocation[VERTEX_UNIFORM_IT], u32(-1));
 }
 
 void Shader::setMatrixCallback_(void* p_obj, const rio::BaseMtx44f* matrix)
@@ -426,34 +426,32 @@ void ShaderMiitomo::bind(bool light_enable, FFLiCharInfo* pCharInfo)
 #endif
 
     mpCharInfo = pCharInfo;
-    mShader.bind();
+    bindProgram_(&mShader);
     setShaderCallback_();
 
     #if RIO_IS_CAFE
     GX2SetFetchShader(&mFetchShader);
 #elif RIO_IS_WIN
-    RIO_GL_CALL(glBindVertexArray(mVAOHandle));
-    for (u32 i = 0; i < FFL_ATTRIBUTE_BUFFER_TYPE_MAX; i++)
-        RIO_GL_CALL(glDisableVertexAttribArray(i));
+    bindVertexArray_(mVAOHandle);
 #endif
 
-    mShader.setUniform(cAlpha, mVertexUniformLocation[VERTEX_UNIFORM_ALPHA], u32(-1));
-    mShader.setUniform(0, mVertexUniformLocation[VERTEX_UNIFORM_BONE_COUNT], u32(-1));
+    setUniform_(&mShader, mUniformCache, cAlpha, mVertexUniformLocation[VERTEX_UNIFORM_ALPHA], u32(-1));
+    setUniform_(&mShader, mUniformCache, 0, mVertexUniformLocation[VERTEX_UNIFORM_BONE_COUNT], u32(-1));
 
-    mShader.setUniform(light_enable, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_ENABLE]);
+    setUniform_(&mShader, mUniformCache, light_enable, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_ENABLE]);
 
-    mShader.setUniform(cHSLightGroundColor, mVertexUniformLocation[VERTEX_UNIFORM_HS_LIGHT_GROUND_COLOR], u32(-1));
-    mShader.setUniform(cHSLightSkyColor, mVertexUniformLocation[VERTEX_UNIFORM_HS_LIGHT_SKY_COLOR], u32(-1));
+    setUniform_(&mShader, mUniformCache, cHSLightGroundColor, mVertexUniformLocation[VERTEX_UNIFORM_HS_LIGHT_GROUND_COLOR], u32(-1));
+    setUniform_(&mShader, mUniformCache, cHSLightSkyColor, mVertexUniformLocation[VERTEX_UNIFORM_HS_LIGHT_SKY_COLOR], u32(-1));
 
 
-    mShader.setUniform(cDirLightColor0, mVertexUniformLocation[VERTEX_UNIFORM_DIR_LIGHT_COLOR0], u32(-1));
-    mShader.setUniform(cDirLightColor1, mVertexUniformLocation[VERTEX_UNIFORM_DIR_LIGHT_COLOR1], u32(-1));
+    setUniform_(&mShader, mUniformCache, cDirLightColor0, mVertexUniformLocation[VERTEX_UNIFORM_DIR_LIGHT_COLOR0], u32(-1));
+    setUniform_(&mShader, mUniformCache, cDirLightColor1, mVertexUniformLocation[VERTEX_UNIFORM_DIR_LIGHT_COLOR1], u32(-1));
 
-    mShader.setUniform(mLightDirAndType0, mVertexUniformLocation[VERTEX_UNIFORM_LIGHT_DIR_AND_TYPE0], u32(-1));
-    mShader.setUniform(mLightDirAndType1, mVertexUniformLocation[VERTEX_UNIFORM_LIGHT_DIR_AND_TYPE1], u32(-1));
-    mShader.setUniform(cDirLightCount, mVertexUniformLocation[VERTEX_UNIFORM_DIR_LIGHT_COUNT], u32(-1));
+    setUniform_(&mShader, mUniformCache, mLightDirAndType0, mVertexUniformLocation[VERTEX_UNIFORM_LIGHT_DIR_AND_TYPE0], u32(-1));
+    setUniform_(&mShader, mUniformCache, mLightDirAndType1, mVertexUniformLocation[VERTEX_UNIFORM_LIGHT_DIR_AND_TYPE1], u32(-1));
+    setUniform_(&mShader, mUniformCache, cDirLightCount, mVertexUniformLocation[VERTEX_UNIFORM_DIR_LIGHT_COUNT], u32(-1));
 
-    mShader.setUniform(cLightColor, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_COLOR]);
+    setUniform_(&mShader, mUniformCache, cLightColor, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_COLOR]);
 }
 
 void ShaderMiitomo::setViewUniform(const rio::BaseMtx34f& model_mtx, const rio::BaseMtx34f& view_mtx, const rio::BaseMtx44f& proj_mtx) const
@@ -503,31 +501,6 @@ void ShaderMiitomo::applyAlphaTest(bool enable, rio::Graphics::CompareFunc func,
 #endif
 }
 
-void ShaderMiitomo::setCulling(FFLCullMode mode)
-{
-    if (mode > FFL_CULL_MODE_FRONT)
-        return;
-
-    rio::RenderState render_state;
-
-    switch (mode)
-    {
-    case FFL_CULL_MODE_NONE:
-        render_state.setCullingMode(rio::Graphics::CULLING_MODE_NONE);
-        break;
-    case FFL_CULL_MODE_BACK:
-        render_state.setCullingMode(rio::Graphics::CULLING_MODE_BACK);
-        break;
-    case FFL_CULL_MODE_FRONT:
-        render_state.setCullingMode(rio::Graphics::CULLING_MODE_FRONT);
-        break;
-    default:
-        break;
-    }
-
-    render_state.applyCullingAndPolygonModeAndPolygonOffset();
-}
-
 void ShaderMiitomo::applyAlphaTestCallback_(void* p_obj, bool enable, rio::Graphics::CompareFunc func, f32 ref)
 {
     static_cast<ShaderMiitomo*>(p_obj)->applyAlphaTest(enable, func, ref);
@@ -537,8 +510,7 @@ void ShaderMiitomo::bindTexture_(const FFLModulateParam& modulateParam)
 {
     if (modulateParam.pTexture2D != nullptr)
     {
-        mSampler.linkTexture2D(reinterpret_cast<const rio::Texture2D*>(modulateParam.pTexture2D));
-        mSampler.tryBindFS(mSamplerLocation, 0);
+        bindSamplerTexture_(mSampler, reinterpret_cast<const rio::Texture2D*>(modulateParam.pTexture2D), mSamplerLocation, 0);
     }
 
     if (modulateParam.type == FFL_MODULATE_TYPE_SHAPE_NOSELINE
@@ -555,11 +527,8 @@ void ShaderMiitomo::bindTexture_(const FFLModulateParam& modulateParam)
     const LUTFresnelTextureType fresType =
                         cModulateToLUTFresnelType[modulateParam.type];
 
-    mLUTSpecSampler.linkTexture2D(sLUTSpecTextures[specType]);
-    mLUTFresSampler.linkTexture2D(sLUTFresTextures[fresType]);
-
-    mLUTSpecSampler.tryBindFS(mLUTSpecSamplerLocation, 4);
-    mLUTFresSampler.tryBindFS(mLUTFresSamplerLocation, 5);
+    bindSamplerTexture_(mLUTSpecSampler, sLUTSpecTextures[specType], mLUTSpecSamplerLocation, 4);
+    bindSamplerTexture_(mLUTFresSampler, sLUTFresTextures[fresType], mLUTFresSamplerLocation, 5);
 }
 
 static FFLColor multiplyColorIfNeeded(FFLModulateParam param, FFLColor color)
@@ -658,7 +627,7 @@ void ShaderMiitomo::setMaterial_(const FFLModulateType modulateType)
         case FFL_MODULATE_TYPE_SHAPE_NOSELINE:
         {
             //mShader.setUniform(0.00f, 0.00f, 0.00f, mVertexUniformLocation[VERTEX_UNIFORM_EYE_PT], u32(-1));
-            mShader.setUniform(false, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_ENABLE]);
+            setUniform_(&mShader, mUniformCache, false, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_ENABLE]);
             return; // no other uniforms are set
         }
         case FFL_MODULATE_TYPE_SHAPE_MASK:
@@ -670,7 +639,7 @@ void ShaderMiitomo::setMaterial_(const FFLModulateType modulateType)
             mShader.setUniform(false, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_ALPHA_TEST]);
             break;
     }
-    mShader.setUniform(mLightEnable, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_ENABLE]);
+    setUniform_(&mShader, mUniformCache, mLightEnable, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_ENABLE]);
 }
 
 void ShaderMiitomo::draw_(const FFLDrawParam& draw_param)
@@ -699,9 +668,6 @@ void ShaderMiitomo::draw_(const FFLDrawParam& draw_param)
         }
 #elif RIO_IS_WIN
 
-        GLuint indexBufferHandle;
-        RIO_GL_CALL(glGenBuffers(1, &indexBufferHandle));  // Generate a new buffer
-
         for (int type = FFL_ATTRIBUTE_BUFFER_TYPE_POSITION; type <= FFL_ATTRIBUTE_BUFFER_TYPE_COLOR; ++type)
         {
             const FFLAttributeBuffer& buffer = draw_param.attributeBufferParam.attributeBuffers[type];
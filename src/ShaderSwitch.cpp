@@ -560,23 +560,21 @@ void ShaderSwitch::setLightDirection(const rio::Vector3f direction)
 void ShaderSwitch::bind(bool light_enable, FFLiCharInfo* pCharInfo)
 {
     mpCharInfo = pCharInfo;
-    mShader.bind();
+    bindProgram_(&mShader);
     setShaderCallback_();
 #if RIO_IS_CAFE
     GX2SetFetchShader(&mFetchShader);
 #elif RIO_IS_WIN
-    RIO_GL_CALL(glBindVertexArray(mVAOHandle));
-    for (u32 i = 0; i < FFL_ATTRIBUTE_BUFFER_TYPE_MAX; i++)
-        RIO_GL_CALL(glDisableVertexAttribArray(i));
+    bindVertexArray_(mVAOHandle);
 #endif
 
     // NOTE: no light enable means drawing mask or faceline textures
-    mShader.setUniform(light_enable, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_ENABLE]);
+    setUniform_(&mShader, mUniformCache, light_enable, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_ENABLE]);
 
     //mShader.setUniform(s32(0), u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_PAD0]);
-    mShader.setUniform(sGammaType, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_GAMMA_TYPE]);
-    mShader.setUniform(mLightDir, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_DIR_IN_VIEW]);
-    mShader.setUniform(cLightColor, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_COLOR]);
+    setUniform_(&mShader, mUniformCache, sGammaType, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_GAMMA_TYPE]);
+    setUniform_(&mShader, mUniformCache, mLightDir, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_DIR_IN_VIEW]);
+    setUniform_(&mShader, mUniformCache, cLightColor, u32(-1), mPixelUniformLocation[PIXEL_UNIFORM_LIGHT_COLOR]);
 
 }
 
@@ -598,31 +596,6 @@ void ShaderSwitch::applyAlphaTest(bool enable, rio::Graphics::CompareFunc func,
 #endif
 }
 
-void ShaderSwitch::setCulling(FFLCullMode mode)
-{
-    if (mode > FFL_CULL_MODE_FRONT)
-        return;
-
-    rio::RenderState render_state;
-
-    switch (mode)
-    {
-    case FFL_CULL_MODE_NONE:
-        render_state.setCullingMode(rio::Graphics::CULLING_MODE_NONE);
-        break;
-    case FFL_CULL_MODE_BACK:
-        render_state.setCullingMode(rio::Graphics::CULLING_MODE_BACK);
-        break;
-    case FFL_CULL_MODE_FRONT:
-        render_state.setCullingMode(rio::Graphics::CULLING_MODE_FRONT);
-        break;
-    default:
-        break;
-    }
-
-    render_state.applyCullingAndPolygonModeAndPolygonOffset();
-}
-
 void ShaderSwitch::applyAlphaTestCallback_(void* p_obj, bool enable, rio::Graphics::CompareFunc func, f32 ref)
 {
     static_cast<ShaderSwitch*>(p_obj)->applyAlphaTest(enable, func, ref);
@@ -632,8 +605,7 @@ void ShaderSwitch::bindTexture_(const FFLModulateParam& modulateParam)
 {
     if (modulateParam.pTexture2D != nullptr)
     {
-        mSampler.linkTexture2D(reinterpret_cast<const rio::Texture2D*>(modulateParam.pTexture2D));
-        mSampler.tryBindFS(mSamplerLocation, 0);
+        bindSamplerTexture_(mSampler, reinterpret_cast<const rio::Texture2D*>(modulateParam.pTexture2D), mSamplerLocation, 0);
     }
 }
 
@@ -865,9 +837,6 @@ void ShaderSwitch::draw_(const FFLDrawParam& draw_param)
         }
 #elif RIO_IS_WIN
 
-        GLuint indexBufferHandle;
-        RIO_GL_CALL(glGenBuffers(1, &indexBufferHandle));  // Generate a new buffer
-
         for (int type = FFL_ATTRIBUTE_BUFFER_TYPE_POSITION; type <= FFL_ATTRIBUTE_BUFFER_TYPE_COLOR; ++type)
         {
             const FFLAttributeBuffer& buffer = draw_param.attributeBufferParam.attributeBuffers[type];
@@ -0,0 +1,269 @@
+#include <SocketWriter.h>
+
+#if RIO_IS_WIN
+
+#if defined(_WIN32)
+    #define SOCKET_WOULD_BLOCK(err) ((err) == WSAEWOULDBLOCK)
+    #define socketLastError() WSAGetLastError()
+    #define socketPoll WSAPoll
+#else
+    #include <sys/uio.h>
+    #include <poll.h>
+    #include <cerrno>
+    #include <cstring>
+    #if defined(USE_MSG_ZEROCOPY) && defined(__linux__)
+        #include <linux/errqueue.h>
+    #endif
+    #define SOCKET_WOULD_BLOCK(err) ((err) == EAGAIN || (err) == EWOULDBLOCK)
+    #define socketLastError() errno
+    #define socketPoll poll
+#endif // _WIN32
+
+// don't die from SIGPIPE when the client hangs up mid-response
+#ifdef MSG_NOSIGNAL
+    #define SOCKET_SEND_FLAGS MSG_NOSIGNAL
+#else
+    #define SOCKET_SEND_FLAGS 0
+#endif
+
+// only enable zerocopy where the kernel supports it
+#if defined(USE_MSG_ZEROCOPY) && defined(MSG_ZEROCOPY) && defined(SO_ZEROCOPY)
+    #define SOCKET_HAS_ZEROCOPY
+#endif
+
+// header + pixels is the most this is used for
+static const u32 cMaxSocketBuffers = 8;
+
+#ifdef SOCKET_HAS_ZEROCOPY
+
+// Reads pending zerocopy notifications off the error queue
+// without blocking, adding the amount of finished sends.
+static bool drainZeroCopyCompletions_(int socket, u32* completed)
+{
+    bool gotAny = false;
+    while (true)
+    {
+        char control[128];
+        msghdr msg = {};
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (recvmsg(socket, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+            return gotAny;
+
+        for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm))
+        {
+            const sock_extended_err* serr = reinterpret_cast<const sock_extended_err*>(CMSG_DATA(cm));
+            if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+                continue;
+            // ee_info..ee_data is the (inclusive) range of sends that completed
+            *completed += serr->ee_data - serr->ee_info + 1;
+            gotAny = true;
+        }
+    }
+}
+
+// Zerocopy sends keep referencing the user pages after
+// sendmsg() returns, so the mapped buffer must not be
+// released until the kernel reports every send as done.
+static void waitForZeroCopyCompletion_(int socket, u32 sendCount, u32 completed)
+{
+    while (completed < sendCount)
+    {
+        if (drainZeroCopyCompletions_(socket, &completed))
+            continue;
+
+        pollfd pfd = { socket, 0, 0 }; // POLLERR is always reported
+        if (poll(&pfd, 1, SOCKET_SEND_TIMEOUT_MS_DEFAULT) <= 0
+            || !(pfd.revents & POLLERR))
+            break;
+    }
+
+    if (completed < sendCount)
+        RIO_LOG("sendBuffersToSocket: only %u of %u zerocopy sends completed\n", completed, sendCount);
+}
+
+#endif // SOCKET_HAS_ZEROCOPY
+
+// Blocks until the socket can take more data. The
+// socket may be non-blocking (always on Windows when
+// the listening socket is), so send() can return EAGAIN.
+static bool waitForWritable_(int socket, u32* zeroCopyCompleted)
+{
+    while (true)
+    {
+        pollfd pfd;
+        pfd.fd = socket;
+        pfd.events = POLLOUT;
+        pfd.revents = 0;
+
+        const int ret = socketPoll(&pfd, 1, SOCKET_SEND_TIMEOUT_MS_DEFAULT);
+#ifndef _WIN32
+        if (ret < 0 && errno == EINTR)
+            continue;
+#endif
+        if (ret == 0)
+        {
+            RIO_LOG("sendBuffersToSocket: timed out waiting for socket %d to be writable\n", socket);
+            return false;
+        }
+        if (ret < 0)
+            return false;
+        if (pfd.revents & POLLOUT)
+            return true;
+
+#ifdef SOCKET_HAS_ZEROCOPY
+        // woken up by zerocopy notifications, not by a real error
+        if (zeroCopyCompleted != nullptr && (pfd.revents & POLLERR)
+            && drainZeroCopyCompletions_(socket, zeroCopyCompleted))
+            continue;
+#endif
+        return false;
+    }
+}
+
+#ifdef _WIN32
+
+bool sendBuffersToSocket(int socket, const SocketBuffer* buffers, u32 count)
+{
+    // no sendmsg() here, just write each buffer out in order
+    for (u32 i = 0; i < count; i++)
+    {
+        const char* data = static_cast<const char*>(buffers[i].data);
+        size_t remaining = buffers[i].size;
+        while (remaining > 0)
+        {
+            const int chunk = static_cast<int>(remaining < SOCKET_SEND_CHUNK_SIZE ? remaining : SOCKET_SEND_CHUNK_SIZE);
+            const int sent = send(socket, data, chunk, SOCKET_SEND_FLAGS);
+            if (sent < 0)
+            {
+                const int err = socketLastError();
+                if (SOCKET_WOULD_BLOCK(err) && waitForWritable_(socket, nullptr))
+                    continue;
+                RIO_LOG("sendBuffersToSocket: send failed on socket %d (%d)\n", socket, err);
+                return false;
+            }
+            data += sent;
+            remaining -= sent;
+        }
+    }
+    return true;
+}
+
+#else
+
+bool sendBuffersToSocket(int socket, const SocketBuffer* buffers, u32 count)
+{
+    // checked in release too, iov would overflow otherwise
+    if (count > cMaxSocketBuffers)
+    {
+        RIO_LOG("sendBuffersToSocket: %u buffers is more than the %u it takes, nothing was sent\n",
+                count, cMaxSocketBuffers);
+        return false;
+    }
+
+    iovec iov[cMaxSocketBuffers];
+    size_t total = 0;
+    for (u32 i = 0; i < count; i++)
+    {
+        iov[i].iov_base = const_cast<void*>(buffers[i].data);
+        iov[i].iov_len = buffers[i].size;
+        total += buffers[i].size;
+    }
+
+    int flags = SOCKET_SEND_FLAGS;
+#ifdef SOCKET_HAS_ZEROCOPY
+    u32 zeroCopySends = 0;
+    u32 zeroCopyCompleted = 0;
+    u32* pZeroCopyCompleted = &zeroCopyCompleted;
+    const int one = 1;
+    if (total >= SOCKET_ZEROCOPY_THRESHOLD
+        && setsockopt(socket, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0)
+        flags |= MSG_ZEROCOPY;
+#else
+    u32* pZeroCopyCompleted = nullptr;
+#endif
+
+    u32 first = 0; // first iovec that still has data left
+    bool result = true;
+    while (first < count)
+    {
+        // skip over empty buffers
+        if (iov[first].iov_len == 0)
+        {
+            first++;
+            continue;
+        }
+
+        // hand at most one chunk to the kernel at a time
+        iovec window[cMaxSocketBuffers];
+        u32 windowCount = 0;
+        size_t budget = SOCKET_SEND_CHUNK_SIZE;
+        for (u32 i = first; i < count && budget > 0; i++)
+        {
+            window[windowCount] = iov[i];
+            if (window[windowCount].iov_len > budget)
+                window[windowCount].iov_len = budget;
+            budget -= window[windowCount].iov_len;
+            windowCount++;
+        }
+
+        msghdr msg = {};
+        msg.msg_iov = window;
+        msg.msg_iovlen = windowCount;
+
+        const ssize_t sent = sendmsg(socket, &msg, flags);
+        if (sent < 0)
+        {
+            const int err = socketLastError();
+            if (err == EINTR)
+                continue;
+            if (SOCKET_WOULD_BLOCK(err) && waitForWritable_(socket, pZeroCopyCompleted))
+                continue;
+#ifdef SOCKET_HAS_ZEROCOPY
+            // out of optmem for pinned pages, just copy instead
+            if (err == ENOBUFS && (flags & MSG_ZEROCOPY))
+            {
+                flags &= ~MSG_ZEROCOPY;
+                continue;
+            }
+#endif
+            RIO_LOG("sendBuffersToSocket: sendmsg failed on socket %d: %s\n", socket, strerror(err));
+            result = false;
+            break;
+        }
+
+#ifdef SOCKET_HAS_ZEROCOPY
+        if (flags & MSG_ZEROCOPY)
+            zeroCopySends++;
+#endif
+
+        // advance past what was written
+        size_t advance = static_cast<size_t>(sent);
+        while (advance > 0 && first < count)
+        {
+            if (advance >= iov[first].iov_len)
+            {
+                advance -= iov[first].iov_len;
+                first++;
+            }
+            else
+            {
+                iov[first].iov_base = static_cast<u8*>(iov[first].iov_base) + advance;
+                iov[first].iov_len -= advance;
+                advance = 0;
+            }
+        }
+    }
+
+#ifdef SOCKET_HAS_ZEROCOPY
+    if (zeroCopySends > 0)
+        waitForZeroCopyCompletion_(socket, zeroCopySends, zeroCopyCompleted);
+#endif
+
+    return result;
+}
+
+#endif // _WIN32
+
+#endif // RIO_IS_WIN
@@ -0,0 +1,83 @@
+#include <TextureMemory.h>
+
+#include <cstdio>
+
+static const char* cTextureMemoryKindNames[TEXTURE_MEMORY_KIND_MAX] = {
+    "char_model",     // TEXTURE_MEMORY_KIND_CHAR_MODEL
+    "render_texture", // TEXTURE_MEMORY_KIND_RENDER_TEXTURE
+};
+
+TextureMemory& TextureMemory::instance()
+{
+    static TextureMemory sInstance;
+    return sInstance;
+}
+
+TextureMemory::TextureMemory()
+    : mBudget(static_cast<u64>(TEXTURE_MEMORY_BUDGET_DEFAULT_MB) * 1024 * 1024)
+    , mUsage{ 0 }
+    , mPeakUsage(0)
+    , mDowngradeCount(0)
+{
+}
+
+u64 TextureMemory::getUsage() const
+{
+    u64 usage = 0;
+    for (u32 i = 0; i < TEXTURE_MEMORY_KIND_MAX; i++)
+        usage += mUsage[i];
+    return usage;
+}
+
+void TextureMemory::add(TextureMemoryKind kind, u64 size)
+{
+    mUsage[kind] += size;
+    const u64 usage = getUsage();
+    if (usage > mPeakUsage)
+        mPeakUsage = usage;
+}
+
+void TextureMemory::remove(TextureMemoryKind kind, u64 size)
+{
+    RIO_ASSERT(mUsage[kind] >= size);
+    mUsage[kind] -= size;
+}
+
+u64 TextureMemory::calcCharModelSize(const FFLCharModelDesc& desc)
+{
+    const u32 resolution = desc.resolution & ~FFL_RESOLUTION_MIP_MAP_ENABLE_MASK;
+
+    u32 expressionCount = 0;
+    for (u32 i = 0; i < 3; i++)
+        for (u32 flags = desc.allExpressionFlag.flags[i]; flags != 0; flags &= flags - 1)
+            expressionCount++;
+
+    const u64 maskSize = static_cast<u64>(resolution) * resolution * 4;
+    u64 size = maskSize / 2 + maskSize * expressionCount;
+    if (desc.resolution & FFL_RESOLUTION_MIP_MAP_ENABLE_MASK)
+        size += size / 3;
+    return size;
+}
+
+std::string TextureMemory::formatMetrics() const
+{
+    char line[160];
+    std::string metrics;
+
+    snprintf(line, sizeof(line), "ffl_testing_texture_memory_budget_bytes %llu\n",
+             static_cast<unsigned long long>(mBudget));
+    metrics += line;
+    for (u32 i = 0; i < TEXTURE_MEMORY_KIND_MAX; i++)
+    {
+        snprintf(line, sizeof(line), "ffl_testing_texture_memory_bytes{kind=\"%s\"} %llu\n",
+                 cTextureMemoryKindNames[i], static_cast<unsigned long long>(mUsage[i]));
+        metrics += line;
+    }
+    snprintf(line, sizeof(line), "ffl_testing_texture_memory_peak_bytes %llu\n",
+             static_cast<unsigned long long>(mPeakUsage));
+    metrics += line;
+    snprintf(line, sizeof(line), "ffl_testing_texture_resolution_downgrades_total %llu\n",
+             static_cast<unsigned long long>(mDowngradeCount));
+    metrics += line;
+    return metrics;
+}
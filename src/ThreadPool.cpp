@@ -0,0 +1,102 @@
+#include <ThreadPool.h>
+
+ThreadPool& ThreadPool::instance()
+{
+    // the calling thread always helps out, so leave one core for it
+    static ThreadPool sInstance(std::thread::hardware_concurrency() > 1
+                                ? std::thread::hardware_concurrency() - 1
+                                : 0);
+    return sInstance;
+}
+
+ThreadPool::ThreadPool(u32 threadCount)
+    : mpBatch(nullptr)
+    , mGeneration(0)
+    , mStopping(false)
+{
+    mThreads.reserve(threadCount);
+    for (u32 i = 0; i < threadCount; i++)
+        mThreads.emplace_back(&ThreadPool::workerMain_, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mWorkCond.notify_all();
+
+    for (std::thread& thread : mThreads)
+        thread.join();
+}
+
+void ThreadPool::runBatch_(Batch* pBatch)
+{
+    u32 i;
+    while ((i = pBatch->next.fetch_add(1)) < pBatch->count)
+        (*pBatch->pFunc)(i);
+}
+
+void ThreadPool::parallelFor(u32 count, const std::function<void(u32)>& func)
+{
+    if (count == 0)
+        return;
+
+    // not worth waking anyone up
+    if (count == 1 || mThreads.empty())
+    {
+        for (u32 i = 0; i < count; i++)
+            func(i);
+        return;
+    }
+
+    std::lock_guard<std::mutex> callLock(mCallMutex);
+
+    Batch batch;
+    batch.pFunc = &func;
+    batch.count = count;
+    batch.next = 0;
+    batch.active = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mpBatch = &batch;
+        mGeneration++;
+    }
+    mWorkCond.notify_all();
+
+    runBatch_(&batch);
+
+    // wait for workers still running an index, then retire the batch
+    // so that late wakers don't pick up a pointer to the stack
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDoneCond.wait(lock, [&batch] { return batch.active == 0; });
+    mpBatch = nullptr;
+}
+
+void ThreadPool::workerMain_()
+{
+    u64 seenGeneration = 0;
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true)
+    {
+        mWorkCond.wait(lock, [this, &seenGeneration] {
+            return mStopping || (mpBatch != nullptr && mGeneration != seenGeneration);
+        });
+        if (mStopping)
+            return;
+
+        seenGeneration = mGeneration;
+        Batch* pBatch = mpBatch;
+        pBatch->active++;
+
+        lock.unlock();
+        runBatch_(pBatch);
+        lock.lock();
+
+        if (--pBatch->active == 0)
+            mDoneCond.notify_all();
+    }
+}
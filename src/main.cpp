@@ -1,4 +1,5 @@
 #include <RootTask.h>
+#include <TextureMemory.h>
 
 #include <rio.h>
 #include <gfx/rio_Window.h>
@@ -142,6 +143,24 @@ void parseArgv(int argc, char* argv[])
             && i + 1 < argc // get next argument
         )
             RootTask::sServerPort = argv[++i];
+        else if (arg == "--queue-depth" && i + 1 < argc)
+            RootTask::sQueueDepth = argv[++i];
+        else if (arg == "--deadline" && i + 1 < argc)
+            RootTask::sDeadlineMs = argv[++i];
+        else if (arg == "--bulk-port" && i + 1 < argc)
+            RootTask::sBulkPort = argv[++i];
+        else if (arg == "--interactive-weight" && i + 1 < argc)
+            RootTask::sInteractiveWeight = argv[++i];
+        else if (arg == "--unix-socket" && i + 1 < argc)
+            RootTask::sUnixSocketPath = argv[++i];
+        else if (arg == "--bulk-unix-socket" && i + 1 < argc)
+            RootTask::sBulkUnixSocketPath = argv[++i];
+        else if (arg == "--preload" && i + 1 < argc)
+            RootTask::sPreloadList = argv[++i];
+        else if (arg == "--char-model-cache" && i + 1 < argc)
+            RootTask::sCharModelCacheSize = argv[++i];
+        else if (arg == "--texture-budget" && i + 1 < argc)
+            RootTask::sTextureBudgetMB = argv[++i];
 
         else if ((arg == "--resource-path")
                 && i + 1 < argc)
@@ -159,6 +178,15 @@ void parseArgv(int argc, char* argv[])
             // server options
             RIO_LOG("  --server, -s = Run as a standalone server. Avoids maintaining window and uses minimal resources (pauses on accept())\n");
             RIO_LOG("  --port, -p <port> = Set TCP server port (host is always localhost)\n");
+            RIO_LOG("  --queue-depth <n> = Requests of each priority that can wait to render before new ones are turned away (default: %d)\n", REQUEST_QUEUE_DEPTH_DEFAULT);
+            RIO_LOG("  --deadline <ms> = Drop requests that waited longer than this, unless they have their own deadline (default: none)\n");
+            RIO_LOG("  --bulk-port <port> = Also listen here, for requests that render at bulk priority unless they set their own\n");
+            RIO_LOG("  --unix-socket <path> = Listen on a unix domain socket instead of --port\n");
+            RIO_LOG("  --bulk-unix-socket <path> = Same as --bulk-port, but a unix domain socket\n");
+            RIO_LOG("  --preload <list> = Load these at startup instead of on first use: all, or any of shaders,bodies,hats\n");
+            RIO_LOG("  --char-model-cache <n> = Models kept so that requests for the same Mii reuse their faceline and mask textures, 0 = none (default: %d)\n", CHAR_MODEL_CACHE_SIZE_DEFAULT);
+            RIO_LOG("  --texture-budget <MiB> = Texture memory for models and render targets, texResolution of new models is lowered to stay within it, 0 = no limit (default: %d)\n", TEXTURE_MEMORY_BUDGET_DEFAULT_MB);
+            RIO_LOG("  --interactive-weight <n> = Interactive requests rendered for each bulk one while both wait, 0 = bulk only when idle (default: %d)\n", REQUEST_QUEUE_INTERACTIVE_WEIGHT_DEFAULT);
 
             // resource options
             RIO_LOG("  --resource-path <directory> = Set search path for FFLResMiddle.dat/FFLResHigh.dat.\n");